@@ -13,14 +13,19 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(graphcore.pri)
+
 SOURCES += \
-        graphconnection.cpp \
-        graphcore.cpp \
-        graphgenericobject.cpp \
-        graphnode.cpp \
-        graphnodeport.cpp \
+        graphcommandline.cpp \
+        graphconnectionitem.cpp \
+        graphnodeitem.cpp \
         main.cpp
 
+HEADERS += \
+    graphcommandline.h \
+    graphconnectionitem.h \
+    graphnodeitem.h
+
 RESOURCES += qml.qrc
 
 # Additional import path used to resolve QML modules in Qt Creator's code model
@@ -34,11 +39,4 @@ qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
-HEADERS += \
-    graphconnection.h \
-    graphcore.h \
-    graphgenericobject.h \
-    graphnode.h \
-    graphnodeport.h
-
 OTHER_FILES += main.qml
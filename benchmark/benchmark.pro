@@ -0,0 +1,20 @@
+QT += gui
+QT -= quick
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = graphview_benchmark
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../graphcore.pri)
+
+SOURCES += \
+        benchmarkreport.cpp \
+        graphgenerator.cpp \
+        main.cpp
+
+HEADERS += \
+    benchmarkreport.h \
+    graphgenerator.h
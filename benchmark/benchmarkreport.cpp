@@ -0,0 +1,126 @@
+#include "benchmarkreport.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QSysInfo>
+#include <QThread>
+
+/**
+ * @brief The BenchmarkReport class writes the benchmark results
+ * Results are tables of named columns. The text format prints aligned tables for reading,
+ * the csv format one header line per table followed by its rows, the json format one
+ * object per row and line. Every csv and json row starts with the table name and the label,
+ * so the output of several releases can be concatenated and compared by these keys.
+ */
+
+BenchmarkReport::BenchmarkReport(QTextStream *out, Format format, const QString &label)
+    : m_out(out), m_format(format), m_label(label)
+{
+}
+
+/**
+ * @brief BenchmarkReport::formatFromName looks up a format by name: text, csv or json
+ * @return false if there is no format of that name
+ */
+bool BenchmarkReport::formatFromName(const QString &name, Format *format)
+{
+    const int index = QStringList({ QStringLiteral("text"), QStringLiteral("csv"), QStringLiteral("json") }).indexOf(name);
+    if (index < 0)
+        return false;
+    *format = Format(index);
+    return true;
+}
+
+/**
+ * @brief BenchmarkReport::writeEnvironment writes a table describing the build and the machine
+ */
+void BenchmarkReport::writeEnvironment()
+{
+#ifdef QT_NO_DEBUG
+    const QString build = QStringLiteral("release");
+#else
+    const QString build = QStringLiteral("debug");
+#endif
+    beginTable(QStringLiteral("environment"), QStringLiteral("environment"),
+               { "qt", "build", "os", "cpu", "threads" });
+    addRow({ QString::fromLatin1(qVersion()), build, QSysInfo::prettyProductName(),
+             QSysInfo::currentCpuArchitecture(), QThread::idealThreadCount() });
+}
+
+/**
+ * @brief BenchmarkReport::beginTable starts a table, the following rows belong to it
+ * @param name key of the table in csv and json records
+ * @param title description printed by the text format, e.g. the units
+ * @param columns column names, short identifiers without spaces
+ */
+void BenchmarkReport::beginTable(const QString &name, const QString &title, const QStringList &columns)
+{
+    m_table = name;
+    m_columns = columns;
+    m_widths.clear();
+    for (const QString &column : columns)
+        m_widths.append(qMax(10, column.size() + 2));
+
+    switch (m_format) {
+    case TextFormat:
+        *m_out << "\n" << title << "\n";
+        for (int i = 0; i < columns.size(); ++i)
+            *m_out << qSetFieldWidth(m_widths.at(i)) << columns.at(i);
+        *m_out << qSetFieldWidth(0) << "\n";
+        break;
+    case CsvFormat:
+        *m_out << "benchmark,label," << columns.join(QLatin1Char(',')) << "\n";
+        break;
+    case JsonFormat:
+        break;
+    }
+    m_out->flush();
+}
+
+/**
+ * @brief BenchmarkReport::addRow writes a row of the current table
+ * @param values one value per column, doubles are rounded to two decimals by the text and csv formats
+ */
+void BenchmarkReport::addRow(const QVariantList &values)
+{
+    Q_ASSERT(values.size() == m_columns.size());
+    switch (m_format) {
+    case TextFormat:
+        for (int i = 0; i < values.size(); ++i)
+            *m_out << qSetFieldWidth(m_widths.at(i)) << (values.at(i).isValid() ? formatValue(values.at(i)) : QStringLiteral("n/a"));
+        *m_out << qSetFieldWidth(0) << "\n";
+        break;
+    case CsvFormat: {
+        QStringList fields({ m_table, m_label });
+        for (const QVariant &value : values) {
+            QString field = formatValue(value);
+            if (field.contains(QLatin1Char(',')) || field.contains(QLatin1Char('"')))
+                field = QStringLiteral("\"%1\"").arg(field.replace(QLatin1Char('"'), QLatin1String("\"\"")));
+            fields.append(field);
+        }
+        *m_out << fields.join(QLatin1Char(',')) << "\n";
+        break;
+    }
+    case JsonFormat: {
+        QJsonObject record;
+        record.insert(QStringLiteral("benchmark"), m_table);
+        record.insert(QStringLiteral("label"), m_label);
+        for (int i = 0; i < values.size(); ++i)
+            record.insert(m_columns.at(i), QJsonValue::fromVariant(values.at(i)));
+        *m_out << QJsonDocument(record).toJson(QJsonDocument::Compact) << "\n";
+        break;
+    }
+    }
+    m_out->flush();
+}
+
+/**
+ * @brief BenchmarkReport::formatValue converts a value for the text and csv formats, empty for invalid values
+ */
+QString BenchmarkReport::formatValue(const QVariant &value)
+{
+    if (value.type() == QVariant::Double)
+        return QString::number(value.toDouble(), 'f', 2);
+    return value.toString();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QVariantList>
+#include <QVector>
+
+class BenchmarkReport
+{
+public:
+    enum Format { TextFormat, CsvFormat, JsonFormat };
+
+    BenchmarkReport(QTextStream *out, Format format, const QString &label);
+
+    static bool formatFromName(const QString &name, Format *format);
+
+    void writeEnvironment();
+    void beginTable(const QString &name, const QString &title, const QStringList &columns);
+    void addRow(const QVariantList &values);
+
+private:
+    static QString formatValue(const QVariant &value);
+
+    QTextStream *m_out;
+    Format m_format;
+    // release or build the results belong to, part of every record
+    QString m_label;
+    QString m_table;
+    QStringList m_columns;
+    QVector<int> m_widths;
+};
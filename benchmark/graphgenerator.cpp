@@ -0,0 +1,175 @@
+#include "graphgenerator.h"
+
+#include <QRandomGenerator>
+#include <QSet>
+#include <QtMath>
+
+/**
+ * @brief The GraphGenerator class builds synthetic graphs of a given size for the benchmarks
+ * Every node gets the same number of input and output ports, connections always lead from
+ * an output port to an input port of another node and never repeat. The topology decides
+ * which nodes are connected:
+ * - chain: every node to the next one
+ * - tree: a binary tree, every node to its two children
+ * - grid: a square grid, every node to its right and lower neighbour
+ * - random: uniformly chosen pairs of nodes
+ * - scale-free: preferential attachment, a few hubs collect most connections
+ * The result depends only on the options, the same seed gives the same graph.
+ */
+
+namespace {
+
+const char *const TopologyNames[] = { "chain", "tree", "grid", "random", "scale-free" };
+
+} // namespace
+
+/**
+ * @brief GraphGenerator::topologyNames returns the names of the topologies, in the order of Topology
+ */
+QStringList GraphGenerator::topologyNames()
+{
+    QStringList names;
+    for (const char *name : TopologyNames)
+        names.append(QLatin1String(name));
+    return names;
+}
+
+/**
+ * @brief GraphGenerator::topologyName returns the name of a topology as accepted by topologyFromName()
+ */
+QString GraphGenerator::topologyName(Topology topology)
+{
+    return QLatin1String(TopologyNames[topology]);
+}
+
+/**
+ * @brief GraphGenerator::topologyFromName looks up a topology by name
+ * @return false if there is no topology of that name
+ */
+bool GraphGenerator::topologyFromName(const QString &name, Topology *topology)
+{
+    const int index = topologyNames().indexOf(name);
+    if (index < 0)
+        return false;
+    *topology = Topology(index);
+    return true;
+}
+
+/**
+ * @brief GraphGenerator::nodeName returns the name of the generated node with the given number
+ */
+QString GraphGenerator::nodeName(int node)
+{
+    return QStringLiteral("Node_%1").arg(node);
+}
+
+QString GraphGenerator::inputPortName(int port)
+{
+    return QStringLiteral("In_%1").arg(port);
+}
+
+QString GraphGenerator::outputPortName(int port)
+{
+    return QStringLiteral("Out_%1").arg(port);
+}
+
+/**
+ * @brief GraphGenerator::generate creates a graph
+ * Nodes are placed on a square grid in the order of their numbers
+ * @param options size, topology and seed
+ */
+GraphData GraphGenerator::generate(const Options &options)
+{
+    const int nodeCount = qMax(options.nodeCount, 0);
+    const int portCount = qMax(options.portsPerDirection, 1);
+    const int side = qMax(1, qCeil(qSqrt(nodeCount)));
+
+    GraphData data;
+    QStringList inputNames;
+    QStringList outputNames;
+    for (int port = 0; port < portCount; ++port) {
+        inputNames.append(inputPortName(port));
+        outputNames.append(outputPortName(port));
+    }
+    data.nodes.resize(nodeCount);
+    for (int node = 0; node < nodeCount; ++node) {
+        GraphNodeData &nodeData = data.nodes[node];
+        nodeData.name = nodeName(node);
+        nodeData.coord = QPointF((node % side) * 300, (node / side) * 350);
+        nodeData.ports.resize(2 * portCount);
+        for (int port = 0; port < portCount; ++port) {
+            nodeData.ports[port].name = inputNames.at(port);
+            nodeData.ports[port].portType = 1;
+            nodeData.ports[port].value = port;
+            nodeData.ports[portCount + port].name = outputNames.at(port);
+            nodeData.ports[portCount + port].portType = 0;
+            nodeData.ports[portCount + port].value = port;
+        }
+    }
+    if (nodeCount < 2)
+        return data;
+
+    QRandomGenerator random(options.seed);
+    QVector<int> endpoints;     // every node once per connection end, for the preferential attachment
+    QSet<quint64> used;
+    const int wanted = qMax(options.connectionCount, 0);
+    data.connections.reserve(wanted);
+    // structured topologies run out of free port pairs, the attempt limit ends the loop then
+    const qint64 attempts = 8 * qint64(wanted) + 64;
+    const qint64 period = options.topology == GridTopology ? 2 * qint64(nodeCount) : nodeCount - 1;
+    for (qint64 attempt = 0; attempt < attempts && data.connections.size() < wanted; ++attempt) {
+        int source = 0;
+        int target = 0;
+        switch (options.topology) {
+        case ChainTopology:
+            source = int(attempt % (nodeCount - 1));
+            target = source + 1;
+            break;
+        case TreeTopology:
+            target = 1 + int(attempt % (nodeCount - 1));
+            source = (target - 1) / 2;
+            break;
+        case GridTopology: {
+            source = int((attempt / 2) % nodeCount);
+            const bool right = attempt % 2 == 0;
+            target = right ? source + 1 : source + side;
+            if ((right && source % side == side - 1) || target >= nodeCount)
+                continue;
+            break;
+        }
+        case RandomTopology:
+            source = random.bounded(nodeCount);
+            target = random.bounded(nodeCount);
+            break;
+        case ScaleFreeTopology:
+            source = random.bounded(nodeCount);
+            target = endpoints.isEmpty() || random.bounded(4) == 0 ? random.bounded(nodeCount)
+                                                                   : endpoints.at(random.bounded(endpoints.size()));
+            break;
+        }
+        if (source == target)
+            continue;
+
+        // structured topologies walk the port pairs in order, so every round over the nodes connects other ports
+        const int pass = options.topology == RandomTopology || options.topology == ScaleFreeTopology
+                ? random.bounded(portCount * portCount) : int((attempt / period) % (portCount * portCount));
+        const int output = pass % portCount;
+        const int input = pass / portCount;
+        const quint64 key = (quint64(quint32(source * portCount + output)) << 32) | quint32(target * portCount + input);
+        if (used.contains(key))
+            continue;
+        used.insert(key);
+        if (options.topology == ScaleFreeTopology) {
+            endpoints.append(source);
+            endpoints.append(target);
+        }
+
+        GraphConnectionData connection;
+        connection.sourceNode = data.nodes.at(source).name;
+        connection.outputPort = outputNames.at(output);
+        connection.targetNode = data.nodes.at(target).name;
+        connection.inputPort = inputNames.at(input);
+        data.connections.append(connection);
+    }
+    return data;
+}
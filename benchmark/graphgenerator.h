@@ -0,0 +1,32 @@
+#pragma once
+
+#include "graphdata.h"
+
+#include <QString>
+#include <QStringList>
+
+class GraphGenerator
+{
+public:
+    enum Topology { ChainTopology, TreeTopology, GridTopology, RandomTopology, ScaleFreeTopology };
+
+    struct Options
+    {
+        Topology topology = RandomTopology;
+        int nodeCount = 1000;
+        int portsPerDirection = 4;
+        // fewer connections are generated when the topology has no room for more
+        int connectionCount = 2000;
+        quint32 seed = 1;
+    };
+
+    static QStringList topologyNames();
+    static QString topologyName(Topology topology);
+    static bool topologyFromName(const QString &name, Topology *topology);
+
+    static GraphData generate(const Options &options);
+
+    static QString nodeName(int node);
+    static QString inputPortName(int port);
+    static QString outputPortName(int port);
+};
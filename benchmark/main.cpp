@@ -0,0 +1,719 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThreadPool>
+
+#include <limits>
+
+#include "benchmarkreport.h"
+#include "graphbinaryformat.h"
+#include "graphconnection.h"
+#include "graphcore.h"
+#include "graphgenerator.h"
+#include "graphnode.h"
+#include "graphnodeport.h"
+
+/**
+ * Benchmarks of the GraphCore hot paths and of whole graphs of generated shapes and sizes,
+ * run with --help for the options. Use --format csv or json and a --label per release
+ * to compare the results of several releases.
+ */
+
+static const int PortsPerDirection = 4;
+
+/**
+ * @brief fillGraph creates a chain of nodes, every output port is connected to the next node
+ * @param graphCore an empty graph
+ * @param nodeCount number of nodes
+ */
+static void fillGraph(GraphCore &graphCore, int nodeCount)
+{
+    const QString nodeNameTemplate = QStringLiteral("Node_%1");
+    const QString inPortTemplate = QStringLiteral("In_%1");
+    const QString outPortTemplate = QStringLiteral("Out_%1");
+    for (int n = 0; n < nodeCount; ++n) {
+        const QString &nodeName = nodeNameTemplate.arg(n);
+        graphCore.addGraphNode(nodeName, n * 10, n * 10);
+        GraphNode *node = graphCore.findNode(nodeName);
+        for (int p = 0; p < PortsPerDirection; ++p) {
+            node->addInputPort(inPortTemplate.arg(p), p);
+            node->addOutputPort(outPortTemplate.arg(p), p);
+        }
+    }
+    // only half of the ports are connected, so both branches of isConnected are measured
+    for (int n = 1; n < nodeCount; ++n) {
+        for (int p = 0; p < PortsPerDirection / 2; ++p)
+            graphCore.addGraphConnection(nodeNameTemplate.arg(n - 1), outPortTemplate.arg(p), nodeNameTemplate.arg(n), inPortTemplate.arg(p));
+    }
+}
+
+/**
+ * @brief fillPipelines creates independent chains of nodes, every node computes an expression of its input
+ * @param graphCore an empty graph
+ * @param pipelineCount number of chains
+ * @param length nodes per chain
+ */
+static void fillPipelines(GraphCore &graphCore, int pipelineCount, int length)
+{
+    const QString nodeNameTemplate = QStringLiteral("Pipeline_%1_%2");
+    const QString in = QStringLiteral("In");
+    const QString out = QStringLiteral("Out");
+    graphCore.beginUpdate();
+    for (int p = 0; p < pipelineCount; ++p) {
+        for (int n = 0; n < length; ++n) {
+            const QString &nodeName = nodeNameTemplate.arg(p).arg(n);
+            graphCore.addGraphNode(nodeName, n * 300, p * 350);
+            GraphNode *node = graphCore.findNode(nodeName);
+            node->addInputPort(in, 1.0);
+            node->addOutputPort(out, QStringLiteral("(In * 3 + 1) / 2 - In * 0.5"));
+            if (n > 0)
+                graphCore.addGraphConnection(nodeNameTemplate.arg(p).arg(n - 1), out, nodeName, in);
+        }
+    }
+    graphCore.endUpdate();
+}
+
+/**
+ * @brief scanHasConnection is the former implementation of GraphCore::hasConnection, kept as a reference
+ */
+static bool scanHasConnection(const GraphStore &store, int portId)
+{
+    for (int connectionId = 0; connectionId < store.connectionCapacity(); ++connectionId) {
+        if (store.isConnection(connectionId)
+                && (store.connectionInput(connectionId) == portId || store.connectionOutput(connectionId) == portId)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief benchmarkIsConnected asks every port of the graph whether it is connected,
+ * the same work a view does when it shows the connection state of every port
+ */
+static void benchmarkIsConnected(BenchmarkReport &report, int nodeCount)
+{
+    GraphCore graphCore;
+    fillGraph(graphCore, nodeCount);
+    const GraphStore &store = graphCore.store();
+
+    QVector<int> ports;
+    for (int nodeId : graphCore.nodeIds())
+        ports += store.nodePorts(nodeId);
+
+    QElapsedTimer timer;
+    int connected = 0;
+    timer.start();
+    for (int portId : qAsConst(ports))
+        connected += store.portDegree(portId) > 0 ? 1 : 0;
+    const qint64 indexedNs = timer.nsecsElapsed();
+
+    int scanned = 0;
+    timer.restart();
+    for (int portId : qAsConst(ports))
+        scanned += scanHasConnection(store, portId) ? 1 : 0;
+    const qint64 scanNs = timer.nsecsElapsed();
+
+    Q_ASSERT(connected == scanned);
+    report.addRow({ nodeCount, ports.size(), store.connectionCount(), indexedNs / 1000, scanNs / 1000,
+                    double(scanNs) / qMax<qint64>(indexedNs, 1) });
+}
+
+/**
+ * @brief benchmarkTraversal visits every port of every node and sums the port degrees,
+ * once over the store tables and once through the QObject facades
+ */
+static void benchmarkTraversal(BenchmarkReport &report, int nodeCount)
+{
+    GraphCore graphCore;
+    fillGraph(graphCore, nodeCount);
+    const GraphStore &store = graphCore.store();
+
+    QElapsedTimer timer;
+    int storeDegrees = 0;
+    timer.start();
+    for (int nodeId = 0; nodeId < store.nodeCapacity(); ++nodeId) {
+        if (!store.isNode(nodeId))
+            continue;
+        for (int portId = store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = store.nextPort(portId))
+            storeDegrees += store.portDegree(portId);
+    }
+    const qint64 storeNs = timer.nsecsElapsed();
+
+    // the first pass creates the facades, only the second one is measured
+    int facadeDegrees = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        facadeDegrees = 0;
+        timer.restart();
+        for (const auto n : graphCore.graphNodes()) {
+            const GraphNode *node = static_cast<GraphNode *>(n);
+            for (const auto port : (node->outputPorts() + node->inputPorts()))
+                facadeDegrees += graphCore.connectionCount(static_cast<GraphNodePort *>(port));
+        }
+    }
+    const qint64 facadeNs = timer.nsecsElapsed();
+
+    Q_ASSERT(storeDegrees == facadeDegrees);
+    report.addRow({ nodeCount, store.portCount(), store.connectionCount(), storeNs / 1000, facadeNs / 1000,
+                    double(facadeNs) / qMax<qint64>(storeNs, 1) });
+}
+
+/**
+ * @brief benchmarkEvaluate evaluates independent pipelines on one thread and on the whole thread pool
+ */
+static void benchmarkEvaluate(BenchmarkReport &report, int pipelineCount, int length)
+{
+    GraphCore graphCore;
+    fillPipelines(graphCore, pipelineCount, length);
+    GraphEvaluator evaluator(graphCore.store());
+    QString errorString;
+
+    QThreadPool *threadPool = QThreadPool::globalInstance();
+    const int threadCount = threadPool->maxThreadCount();
+    QElapsedTimer timer;
+
+    threadPool->setMaxThreadCount(1);
+    timer.start();
+    evaluator.evaluate(&errorString);
+    const qint64 sequentialNs = timer.nsecsElapsed();
+
+    threadPool->setMaxThreadCount(threadCount);
+    evaluator.invalidate();
+    timer.restart();
+    evaluator.evaluate(&errorString);
+    const qint64 parallelNs = timer.nsecsElapsed();
+
+    report.addRow({ pipelineCount * length, threadCount, sequentialNs / 1000, parallelNs / 1000,
+                    double(sequentialNs) / qMax<qint64>(parallelNs, 1) });
+}
+
+/**
+ * @brief benchmarkKernels evaluates wide graphs node by node and in batches of ports sharing their expression,
+ * the first evaluation also compiles the expressions
+ */
+static void benchmarkKernels(BenchmarkReport &report, int pipelineCount)
+{
+    GraphCore graphCore;
+    fillPipelines(graphCore, pipelineCount, 4);
+    GraphEvaluator evaluator(graphCore.store());
+    QString errorString;
+    QElapsedTimer timer;
+
+    timer.start();
+    evaluator.evaluate(&errorString);
+    const qint64 firstNs = timer.nsecsElapsed();
+
+    evaluator.setBatchWidth(0);
+    evaluator.invalidate();
+    timer.restart();
+    evaluator.evaluate(&errorString);
+    const qint64 nodeNs = timer.nsecsElapsed();
+
+    evaluator.setBatchWidth(GraphEvaluator::BatchWidth);
+    evaluator.invalidate();
+    timer.restart();
+    evaluator.evaluate(&errorString);
+    const qint64 batchNs = timer.nsecsElapsed();
+
+    report.addRow({ pipelineCount * 4, evaluator.compileCount(), firstNs / 1000, nodeNs / 1000, batchNs / 1000,
+                    double(nodeNs) / qMax<qint64>(batchNs, 1) });
+}
+
+/**
+ * @brief benchmarkIncremental changes the input of the first node of one pipeline at a time,
+ * once evaluating everything that became dirty and once pulling the result at the end of the pipeline
+ */
+static void benchmarkIncremental(BenchmarkReport &report, int pipelineCount, int length)
+{
+    static const int Edits = 32;
+    const QString nodeNameTemplate = QStringLiteral("Pipeline_%1_%2");
+    GraphCore graphCore;
+    fillPipelines(graphCore, pipelineCount, length);
+    const GraphStore &store = graphCore.store();
+    QElapsedTimer timer;
+
+    timer.start();
+    graphCore.evaluate();
+    const qint64 fullNs = timer.nsecsElapsed();
+
+    qint64 recomputed = graphCore.evaluator().recomputedNodeCount();
+    timer.restart();
+    for (int edit = 0; edit < Edits; ++edit) {
+        const int nodeId = store.findNode(nodeNameTemplate.arg(edit % pipelineCount).arg(0));
+        graphCore.setPortValue(store.findPort(nodeId, GraphStore::InputPort, QStringLiteral("In")), edit + 2.0);
+        graphCore.evaluate();
+    }
+    const qint64 evaluateNs = timer.nsecsElapsed() / Edits;
+    const qint64 evaluateNodes = (graphCore.evaluator().recomputedNodeCount() - recomputed) / Edits;
+
+    recomputed = graphCore.evaluator().recomputedNodeCount();
+    timer.restart();
+    for (int edit = 0; edit < Edits; ++edit) {
+        const int pipeline = edit % pipelineCount;
+        const int firstId = store.findNode(nodeNameTemplate.arg(pipeline).arg(0));
+        graphCore.setPortValue(store.findPort(firstId, GraphStore::InputPort, QStringLiteral("In")), edit + 3.0);
+        const int lastId = store.findNode(nodeNameTemplate.arg(pipeline).arg(length - 1));
+        graphCore.portResult(store.findPort(lastId, GraphStore::OutputPort, QStringLiteral("Out")));
+    }
+    const qint64 pullNs = timer.nsecsElapsed() / Edits;
+    const qint64 pullNodes = (graphCore.evaluator().recomputedNodeCount() - recomputed) / Edits;
+
+    report.addRow({ pipelineCount * length, fullNs / 1000, evaluateNs / 1000, evaluateNodes, pullNs / 1000, pullNodes });
+}
+
+/**
+ * @brief benchmarkLayout computes both layouts of a graph of pipelines on a snapshot of the store,
+ * the times do not include moving the nodes
+ */
+static void benchmarkLayout(BenchmarkReport &report, int nodeCount)
+{
+    static const int Length = 10;
+    GraphCore graphCore;
+    fillPipelines(graphCore, nodeCount / Length, Length);
+    const GraphLayout::Input input = GraphLayout::snapshot(graphCore.store());
+    QElapsedTimer timer;
+
+    timer.start();
+    GraphLayout::layered(input, nullptr);
+    const qint64 layeredNs = timer.nsecsElapsed();
+
+    timer.restart();
+    GraphLayout::forceDirected(input, nullptr, GraphLayout::FrameHandler());
+    const qint64 forceDirectedNs = timer.nsecsElapsed();
+
+    report.addRow({ input.nodeIds.size(), input.edgeSources.size(), layeredNs / 1000000, forceDirectedNs / 1000000 });
+}
+
+/**
+ * @brief benchmarkDrag drags one node of a graph of pipelines through a number of frames,
+ * every frame requests several positions like mouse events do and applies them once
+ */
+static void benchmarkDrag(BenchmarkReport &report, int nodeCount)
+{
+    static const int Length = 10;
+    static const int Frames = 1000;
+    static const int EventsPerFrame = 4;
+    GraphCore graphCore;
+    fillPipelines(graphCore, nodeCount / Length, Length);
+    const QString name = QStringLiteral("Pipeline_0_1");
+    int movedNodes = 0;
+    QObject::connect(&graphCore, &GraphCore::nodeMoved, [&movedNodes]() { ++movedNodes; });
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < Frames; ++frame) {
+        for (int event = 0; event < EventsPerFrame; ++event)
+            graphCore.moveNodesBy({ name }, 1, 1);
+        graphCore.flushMoves();
+    }
+    const qint64 dragNs = timer.nsecsElapsed();
+
+    report.addRow({ graphCore.store().nodeCount(), graphCore.store().connectionCount(),
+                    double(dragNs) / Frames / 1000, movedNodes });
+}
+
+/**
+ * @brief benchmarkPick picks connections of a graph of pipelines at points on their curves,
+ * once through the connection index and once by testing the bounding box of every connection
+ */
+static void benchmarkPick(BenchmarkReport &report, int nodeCount)
+{
+    static const int Length = 10;
+    static const int Picks = 1000;
+    static const qreal Tolerance = 4;
+    GraphCore graphCore;
+    fillPipelines(graphCore, nodeCount / Length, Length);
+    const GraphStore &store = graphCore.store();
+    const QVector<int> connectionIds = graphCore.connectionIds();
+    QVector<QPointF> points;
+    for (int i = 0; i < Picks; ++i) {
+        const int connectionId = connectionIds.at(i * connectionIds.size() / Picks);
+        points.append(GraphStore::curvePoint(store.portAnchor(store.connectionOutput(connectionId)),
+                                             store.portAnchor(store.connectionInput(connectionId)), 0.25));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int hits = 0;
+    for (const QPointF &point : qAsConst(points)) {
+        if (graphCore.connectionIdAt(point, Tolerance) != GraphStore::InvalidId)
+            ++hits;
+    }
+    const qint64 pickNs = timer.nsecsElapsed();
+
+    timer.restart();
+    int candidates = 0;
+    for (const QPointF &point : qAsConst(points)) {
+        const QRectF region(point.x() - Tolerance, point.y() - Tolerance, 2 * Tolerance, 2 * Tolerance);
+        for (int connectionId : connectionIds) {
+            // the curves of a pipeline are flat, so boxes touching the region count like in the index
+            const QRectF rect = store.connectionRect(connectionId);
+            if (rect.left() <= region.right() && region.left() <= rect.right()
+                    && rect.top() <= region.bottom() && region.top() <= rect.bottom())
+                ++candidates;
+        }
+    }
+    const qint64 scanNs = timer.nsecsElapsed();
+    Q_UNUSED(candidates)
+
+    report.addRow({ store.nodeCount(), store.connectionCount(), double(pickNs) / Picks / 1000,
+                    double(scanNs) / Picks / 1000, hits });
+}
+
+/**
+ * @brief residentSetSize returns the resident set size of the process in kilobytes, -1 where unknown
+ */
+static qint64 residentSetSize()
+{
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QFile::ReadOnly))
+        return -1;
+    for (QByteArray line = status.readLine(); !line.isEmpty(); line = status.readLine()) {
+        if (line.startsWith("VmRSS:"))
+            return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+    }
+    return -1;
+}
+
+/**
+ * @brief benchmarkReload replaces a graph by a graph of the same size several times,
+ * the facades of all nodes and ports are requested after every load like a view does
+ */
+static void benchmarkReload(BenchmarkReport &report, int nodeCount)
+{
+    static const int Reloads = 5;
+
+    GraphData data;
+    {
+        GraphCore source;
+        fillGraph(source, nodeCount);
+        data = source.graphData();
+    }
+
+    GraphCore graphCore;
+    const qint64 rssBefore = residentSetSize();
+    QElapsedTimer timer;
+    timer.start();
+    graphCore.setGraphData(data);
+    graphCore.graphNodes();
+    const qint64 firstNs = timer.nsecsElapsed();
+    const qint64 rssLoaded = residentSetSize();
+
+    timer.restart();
+    for (int i = 0; i < Reloads; ++i) {
+        graphCore.setGraphData(data);
+        graphCore.graphNodes();
+    }
+    const qint64 reloadNs = timer.nsecsElapsed() / Reloads;
+    const qint64 rssReloaded = residentSetSize();
+
+    report.addRow({ nodeCount, firstNs / 1000000, reloadNs / 1000000,
+                    rssBefore < 0 ? QVariant() : QVariant((rssLoaded - rssBefore) / 1024.0),
+                    rssBefore < 0 ? QVariant() : QVariant((rssReloaded - rssLoaded) / 1024.0) });
+}
+
+/**
+ * @brief BenchmarkGraphCore gives the benchmarks access to the synchronous file functions
+ */
+class BenchmarkGraphCore : public GraphCore
+{
+public:
+    using GraphCore::saveTo;
+    using GraphCore::loadFrom;
+};
+
+static double perCall(qint64 ns, int calls)
+{
+    return calls > 0 ? double(ns) / calls : 0.0;
+}
+
+/**
+ * @brief benchmarkOperations builds a generated graph call by call through the GraphCore API
+ * and removes it again, half node by node and half in bulk, times are per call or per node
+ */
+static void benchmarkOperations(BenchmarkReport &report, const GraphGenerator::Options &options)
+{
+    const GraphData data = GraphGenerator::generate(options);
+    GraphCore graphCore;
+    const GraphStore &store = graphCore.store();
+    QElapsedTimer timer;
+
+    timer.start();
+    for (const GraphNodeData &node : data.nodes)
+        graphCore.addGraphNode(node.name, node.coord.x(), node.coord.y());
+    const qint64 addNodeNs = timer.nsecsElapsed();
+
+    timer.restart();
+    for (const GraphNodeData &node : data.nodes) {
+        const int nodeId = store.findNode(node.name);
+        for (const GraphPortData &port : node.ports)
+            graphCore.addPort(nodeId, GraphStore::PortType(port.portType), port.name, port.value);
+    }
+    const qint64 addPortNs = timer.nsecsElapsed();
+
+    timer.restart();
+    for (const GraphConnectionData &connection : data.connections)
+        graphCore.addGraphConnection(connection.sourceNode, connection.outputPort, connection.targetNode, connection.inputPort);
+    const qint64 addConnectionNs = timer.nsecsElapsed();
+
+    // the facades are created first, then every port is asked like a view does
+    QVector<GraphNodePort *> ports;
+    for (int portId = 0; portId < store.portCapacity(); ++portId) {
+        if (store.isPort(portId))
+            ports.append(graphCore.portObject(portId));
+    }
+    int connected = 0;
+    timer.restart();
+    for (const GraphNodePort *port : qAsConst(ports))
+        connected += graphCore.hasConnection(port) ? 1 : 0;
+    const qint64 hasConnectionNs = timer.nsecsElapsed();
+
+    const int nodeCount = store.nodeCount();
+    const int portCount = store.portCount();
+    const int connectionCount = store.connectionCount();
+    // the first half of the nodes is removed one by one, the second half at once
+    const int singleCount = data.nodes.size() / 2;
+    timer.restart();
+    for (int i = 0; i < singleCount; ++i)
+        graphCore.removeGraphNode(data.nodes.at(i).name);
+    const qint64 removeNodeNs = timer.nsecsElapsed();
+
+    QStringList bulkNames;
+    for (int i = singleCount; i < data.nodes.size(); ++i)
+        bulkNames.append(data.nodes.at(i).name);
+    timer.restart();
+    graphCore.removeGraphNodes(bulkNames);
+    const qint64 removeNodesNs = timer.nsecsElapsed();
+
+    report.addRow({ GraphGenerator::topologyName(options.topology), nodeCount, portCount, connectionCount, connected,
+                    perCall(addNodeNs, nodeCount), perCall(addPortNs, portCount),
+                    perCall(addConnectionNs, connectionCount), perCall(hasConnectionNs, ports.size()),
+                    perCall(removeNodeNs, singleCount), perCall(removeNodesNs, bulkNames.size()) });
+}
+
+/**
+ * @brief benchmarkFiles saves a generated graph of about the given file size and loads it again
+ * The node count is extrapolated from the file size of a small sample of the same shape
+ * @param directory where the files are written
+ * @param suffix file suffix, selects the format
+ * @param megabytes wanted file size
+ * @param options shape of the graph, the node and connection counts are replaced
+ */
+static void benchmarkFiles(BenchmarkReport &report, const QString &directory, const QString &suffix, int megabytes,
+                           GraphGenerator::Options options)
+{
+    static const int SampleNodes = 1000;
+    const int connectionsPerNode = options.nodeCount > 0 ? options.connectionCount / options.nodeCount : 0;
+    const QString fileName = QDir(directory).filePath(QStringLiteral("benchmark_%1mb.%2").arg(megabytes).arg(suffix));
+
+    options.nodeCount = SampleNodes;
+    options.connectionCount = connectionsPerNode * SampleNodes;
+    qint64 sampleSize = 0;
+    {
+        BenchmarkGraphCore sample;
+        sample.setGraphData(GraphGenerator::generate(options));
+        if (sample.saveTo(fileName))
+            sampleSize = QFileInfo(fileName).size();
+    }
+    if (sampleSize <= 0) {
+        qWarning() << "Unable to write" << fileName;
+        return;
+    }
+    const qint64 nodeCount = qint64(megabytes) * 1024 * 1024 * SampleNodes / sampleSize;
+    options.nodeCount = int(qBound<qint64>(SampleNodes, nodeCount, std::numeric_limits<int>::max() / 16));
+    options.connectionCount = connectionsPerNode * options.nodeCount;
+
+    BenchmarkGraphCore source;
+    source.setGraphData(GraphGenerator::generate(options));
+    QElapsedTimer timer;
+    timer.start();
+    source.saveTo(fileName);
+    const qint64 saveNs = timer.nsecsElapsed();
+    const qint64 size = QFileInfo(fileName).size();
+
+    BenchmarkGraphCore target;
+    timer.restart();
+    target.loadFrom(fileName);
+    const qint64 loadNs = timer.nsecsElapsed();
+
+    const double megabytesWritten = size / (1024.0 * 1024.0);
+    report.addRow({ suffix, source.store().nodeCount(), source.store().connectionCount(), size,
+                    saveNs / 1000000, loadNs / 1000000,
+                    megabytesWritten * 1e9 / qMax<qint64>(saveNs, 1), megabytesWritten * 1e9 / qMax<qint64>(loadNs, 1),
+                    target.store().nodeCount() });
+    QFile::remove(fileName);
+}
+
+/**
+ * @brief parseCounts reads a comma separated list of positive numbers
+ * @return false if some entry is not a positive number
+ */
+static bool parseCounts(const QString &text, QVector<int> *counts)
+{
+    counts->clear();
+    for (const QString &entry : text.split(QLatin1Char(','), QString::SkipEmptyParts)) {
+        bool ok;
+        const int count = entry.trimmed().toInt(&ok);
+        if (!ok || count <= 0)
+            return false;
+        counts->append(count);
+    }
+    return !counts->isEmpty();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const QStringList topologyNames = GraphGenerator::topologyNames();
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Benchmarks of the graph model. Suites: micro measures single "
+                                                    "hot paths, operations builds and removes generated graphs through "
+                                                    "the GraphCore API, files saves and loads generated graphs."));
+    parser.addHelpOption();
+    const QCommandLineOption formatOption(QStringLiteral("format"), QStringLiteral("Output format: text, csv or json."),
+                                          QStringLiteral("format"), QStringLiteral("text"));
+    const QCommandLineOption labelOption(QStringLiteral("label"), QStringLiteral("Label of every csv and json record, e.g. the release."),
+                                         QStringLiteral("label"));
+    const QCommandLineOption suitesOption(QStringLiteral("suites"), QStringLiteral("Comma separated suites to run."),
+                                          QStringLiteral("suites"), QStringLiteral("micro,operations,files"));
+    const QCommandLineOption topologiesOption(QStringLiteral("topologies"),
+                                              QStringLiteral("Comma separated topologies of the operations suite: %1.").arg(topologyNames.join(QStringLiteral(", "))),
+                                              QStringLiteral("topologies"), topologyNames.join(QLatin1Char(',')));
+    const QCommandLineOption nodesOption(QStringLiteral("nodes"), QStringLiteral("Comma separated node counts of the operations suite."),
+                                         QStringLiteral("counts"), QStringLiteral("1000,10000,100000"));
+    const QCommandLineOption portsOption(QStringLiteral("ports"), QStringLiteral("Input ports and output ports per generated node."),
+                                         QStringLiteral("count"), QStringLiteral("4"));
+    const QCommandLineOption edgesOption(QStringLiteral("edges"), QStringLiteral("Connections per generated node."),
+                                         QStringLiteral("count"), QStringLiteral("2"));
+    const QCommandLineOption sizesOption(QStringLiteral("file-sizes"),
+                                         QStringLiteral("Comma separated file sizes in MB of the files suite, e.g. 1,16,128,1024."),
+                                         QStringLiteral("sizes"), QStringLiteral("1,16,128"));
+    const QCommandLineOption seedOption(QStringLiteral("seed"), QStringLiteral("Seed of the graph generator."),
+                                        QStringLiteral("seed"), QStringLiteral("1"));
+    parser.addOptions({ formatOption, labelOption, suitesOption, topologiesOption, nodesOption, portsOption,
+                        edgesOption, sizesOption, seedOption });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    BenchmarkReport::Format format;
+    if (!BenchmarkReport::formatFromName(parser.value(formatOption), &format)) {
+        err << "Unknown format: " << parser.value(formatOption) << "\n";
+        return 1;
+    }
+    const QStringList suites = parser.value(suitesOption).split(QLatin1Char(','), QString::SkipEmptyParts);
+    QVector<GraphGenerator::Topology> topologies;
+    for (const QString &name : parser.value(topologiesOption).split(QLatin1Char(','), QString::SkipEmptyParts)) {
+        GraphGenerator::Topology topology;
+        if (!GraphGenerator::topologyFromName(name.trimmed(), &topology)) {
+            err << "Unknown topology: " << name << "\n";
+            return 1;
+        }
+        topologies.append(topology);
+    }
+    QVector<int> nodeCounts;
+    QVector<int> fileSizes;
+    QVector<int> portCounts;
+    QVector<int> edgeCounts;
+    bool seedOk;
+    const quint32 seed = parser.value(seedOption).toUInt(&seedOk);
+    if (!parseCounts(parser.value(nodesOption), &nodeCounts) || !parseCounts(parser.value(sizesOption), &fileSizes)
+            || !parseCounts(parser.value(portsOption), &portCounts) || !parseCounts(parser.value(edgesOption), &edgeCounts)
+            || !seedOk) {
+        err << "Counts, sizes and the seed must be positive numbers" << "\n";
+        return 1;
+    }
+    GraphGenerator::Options options;
+    options.portsPerDirection = portCounts.first();
+    options.seed = seed;
+
+    QTextStream out(stdout);
+    BenchmarkReport report(&out, format, parser.value(labelOption));
+    report.writeEnvironment();
+
+    if (suites.contains(QStringLiteral("micro"))) {
+        report.beginTable(QStringLiteral("is_connected"), QStringLiteral("isConnected() over all ports, times in microseconds"),
+                          { "nodes", "ports", "conns", "indexed_us", "scan_us", "speedup" });
+        for (int nodeCount : { 100, 500, 1000, 2000, 4000 })
+            benchmarkIsConnected(report, nodeCount);
+
+        report.beginTable(QStringLiteral("traversal"), QStringLiteral("port degree traversal of the whole graph, times in microseconds"),
+                          { "nodes", "ports", "conns", "store_us", "facades_us", "speedup" });
+        for (int nodeCount : { 1000, 10000, 50000 })
+            benchmarkTraversal(report, nodeCount);
+
+        report.beginTable(QStringLiteral("reload"), QStringLiteral("loading and reloading a graph, times in milliseconds, resident memory growth in MB"),
+                          { "nodes", "first_ms", "reload_ms", "rss_load_mb", "rss_reloads_mb" });
+        for (int nodeCount : { 1000, 10000, 50000 })
+            benchmarkReload(report, nodeCount);
+
+        report.beginTable(QStringLiteral("evaluate"), QStringLiteral("evaluation of 64 independent pipelines, times in microseconds"),
+                          { "nodes", "threads", "one_thread_us", "pool_us", "speedup" });
+        for (int length : { 16, 160, 1600 })
+            benchmarkEvaluate(report, 64, length);
+
+        report.beginTable(QStringLiteral("kernels"), QStringLiteral("evaluation of 4 levels of expression nodes, times in microseconds"),
+                          { "nodes", "parsed", "first_us", "node_by_node_us", "batched_us", "speedup" });
+        for (int pipelineCount : { 1024, 8192, 65536 })
+            benchmarkKernels(report, pipelineCount);
+
+        report.beginTable(QStringLiteral("incremental"), QStringLiteral("one edited value in 64 pipelines, times in microseconds, per edit"),
+                          { "nodes", "full_us", "evaluate_us", "evaluated", "pull_us", "pulled" });
+        for (int length : { 16, 160, 1600 })
+            benchmarkIncremental(report, 64, length);
+
+        report.beginTable(QStringLiteral("layout"), QStringLiteral("automatic layout of pipelines, times in milliseconds"),
+                          { "nodes", "conns", "layered_ms", "force_ms" });
+        for (int nodeCount : { 1000, 10000, 100000 })
+            benchmarkLayout(report, nodeCount);
+
+        report.beginTable(QStringLiteral("drag"), QStringLiteral("dragging one node, times in microseconds per frame"),
+                          { "nodes", "conns", "frame_us", "moved" });
+        for (int nodeCount : { 10, 10000, 100000 })
+            benchmarkDrag(report, nodeCount);
+
+        report.beginTable(QStringLiteral("pick"), QStringLiteral("picking connections under the cursor, times in microseconds per pick"),
+                          { "nodes", "conns", "index_us", "scan_us", "hits" });
+        for (int nodeCount : { 1000, 10000, 100000 })
+            benchmarkPick(report, nodeCount);
+    }
+
+    if (suites.contains(QStringLiteral("operations"))) {
+        report.beginTable(QStringLiteral("operations"), QStringLiteral("building and removing generated graphs, times in nanoseconds per call"),
+                          { "topology", "nodes", "ports", "conns", "connected", "add_node_ns", "add_port_ns",
+                            "add_conn_ns", "has_conn_ns", "remove_node_ns", "bulk_remove_ns" });
+        for (GraphGenerator::Topology topology : qAsConst(topologies)) {
+            for (int nodeCount : qAsConst(nodeCounts)) {
+                options.topology = topology;
+                options.nodeCount = nodeCount;
+                options.connectionCount = edgeCounts.first() * nodeCount;
+                benchmarkOperations(report, options);
+            }
+        }
+    }
+
+    if (suites.contains(QStringLiteral("files"))) {
+        QTemporaryDir directory;
+        if (!directory.isValid()) {
+            err << "Unable to create a temporary directory" << "\n";
+            return 1;
+        }
+        report.beginTable(QStringLiteral("files"), QStringLiteral("saving and loading generated random graphs, times in milliseconds, rates in MB/s"),
+                          { "format", "nodes", "conns", "bytes", "save_ms", "load_ms", "save_mbps", "load_mbps", "loaded_nodes" });
+        options.topology = GraphGenerator::RandomTopology;
+        options.nodeCount = 1;
+        options.connectionCount = edgeCounts.first();
+        for (int megabytes : qAsConst(fileSizes)) {
+            for (const QString &suffix : { QStringLiteral("json"), GraphBinaryFormat::fileSuffix() })
+                benchmarkFiles(report, directory.path(), suffix, megabytes, options);
+        }
+    }
+
+    return 0;
+}
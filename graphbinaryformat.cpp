@@ -0,0 +1,478 @@
+#include "graphbinaryformat.h"
+
+#include "graphnodeport.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QHash>
+#include <QtEndian>
+#include <QtNumeric>
+
+#include <cstring>
+#include <limits>
+
+/**
+ * @brief The GraphBinaryFormat class reads and writes the compact binary graph file
+ *
+ * All numbers are little endian, every section starts at an 8 byte boundary:
+ *  - FileHeader
+ *  - string table: StringEntry[stringCount] followed by the UTF-8 bytes of all strings,
+ *    every node name, port name and string value is stored once
+ *  - NodeRecord[nodeCount], the ports of a node are a contiguous range of the port records
+ *  - PortRecord[portCount]
+ *  - ConnectionRecord[connectionCount], referring to ports by their index
+ *
+ * Reading maps the file into memory and builds the graph straight from the records.
+ */
+
+namespace {
+
+const char Magic[4] = { 'G', 'V', 'B', 'F' };
+
+enum ValueType : quint8 {
+    InvalidValue = 0, BoolValue, IntValue, DoubleValue, StringValue
+};
+
+struct FileHeader
+{
+    char magic[4];
+    quint32 version;
+    quint64 zoomFactor;     // bits of a double
+    quint32 stringCount;
+    quint32 nodeCount;
+    quint32 portCount;
+    quint32 connectionCount;
+    quint64 stringTableOffset;
+    quint64 nodeOffset;
+    quint64 portOffset;
+    quint64 connectionOffset;
+};
+
+struct StringEntry
+{
+    quint32 offset;         // relative to the first byte after the entries
+    quint32 size;
+};
+
+struct NodeRecord
+{
+    quint32 nameId;
+    quint32 firstPort;
+    quint32 portCount;
+    quint32 reserved;
+    quint64 x;              // bits of a double
+    quint64 y;              // bits of a double
+};
+
+struct PortRecord
+{
+    quint32 nameId;
+    quint8 portType;
+    quint8 valueType;
+    quint16 reserved;
+    quint64 value;          // integer, bits of a double or string id depending on valueType
+};
+
+struct ConnectionRecord
+{
+    quint32 outputPort;
+    quint32 inputPort;
+};
+
+Q_STATIC_ASSERT(sizeof(FileHeader) == 64);
+Q_STATIC_ASSERT(sizeof(StringEntry) == 8);
+Q_STATIC_ASSERT(sizeof(NodeRecord) == 32);
+Q_STATIC_ASSERT(sizeof(PortRecord) == 16);
+Q_STATIC_ASSERT(sizeof(ConnectionRecord) == 8);
+
+inline quint64 doubleToBits(double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return qToLittleEndian(bits);
+}
+
+inline double bitsToDouble(quint64 bits)
+{
+    bits = qFromLittleEndian(bits);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline quint64 align8(quint64 offset)
+{
+    return (offset + 7) & ~quint64(7);
+}
+
+class StringTable
+{
+public:
+    quint32 intern(const QString &str)
+    {
+        auto it = m_ids.constFind(str);
+        if (it != m_ids.constEnd())
+            return it.value();
+        const quint32 id = quint32(m_strings.size());
+        m_ids.insert(str, id);
+        m_strings.append(str.toUtf8());
+        return id;
+    }
+    inline const QVector<QByteArray> &strings() const { return m_strings; }
+
+private:
+    QHash<QString, quint32> m_ids;
+    QVector<QByteArray> m_strings;
+};
+
+bool writeBytes(QIODevice &file, const void *data, qint64 size)
+{
+    return size == 0 || file.write(static_cast<const char *>(data), size) == size;
+}
+
+bool writePadding(QIODevice &file, quint64 offset)
+{
+    static const char zeros[8] = {};
+    const qint64 padding = qint64(align8(offset) - offset);
+    return writeBytes(file, zeros, padding);
+}
+
+} // namespace
+
+/**
+ * @brief GraphBinaryFormat::fileSuffix returns the file suffix of the binary format
+ */
+QString GraphBinaryFormat::fileSuffix()
+{
+    return QStringLiteral("gvb");
+}
+
+/**
+ * @brief GraphBinaryFormat::isBinaryFileName checks if the file should be stored in the binary format
+ * @param fileName file name
+ */
+bool GraphBinaryFormat::isBinaryFileName(const QString &fileName)
+{
+    return QFileInfo(fileName).suffix().compare(fileSuffix(), Qt::CaseInsensitive) == 0;
+}
+
+/**
+ * @brief GraphBinaryFormat::write stores the graph in the binary format
+ * The target file is replaced only when the whole file has been written
+ * @param data graph data
+ * @param fileName file name
+ * @param errorString receives a description of the error
+ * @return result of saving
+ */
+bool GraphBinaryFormat::write(const GraphData &data, const QString &fileName, QString *errorString)
+{
+    StringTable strings;
+    QVector<NodeRecord> nodes;
+    QVector<PortRecord> ports;
+    QVector<ConnectionRecord> connections;
+    // port indices by node and port name, output and input ports may share a name
+    QHash<QString, QHash<QString, quint32>> outputPorts;
+    QHash<QString, QHash<QString, quint32>> inputPorts;
+
+    nodes.reserve(data.nodes.size());
+    for (const GraphNodeData &node : data.nodes) {
+        NodeRecord nodeRecord;
+        nodeRecord.nameId = qToLittleEndian(strings.intern(node.name));
+        nodeRecord.firstPort = qToLittleEndian(quint32(ports.size()));
+        nodeRecord.portCount = qToLittleEndian(quint32(node.ports.size()));
+        nodeRecord.reserved = 0;
+        nodeRecord.x = doubleToBits(node.coord.x());
+        nodeRecord.y = doubleToBits(node.coord.y());
+        nodes.append(nodeRecord);
+
+        QHash<QString, quint32> &nodeOutputs = outputPorts[node.name];
+        QHash<QString, quint32> &nodeInputs = inputPorts[node.name];
+        for (const GraphPortData &port : node.ports) {
+            PortRecord portRecord;
+            portRecord.nameId = qToLittleEndian(strings.intern(port.name));
+            portRecord.portType = quint8(port.portType);
+            portRecord.reserved = 0;
+            switch (port.value.type()) {
+            case QVariant::Invalid:
+                portRecord.valueType = InvalidValue;
+                portRecord.value = 0;
+                break;
+            case QVariant::Bool:
+                portRecord.valueType = BoolValue;
+                portRecord.value = qToLittleEndian(quint64(port.value.toBool() ? 1 : 0));
+                break;
+            case QVariant::Int:
+            case QVariant::UInt:
+            case QVariant::LongLong:
+                portRecord.valueType = IntValue;
+                portRecord.value = qToLittleEndian(quint64(port.value.toLongLong()));
+                break;
+            case QVariant::Double:
+                portRecord.valueType = DoubleValue;
+                portRecord.value = doubleToBits(port.value.toDouble());
+                break;
+            default:
+                portRecord.valueType = StringValue;
+                portRecord.value = qToLittleEndian(quint64(strings.intern(port.value.toString())));
+                break;
+            }
+            (port.portType == GraphNodePort::OutputPort ? nodeOutputs : nodeInputs).insert(port.name, quint32(ports.size()));
+            ports.append(portRecord);
+        }
+    }
+
+    connections.reserve(data.connections.size());
+    for (const GraphConnectionData &conn : data.connections) {
+        const auto outNode = outputPorts.constFind(conn.sourceNode);
+        const auto inNode = inputPorts.constFind(conn.targetNode);
+        if (outNode == outputPorts.constEnd() || !outNode->contains(conn.outputPort)
+                || inNode == inputPorts.constEnd() || !inNode->contains(conn.inputPort)) {
+            *errorString = tr("Connection %1.%2->%3.%4 refers to a missing port")
+                    .arg(conn.sourceNode, conn.outputPort, conn.targetNode, conn.inputPort);
+            return false;
+        }
+        ConnectionRecord connectionRecord;
+        connectionRecord.outputPort = qToLittleEndian(outNode->value(conn.outputPort));
+        connectionRecord.inputPort = qToLittleEndian(inNode->value(conn.inputPort));
+        connections.append(connectionRecord);
+    }
+
+    const QVector<QByteArray> &stringList = strings.strings();
+    QVector<StringEntry> stringEntries;
+    stringEntries.reserve(stringList.size());
+    quint64 blobSize = 0;
+    for (const QByteArray &str : stringList) {
+        StringEntry entry;
+        entry.offset = qToLittleEndian(quint32(blobSize));
+        entry.size = qToLittleEndian(quint32(str.size()));
+        stringEntries.append(entry);
+        blobSize += quint64(str.size());
+    }
+    if (blobSize > std::numeric_limits<quint32>::max()) {
+        *errorString = tr("String table exceeds 4 GB");
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = qToLittleEndian(Version);
+    header.zoomFactor = doubleToBits(data.zoomFactor);
+    header.stringCount = qToLittleEndian(quint32(stringList.size()));
+    header.nodeCount = qToLittleEndian(quint32(nodes.size()));
+    header.portCount = qToLittleEndian(quint32(ports.size()));
+    header.connectionCount = qToLittleEndian(quint32(connections.size()));
+    const quint64 stringTableOffset = sizeof(FileHeader);
+    const quint64 blobEnd = stringTableOffset + quint64(stringEntries.size()) * sizeof(StringEntry) + blobSize;
+    const quint64 nodeOffset = align8(blobEnd);
+    const quint64 portOffset = nodeOffset + quint64(nodes.size()) * sizeof(NodeRecord);
+    const quint64 connectionOffset = portOffset + quint64(ports.size()) * sizeof(PortRecord);
+    header.stringTableOffset = qToLittleEndian(stringTableOffset);
+    header.nodeOffset = qToLittleEndian(nodeOffset);
+    header.portOffset = qToLittleEndian(portOffset);
+    header.connectionOffset = qToLittleEndian(connectionOffset);
+
+    QSaveFile outputFile(fileName);
+    if (!outputFile.open(QFile::WriteOnly)) {
+        *errorString = tr("Unable to open file '%1'").arg(fileName);
+        return false;
+    }
+
+    bool ok = writeBytes(outputFile, &header, sizeof(header))
+            && writeBytes(outputFile, stringEntries.constData(), qint64(stringEntries.size()) * qint64(sizeof(StringEntry)));
+    for (int i = 0; ok && i < stringList.size(); ++i)
+        ok = writeBytes(outputFile, stringList.at(i).constData(), stringList.at(i).size());
+    ok = ok && writePadding(outputFile, blobEnd)
+            && writeBytes(outputFile, nodes.constData(), qint64(nodes.size()) * qint64(sizeof(NodeRecord)))
+            && writeBytes(outputFile, ports.constData(), qint64(ports.size()) * qint64(sizeof(PortRecord)))
+            && writeBytes(outputFile, connections.constData(), qint64(connections.size()) * qint64(sizeof(ConnectionRecord)))
+            && outputFile.commit();
+    if (!ok) {
+        *errorString = tr("Unable to write file '%1': %2").arg(fileName, outputFile.errorString());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief GraphBinaryFormat::read loads a graph stored in the binary format
+ * The file is memory mapped, if mapping is not possible it is read at once
+ * @param fileName file name
+ * @param data receives the graph
+ * @param errorString receives a description of the error
+ * @return result of loading
+ */
+bool GraphBinaryFormat::read(const QString &fileName, GraphData *data, QString *errorString)
+{
+    QFile inputFile(fileName);
+    if (!inputFile.open(QFile::ReadOnly)) {
+        *errorString = tr("Unable to open file '%1'").arg(fileName);
+        return false;
+    }
+
+    const qint64 size = inputFile.size();
+    if (size < qint64(sizeof(FileHeader))) {
+        *errorString = tr("File '%1' does not contain proper data").arg(fileName);
+        return false;
+    }
+
+    if (const uchar *mapped = inputFile.map(0, size)) {
+        const bool ok = parse(mapped, quint64(size), data, errorString);
+        inputFile.unmap(const_cast<uchar *>(mapped));
+        return ok;
+    }
+
+    const QByteArray content = inputFile.readAll();
+    return parse(reinterpret_cast<const uchar *>(content.constData()), quint64(content.size()), data, errorString);
+}
+
+/**
+ * @brief GraphBinaryFormat::parse validates the sections of a binary file and converts the records
+ */
+bool GraphBinaryFormat::parse(const uchar *buffer, quint64 size, GraphData *data, QString *errorString)
+{
+    const FileHeader *header = reinterpret_cast<const FileHeader *>(buffer);
+    if (std::memcmp(header->magic, Magic, sizeof(Magic)) != 0) {
+        *errorString = tr("Not a graph binary file");
+        return false;
+    }
+    const quint32 version = qFromLittleEndian(header->version);
+    if (version != Version) {
+        *errorString = tr("Unsupported graph binary file version %1").arg(version);
+        return false;
+    }
+
+    const quint32 stringCount = qFromLittleEndian(header->stringCount);
+    const quint32 nodeCount = qFromLittleEndian(header->nodeCount);
+    const quint32 portCount = qFromLittleEndian(header->portCount);
+    const quint32 connectionCount = qFromLittleEndian(header->connectionCount);
+    const quint64 stringTableOffset = qFromLittleEndian(header->stringTableOffset);
+    const quint64 nodeOffset = qFromLittleEndian(header->nodeOffset);
+    const quint64 portOffset = qFromLittleEndian(header->portOffset);
+    const quint64 connectionOffset = qFromLittleEndian(header->connectionOffset);
+
+    auto validSection = [size](quint64 offset, quint64 count, quint64 recordSize) {
+        return offset % 8 == 0 && offset <= size && count * recordSize <= size - offset;
+    };
+    if (!validSection(stringTableOffset, stringCount, sizeof(StringEntry))
+            || !validSection(nodeOffset, nodeCount, sizeof(NodeRecord))
+            || !validSection(portOffset, portCount, sizeof(PortRecord))
+            || !validSection(connectionOffset, connectionCount, sizeof(ConnectionRecord))) {
+        *errorString = tr("Graph binary file is truncated or corrupted");
+        return false;
+    }
+
+    // every string is decoded once, nodes and ports share the decoded copies
+    const StringEntry *entries = reinterpret_cast<const StringEntry *>(buffer + stringTableOffset);
+    const quint64 blobOffset = stringTableOffset + quint64(stringCount) * sizeof(StringEntry);
+    QVector<QString> strings;
+    strings.reserve(int(stringCount));
+    for (quint32 i = 0; i < stringCount; ++i) {
+        const quint64 offset = blobOffset + qFromLittleEndian(entries[i].offset);
+        const quint32 length = qFromLittleEndian(entries[i].size);
+        if (offset > size || length > size - offset) {
+            *errorString = tr("Graph binary file has a corrupted string table");
+            return false;
+        }
+        strings.append(QString::fromUtf8(reinterpret_cast<const char *>(buffer + offset), int(length)));
+    }
+    auto string = [&strings, stringCount](quint32 id, bool *ok) -> QString {
+        if (id >= stringCount) {
+            *ok = false;
+            return QString();
+        }
+        return strings.at(int(id));
+    };
+
+    data->zoomFactor = bitsToDouble(header->zoomFactor);
+    bool ok = qIsFinite(data->zoomFactor);
+    data->nodes.clear();
+    data->connections.clear();
+    data->nodes.reserve(int(nodeCount));
+    data->connections.reserve(int(connectionCount));
+
+    // index of the owning node for every port, to resolve connections
+    QVector<quint32> portNodes(int(portCount), nodeCount);
+    const NodeRecord *nodes = reinterpret_cast<const NodeRecord *>(buffer + nodeOffset);
+    const PortRecord *ports = reinterpret_cast<const PortRecord *>(buffer + portOffset);
+    for (quint32 n = 0; ok && n < nodeCount; ++n) {
+        const NodeRecord &nodeRecord = nodes[n];
+        const quint32 firstPort = qFromLittleEndian(nodeRecord.firstPort);
+        const quint32 nodePortCount = qFromLittleEndian(nodeRecord.portCount);
+        if (firstPort > portCount || nodePortCount > portCount - firstPort) {
+            ok = false;
+            break;
+        }
+
+        GraphNodeData node;
+        node.name = string(qFromLittleEndian(nodeRecord.nameId), &ok);
+        node.coord = QPointF(bitsToDouble(nodeRecord.x), bitsToDouble(nodeRecord.y));
+        // the writer only stores finite positions, anything else is corruption
+        if (!qIsFinite(node.coord.x()) || !qIsFinite(node.coord.y())) {
+            ok = false;
+            break;
+        }
+        node.ports.reserve(int(nodePortCount));
+        for (quint32 p = firstPort; ok && p < firstPort + nodePortCount; ++p) {
+            const PortRecord &portRecord = ports[p];
+            GraphPortData port;
+            port.name = string(qFromLittleEndian(portRecord.nameId), &ok);
+            port.portType = portRecord.portType;
+            if (!GraphStore::isPortType(port.portType))
+                qWarning() << "Port" << port.name << "has the unknown type" << port.portType;
+            const quint64 value = qFromLittleEndian(portRecord.value);
+            switch (portRecord.valueType) {
+            case InvalidValue:
+                break;
+            case BoolValue:
+                port.value = value != 0;
+                break;
+            case IntValue: {
+                const qint64 intValue = qint64(value);
+                if (intValue >= std::numeric_limits<int>::min() && intValue <= std::numeric_limits<int>::max())
+                    port.value = int(intValue);
+                else
+                    port.value = intValue;
+                break;
+            }
+            case DoubleValue:
+                port.value = bitsToDouble(portRecord.value);
+                break;
+            case StringValue:
+                ok = value <= std::numeric_limits<quint32>::max();
+                if (ok)
+                    port.value = string(quint32(value), &ok);
+                break;
+            default:
+                ok = false;
+                break;
+            }
+            portNodes[int(p)] = n;
+            node.ports.append(port);
+        }
+        data->nodes.append(node);
+    }
+
+    const ConnectionRecord *connections = reinterpret_cast<const ConnectionRecord *>(buffer + connectionOffset);
+    for (quint32 c = 0; ok && c < connectionCount; ++c) {
+        const quint32 out = qFromLittleEndian(connections[c].outputPort);
+        const quint32 in = qFromLittleEndian(connections[c].inputPort);
+        if (out >= portCount || in >= portCount || portNodes.at(int(out)) >= nodeCount || portNodes.at(int(in)) >= nodeCount) {
+            ok = false;
+            break;
+        }
+        GraphConnectionData conn;
+        conn.sourceNode = data->nodes.at(int(portNodes.at(int(out)))).name;
+        conn.outputPort = strings.at(int(qFromLittleEndian(ports[out].nameId)));
+        conn.targetNode = data->nodes.at(int(portNodes.at(int(in)))).name;
+        conn.inputPort = strings.at(int(qFromLittleEndian(ports[in].nameId)));
+        data->connections.append(conn);
+    }
+
+    if (!ok) {
+        *errorString = tr("Graph binary file is truncated or corrupted");
+        return false;
+    }
+    return true;
+}
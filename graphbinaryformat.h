@@ -0,0 +1,22 @@
+#pragma once
+
+#include "graphdata.h"
+
+#include <QCoreApplication>
+
+class GraphBinaryFormat
+{
+    Q_DECLARE_TR_FUNCTIONS(GraphBinaryFormat)
+
+public:
+    static const quint32 Version = 1;
+
+    static QString fileSuffix();
+    static bool isBinaryFileName(const QString &fileName);
+
+    static bool write(const GraphData &data, const QString &fileName, QString *errorString);
+    static bool read(const QString &fileName, GraphData *data, QString *errorString);
+
+private:
+    static bool parse(const uchar *buffer, quint64 size, GraphData *data, QString *errorString);
+};
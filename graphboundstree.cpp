@@ -0,0 +1,326 @@
+#include "graphboundstree.h"
+
+/**
+ * @brief The GraphBoundsTree class is a bounding-volume hierarchy over the boxes of graph elements
+ * Every box is a leaf of a balanced binary tree whose inner nodes bound their two children.
+ * Leaves are stored grown by a margin, so an update that keeps the box inside the grown
+ * one only replaces the box, larger moves remove the leaf and insert it again.
+ * Leaves are inserted next to the sibling that grows the tree the least and the tree is
+ * rebalanced by rotations on the way up, so insert, update and remove take O(log n) and
+ * a region query visits O(log n + k) nodes.
+ * Unlike GraphQuadTree the boxes may be long and thin, like the ones of connections
+ * spanning the scene, without ending up in the root.
+ */
+
+/**
+ * @brief GraphBoundsTree::GraphBoundsTree ctor
+ * @param margin leaves are grown by this much, boxes moving less are updated in place
+ */
+GraphBoundsTree::GraphBoundsTree(qreal margin)
+    : m_margin(margin)
+{
+}
+
+/**
+ * @brief GraphBoundsTree::height returns the number of levels below the root, 0 for a single leaf
+ */
+int GraphBoundsTree::height() const
+{
+    return m_root < 0 ? 0 : m_nodes.at(m_root).height;
+}
+
+QRectF GraphBoundsTree::rect(int item) const
+{
+    const int leaf = m_leafIndex.value(item, -1);
+    return leaf < 0 ? QRectF() : m_nodes.at(leaf).rect;
+}
+
+/**
+ * @brief GraphBoundsTree::insert adds a box to the tree, an item already in the tree is moved
+ * @param item element handle
+ * @param rect bounding box in scene coordinates
+ */
+void GraphBoundsTree::insert(int item, const QRectF &rect)
+{
+    if (m_leafIndex.contains(item)) {
+        update(item, rect);
+        return;
+    }
+
+    const int leaf = allocateNode();
+    Node &node = m_nodes[leaf];
+    node.item = item;
+    node.rect = rect;
+    node.bounds = rect.adjusted(-m_margin, -m_margin, m_margin, m_margin);
+    m_leafIndex.insert(item, leaf);
+    insertLeaf(leaf);
+}
+
+/**
+ * @brief GraphBoundsTree::update replaces the box of an item
+ * The tree is only restructured if the box leaves the grown box of its leaf
+ * @param item element handle
+ * @param rect bounding box in scene coordinates
+ */
+void GraphBoundsTree::update(int item, const QRectF &rect)
+{
+    const int leaf = m_leafIndex.value(item, -1);
+    if (leaf < 0) {
+        insert(item, rect);
+        return;
+    }
+
+    Node &node = m_nodes[leaf];
+    node.rect = rect;
+    if (encloses(node.bounds, rect))
+        return;
+
+    removeLeaf(leaf);
+    m_nodes[leaf].bounds = rect.adjusted(-m_margin, -m_margin, m_margin, m_margin);
+    insertLeaf(leaf);
+}
+
+/**
+ * @brief GraphBoundsTree::remove removes the box of an item
+ * @return false if the item is not in the tree
+ */
+bool GraphBoundsTree::remove(int item)
+{
+    const int leaf = m_leafIndex.value(item, -1);
+    if (leaf < 0)
+        return false;
+
+    m_leafIndex.remove(item);
+    removeLeaf(leaf);
+    freeNode(leaf);
+    return true;
+}
+
+/**
+ * @brief GraphBoundsTree::clear removes all boxes, the node table keeps its capacity
+ */
+void GraphBoundsTree::clear()
+{
+    m_root = -1;
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_leafIndex.clear();
+}
+
+/**
+ * @brief GraphBoundsTree::query returns the items whose boxes intersect the region
+ * Boxes touching the region count, so boxes of zero width or height are found as well
+ * @param rect region in scene coordinates
+ */
+QVector<int> GraphBoundsTree::query(const QRectF &rect) const
+{
+    QVector<int> items;
+    if (m_root < 0)
+        return items;
+
+    QVector<int> stack;
+    stack.append(m_root);
+    while (!stack.isEmpty()) {
+        const Node &node = m_nodes.at(stack.takeLast());
+        if (!overlaps(node.bounds, rect))
+            continue;
+        if (node.isLeaf()) {
+            if (overlaps(node.rect, rect))
+                items.append(node.item);
+        } else {
+            stack.append(node.children[0]);
+            stack.append(node.children[1]);
+        }
+    }
+    return items;
+}
+
+int GraphBoundsTree::allocateNode()
+{
+    if (!m_freeNodes.isEmpty()) {
+        const int index = m_freeNodes.takeLast();
+        m_nodes[index] = Node();
+        return index;
+    }
+    m_nodes.append(Node());
+    return m_nodes.size() - 1;
+}
+
+void GraphBoundsTree::freeNode(int index)
+{
+    m_nodes[index].height = -1;
+    m_freeNodes.append(index);
+}
+
+/**
+ * @brief GraphBoundsTree::insertLeaf links a leaf next to the sibling that grows the perimeters the least
+ */
+void GraphBoundsTree::insertLeaf(int leaf)
+{
+    if (m_root < 0) {
+        m_root = leaf;
+        m_nodes[leaf].parent = -1;
+        return;
+    }
+
+    const QRectF leafBounds = m_nodes.at(leaf).bounds;
+    int index = m_root;
+    while (!m_nodes.at(index).isLeaf()) {
+        const Node &node = m_nodes.at(index);
+        const qreal combined = perimeter(unite(node.bounds, leafBounds));
+        // cost of a new parent for this node and the leaf, and of pushing the leaf further down
+        const qreal cost = 2 * combined;
+        const qreal inheritance = 2 * (combined - perimeter(node.bounds));
+        qreal childCosts[2];
+        for (int i = 0; i < 2; ++i) {
+            const Node &child = m_nodes.at(node.children[i]);
+            childCosts[i] = perimeter(unite(child.bounds, leafBounds)) + inheritance;
+            if (!child.isLeaf())
+                childCosts[i] -= perimeter(child.bounds);
+        }
+        if (cost < childCosts[0] && cost < childCosts[1])
+            break;
+        index = childCosts[0] < childCosts[1] ? node.children[0] : node.children[1];
+    }
+
+    const int sibling = index;
+    const int oldParent = m_nodes.at(sibling).parent;
+    const int newParent = allocateNode();
+    Node &parent = m_nodes[newParent];
+    parent.parent = oldParent;
+    parent.bounds = unite(m_nodes.at(sibling).bounds, leafBounds);
+    parent.height = m_nodes.at(sibling).height + 1;
+    parent.children[0] = sibling;
+    parent.children[1] = leaf;
+    if (oldParent >= 0)
+        replaceChild(oldParent, sibling, newParent);
+    else
+        m_root = newParent;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    refit(oldParent);
+}
+
+/**
+ * @brief GraphBoundsTree::removeLeaf unlinks a leaf, its sibling takes the place of their parent
+ */
+void GraphBoundsTree::removeLeaf(int leaf)
+{
+    if (leaf == m_root) {
+        m_root = -1;
+        return;
+    }
+
+    const int parent = m_nodes.at(leaf).parent;
+    const int grandParent = m_nodes.at(parent).parent;
+    const int sibling = m_nodes.at(parent).children[0] == leaf ? m_nodes.at(parent).children[1]
+                                                                : m_nodes.at(parent).children[0];
+    m_nodes[sibling].parent = grandParent;
+    if (grandParent >= 0)
+        replaceChild(grandParent, parent, sibling);
+    else
+        m_root = sibling;
+    freeNode(parent);
+    m_nodes[leaf].parent = -1;
+
+    refit(grandParent);
+}
+
+/**
+ * @brief GraphBoundsTree::refit recomputes the bounds and heights from a node up to the root,
+ * rebalancing every node on the way
+ */
+void GraphBoundsTree::refit(int index)
+{
+    while (index >= 0) {
+        index = balance(index);
+        Node &node = m_nodes[index];
+        const Node &first = m_nodes.at(node.children[0]);
+        const Node &second = m_nodes.at(node.children[1]);
+        node.height = 1 + qMax(first.height, second.height);
+        node.bounds = unite(first.bounds, second.bounds);
+        index = node.parent;
+    }
+}
+
+/**
+ * @brief GraphBoundsTree::balance rotates the higher child of a node up if the heights
+ * of the children differ by more than one
+ * @return the node now at the place of the given one
+ */
+int GraphBoundsTree::balance(int index)
+{
+    Node &a = m_nodes[index];
+    if (a.isLeaf() || a.height < 2)
+        return index;
+
+    // the higher child c replaces a, a keeps the lower child b and the lower grandchild of c
+    const int heightDifference = m_nodes.at(a.children[1]).height - m_nodes.at(a.children[0]).height;
+    if (qAbs(heightDifference) <= 1)
+        return index;
+
+    const int higher = heightDifference > 0 ? 1 : 0;
+    const int cIndex = a.children[higher];
+    const int bIndex = a.children[1 - higher];
+    Node &b = m_nodes[bIndex];
+    Node &c = m_nodes[cIndex];
+    const int fIndex = c.children[0];
+    const int gIndex = c.children[1];
+    Node &f = m_nodes[fIndex];
+    Node &g = m_nodes[gIndex];
+
+    c.parent = a.parent;
+    if (c.parent >= 0)
+        replaceChild(c.parent, index, cIndex);
+    else
+        m_root = cIndex;
+    a.parent = cIndex;
+
+    const bool keepF = f.height > g.height;
+    const int keptIndex = keepF ? fIndex : gIndex;
+    const int movedIndex = keepF ? gIndex : fIndex;
+    Node &kept = keepF ? f : g;
+    Node &moved = keepF ? g : f;
+    c.children[0] = index;
+    c.children[1] = keptIndex;
+    a.children[higher] = movedIndex;
+    moved.parent = index;
+
+    a.bounds = unite(b.bounds, moved.bounds);
+    a.height = 1 + qMax(b.height, moved.height);
+    c.bounds = unite(a.bounds, kept.bounds);
+    c.height = 1 + qMax(a.height, kept.height);
+    return cIndex;
+}
+
+void GraphBoundsTree::replaceChild(int parent, int oldChild, int newChild)
+{
+    Node &node = m_nodes[parent];
+    if (node.children[0] == oldChild)
+        node.children[0] = newChild;
+    else
+        node.children[1] = newChild;
+}
+
+/**
+ * @brief GraphBoundsTree::unite returns the box around both boxes, unlike QRectF::united()
+ * boxes of zero width or height are not ignored
+ */
+QRectF GraphBoundsTree::unite(const QRectF &a, const QRectF &b)
+{
+    const qreal left = qMin(a.left(), b.left());
+    const qreal top = qMin(a.top(), b.top());
+    return QRectF(left, top, qMax(a.right(), b.right()) - left, qMax(a.bottom(), b.bottom()) - top);
+}
+
+bool GraphBoundsTree::encloses(const QRectF &outer, const QRectF &inner)
+{
+    return outer.left() <= inner.left() && inner.right() <= outer.right()
+           && outer.top() <= inner.top() && inner.bottom() <= outer.bottom();
+}
+
+bool GraphBoundsTree::overlaps(const QRectF &a, const QRectF &b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QHash>
+#include <QRectF>
+#include <QVector>
+
+class GraphBoundsTree
+{
+public:
+    explicit GraphBoundsTree(qreal margin = 32);
+
+    inline int size() const { return m_leafIndex.size(); }
+    inline bool contains(int item) const { return m_leafIndex.contains(item); }
+    int height() const;
+    QRectF rect(int item) const;
+
+    void insert(int item, const QRectF &rect);
+    void update(int item, const QRectF &rect);
+    bool remove(int item);
+    void clear();
+
+    QVector<int> query(const QRectF &rect) const;
+
+private:
+    struct Node
+    {
+        // leaves: the box grown by the margin, inner nodes: the union of both children
+        QRectF bounds;
+        // leaves only: the box of the item
+        QRectF rect;
+        int parent = -1;
+        int children[2] = { -1, -1 };
+        int height = 0;
+        int item = -1;
+        inline bool isLeaf() const { return children[0] < 0; }
+    };
+
+    int allocateNode();
+    void freeNode(int index);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    void refit(int index);
+    int balance(int index);
+    void replaceChild(int parent, int oldChild, int newChild);
+
+    static QRectF unite(const QRectF &a, const QRectF &b);
+    static bool encloses(const QRectF &outer, const QRectF &inner);
+    static bool overlaps(const QRectF &a, const QRectF &b);
+    static inline qreal perimeter(const QRectF &rect) { return 2 * (rect.width() + rect.height()); }
+
+    qreal m_margin;
+    int m_root = -1;
+    QVector<Node> m_nodes;
+    QVector<int> m_freeNodes;
+    QHash<int, int> m_leafIndex;
+};
@@ -0,0 +1,130 @@
+#include "graphchangeset.h"
+
+#include "graphcore.h"
+
+/**
+ * @brief The GraphChangeSet class accumulates the changes made to a graph during an update
+ * Changes are compacted while they are recorded: an element that is added and removed
+ * again inside the same update does not appear at all, and changes of elements
+ * added inside the update are folded into the addition.
+ * Elements are recorded by the name ids of the graph, connections by a key packing the
+ * name ids of their nodes and ports, so recording a change neither allocates nor hashes
+ * strings. The names are built only when a consumer asks for them.
+ */
+
+/**
+ * @brief GraphChangeSet::reset marks the whole graph as replaced, individual changes become irrelevant
+ */
+void GraphChangeSet::reset()
+{
+    *this = GraphChangeSet();
+    m_reset = true;
+}
+
+void GraphChangeSet::nodeAdded(int nameId)
+{
+    if (m_reset)
+        return;
+    // a node removed and re-created inside one update is reported as a change of the node
+    if (m_removedNodes.remove(nameId))
+        m_changedPortNodes.insert(nameId);
+    else
+        m_addedNodes.insert(nameId);
+}
+
+void GraphChangeSet::nodeRemoved(int nameId)
+{
+    if (m_reset)
+        return;
+    m_movedNodes.remove(nameId);
+    m_changedPortNodes.remove(nameId);
+    if (!m_addedNodes.remove(nameId))
+        m_removedNodes.insert(nameId);
+}
+
+void GraphChangeSet::nodeMoved(int nameId)
+{
+    if (m_reset || m_addedNodes.contains(nameId))
+        return;
+    m_movedNodes.insert(nameId);
+}
+
+void GraphChangeSet::portsChanged(int nodeNameId)
+{
+    if (m_reset || m_addedNodes.contains(nodeNameId))
+        return;
+    m_changedPortNodes.insert(nodeNameId);
+}
+
+void GraphChangeSet::connectionAdded(const ConnectionKey &key)
+{
+    if (m_reset)
+        return;
+    if (!m_removedConnections.remove(key))
+        m_addedConnections.insert(key);
+}
+
+void GraphChangeSet::connectionRemoved(const ConnectionKey &key)
+{
+    if (m_reset)
+        return;
+    if (!m_addedConnections.remove(key))
+        m_removedConnections.insert(key);
+}
+
+QSet<QString> GraphChangeSet::addedNodes() const
+{
+    return nodeNames(m_addedNodes);
+}
+
+QSet<QString> GraphChangeSet::removedNodes() const
+{
+    return nodeNames(m_removedNodes);
+}
+
+QSet<QString> GraphChangeSet::movedNodes() const
+{
+    return nodeNames(m_movedNodes);
+}
+
+QSet<QString> GraphChangeSet::changedPortNodes() const
+{
+    return nodeNames(m_changedPortNodes);
+}
+
+QSet<QString> GraphChangeSet::addedConnections() const
+{
+    return connectionNames(m_addedConnections);
+}
+
+QSet<QString> GraphChangeSet::removedConnections() const
+{
+    return connectionNames(m_removedConnections);
+}
+
+/**
+ * @brief GraphChangeSet::connectionName returns the name of a recorded connection, see GraphCore::connectionName()
+ */
+QString GraphChangeSet::connectionName(const ConnectionKey &key) const
+{
+    return GraphCore::connectionName(m_names.name(int(key.output >> 32)), m_names.name(int(quint32(key.output))),
+                                     m_names.name(int(key.input >> 32)), m_names.name(int(quint32(key.input))));
+}
+
+QSet<QString> GraphChangeSet::nodeNames(const QSet<int> &nameIds) const
+{
+    QSet<QString> names;
+    names.reserve(nameIds.size());
+    for (int nameId : nameIds)
+        names.insert(m_names.name(nameId));
+    return names;
+}
+
+QSet<QString> GraphChangeSet::connectionNames(const QSet<ConnectionKey> &keys) const
+{
+    QSet<QString> names;
+    names.reserve(keys.size());
+    for (const ConnectionKey &key : keys)
+        names.insert(connectionName(key));
+    return names;
+}
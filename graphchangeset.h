@@ -0,0 +1,79 @@
+#pragma once
+
+#include "graphnametable.h"
+
+#include <QMetaType>
+#include <QSet>
+#include <QString>
+
+class GraphChangeSet
+{
+public:
+    // a connection by the name ids of its source node and output port, and of its target node and input port
+    struct ConnectionKey
+    {
+        quint64 output;
+        quint64 input;
+        inline bool operator==(const ConnectionKey &other) const { return output == other.output && input == other.input; }
+    };
+
+    static inline ConnectionKey connectionKey(int sourceNameId, int outputNameId, int targetNameId, int inputNameId) {
+        return ConnectionKey { (quint64(quint32(sourceNameId)) << 32) | quint32(outputNameId),
+                               (quint64(quint32(targetNameId)) << 32) | quint32(inputNameId) };
+    }
+
+    inline bool isEmpty() const { return !m_reset && !isStructural() && m_movedNodes.isEmpty(); }
+    inline bool isStructural() const {
+        return m_reset || !m_addedNodes.isEmpty() || !m_removedNodes.isEmpty() || !m_changedPortNodes.isEmpty()
+                || !m_addedConnections.isEmpty() || !m_removedConnections.isEmpty();
+    }
+
+    inline bool isReset() const { return m_reset; }
+    // changes by name id, see names()
+    inline const QSet<int> &addedNodeIds() const { return m_addedNodes; }
+    inline const QSet<int> &removedNodeIds() const { return m_removedNodes; }
+    inline const QSet<int> &movedNodeIds() const { return m_movedNodes; }
+    inline const QSet<int> &changedPortNodeIds() const { return m_changedPortNodes; }
+    inline const QSet<ConnectionKey> &addedConnectionKeys() const { return m_addedConnections; }
+    inline const QSet<ConnectionKey> &removedConnectionKeys() const { return m_removedConnections; }
+    inline const GraphNameTable &names() const { return m_names; }
+
+    // changes by name, built on request
+    QSet<QString> addedNodes() const;
+    QSet<QString> removedNodes() const;
+    QSet<QString> movedNodes() const;
+    QSet<QString> changedPortNodes() const;
+    QSet<QString> addedConnections() const;
+    QSet<QString> removedConnections() const;
+    QString connectionName(const ConnectionKey &key) const;
+
+    void reset();
+    void nodeAdded(int nameId);
+    void nodeRemoved(int nameId);
+    void nodeMoved(int nameId);
+    void portsChanged(int nodeNameId);
+    void connectionAdded(const ConnectionKey &key);
+    void connectionRemoved(const ConnectionKey &key);
+    inline void setNames(const GraphNameTable &names) { m_names = names; }
+
+private:
+    QSet<QString> nodeNames(const QSet<int> &nameIds) const;
+    QSet<QString> connectionNames(const QSet<ConnectionKey> &keys) const;
+
+    bool m_reset = false;
+    QSet<int> m_addedNodes;
+    QSet<int> m_removedNodes;
+    QSet<int> m_movedNodes;
+    QSet<int> m_changedPortNodes;
+    QSet<ConnectionKey> m_addedConnections;
+    QSet<ConnectionKey> m_removedConnections;
+    // implicitly shared copy of the names of the graph when the changes were committed
+    GraphNameTable m_names;
+};
+
+inline uint qHash(const GraphChangeSet::ConnectionKey &key, uint seed = 0)
+{
+    return qHash(key.output, seed) ^ qHash(key.input, seed + 1);
+}
+
+Q_DECLARE_METATYPE(GraphChangeSet)
@@ -0,0 +1,312 @@
+#include "graphbinaryformat.h"
+#include "graphcommandline.h"
+#include "graphcore.h"
+#include "graphexpression.h"
+
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+
+/**
+ * @brief The GraphCommandLine class runs GraphCore without GUI on graph files
+ * The application switches to it when its first argument is one of the commands:
+ * - load <file>: loads the file and prints the timings and the element counts
+ * - validate <file>: checks names, ports, connections and expressions, then evaluates the graph
+ * - convert <input> <output>: loads a file and saves it again, the suffixes select the formats
+ * - stats <file>: prints the element counts, the degrees and the evaluation of the graph
+ * Results go to stdout as "key: value" lines, problems to stderr. The exit code is
+ * Success, Failure if a file could not be read or written or is invalid, UsageError
+ * for wrong arguments.
+ */
+
+namespace {
+
+const char *const Commands[] = { "load", "validate", "convert", "stats" };
+
+} // namespace
+
+GraphCommandLine::GraphCommandLine()
+    : m_out(stdout), m_err(stderr)
+{
+}
+
+/**
+ * @brief GraphCommandLine::isCommand checks whether an argument starts the command-line mode
+ * @param argument first argument of the application
+ */
+bool GraphCommandLine::isCommand(const char *argument)
+{
+    for (const char *command : Commands) {
+        if (qstrcmp(argument, command) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief GraphCommandLine::run executes a command, a QCoreApplication has to exist
+ * @param arguments arguments of the application, including the program name
+ * @return exit code
+ */
+int GraphCommandLine::run(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(tr("Loads, validates, converts and describes graph files without GUI.\n"
+                                        "The file suffix %1 selects the binary format, any other one JSON.")
+                                     .arg(GraphBinaryFormat::fileSuffix()));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("command"), tr("load, validate, convert or stats"));
+    parser.addPositionalArgument(QStringLiteral("files"), tr("Graph file, for convert the input and the output file"),
+                                 QStringLiteral("<file> [<output>]"));
+    parser.process(arguments);
+
+    const QStringList positional = parser.positionalArguments();
+    const QString command = positional.value(0);
+    const int fileCount = command == QLatin1String("convert") ? 2 : 1;
+    GraphCommandLine commandLine;
+    if (positional.size() != 1 + fileCount) {
+        commandLine.m_err << tr("%1 expects %n file name(s)", "", fileCount).arg(command) << "\n"
+                          << parser.helpText();
+        return UsageError;
+    }
+
+    if (command == QLatin1String("load"))
+        return commandLine.load(positional.at(1));
+    if (command == QLatin1String("validate"))
+        return commandLine.validate(positional.at(1));
+    if (command == QLatin1String("convert"))
+        return commandLine.convert(positional.at(1), positional.at(2));
+    return commandLine.stats(positional.at(1));
+}
+
+/**
+ * @brief GraphCommandLine::load reads a file into a GraphCore
+ */
+int GraphCommandLine::load(const QString &fileName)
+{
+    GraphData data;
+    if (!read(fileName, &data))
+        return Failure;
+    GraphCore graphCore;
+    build(&graphCore, data);
+    print(QStringLiteral("nodes"), graphCore.store().nodeCount());
+    print(QStringLiteral("ports"), graphCore.store().portCount());
+    print(QStringLiteral("connections"), graphCore.store().connectionCount());
+    return Success;
+}
+
+/**
+ * @brief GraphCommandLine::validate checks a file, the graph is evaluated only if its structure is valid
+ */
+int GraphCommandLine::validate(const QString &fileName)
+{
+    GraphData data;
+    if (!read(fileName, &data))
+        return Failure;
+
+    QStringList problems = check(data);
+    if (problems.isEmpty()) {
+        GraphCore graphCore;
+        build(&graphCore, data);
+        QObject::connect(&graphCore, &GraphCore::errorOccurred, [&problems](const QString &error) {
+            problems.append(error);
+        });
+        QElapsedTimer timer;
+        timer.start();
+        graphCore.evaluate();
+        printElapsed(QStringLiteral("evaluate_ms"), timer);
+    }
+
+    for (const QString &problem : qAsConst(problems))
+        m_err << fileName << ": " << problem << "\n";
+    print(QStringLiteral("problems"), problems.size());
+    return problems.isEmpty() ? Success : Failure;
+}
+
+/**
+ * @brief GraphCommandLine::convert loads a file into a GraphCore and saves the graph to another file
+ */
+int GraphCommandLine::convert(const QString &inputFileName, const QString &outputFileName)
+{
+    GraphData data;
+    if (!read(inputFileName, &data))
+        return Failure;
+    GraphCore graphCore;
+    build(&graphCore, data);
+
+    QElapsedTimer timer;
+    timer.start();
+    data = graphCore.graphData();
+    printElapsed(QStringLiteral("snapshot_ms"), timer);
+
+    QString errorString;
+    timer.restart();
+    if (!GraphCore::writeGraphData(outputFileName, data, &errorString)) {
+        m_err << errorString << "\n";
+        return Failure;
+    }
+    printElapsed(QStringLiteral("write_ms"), timer);
+    print(QStringLiteral("written_bytes"), QFileInfo(outputFileName).size());
+    return Success;
+}
+
+/**
+ * @brief GraphCommandLine::stats prints the element counts, the degrees and the evaluation of a file
+ */
+int GraphCommandLine::stats(const QString &fileName)
+{
+    GraphData data;
+    if (!read(fileName, &data))
+        return Failure;
+    GraphCore graphCore;
+    build(&graphCore, data);
+
+    const GraphStore &store = graphCore.store();
+    int inputPorts = 0;
+    int expressionPorts = 0;
+    int isolatedNodes = 0;
+    int maxDegree = 0;
+    for (int nodeId = 0; nodeId < store.nodeCapacity(); ++nodeId) {
+        if (!store.isNode(nodeId))
+            continue;
+        const int degree = store.nodeDegree(nodeId);
+        maxDegree = qMax(maxDegree, degree);
+        if (degree == 0)
+            ++isolatedNodes;
+        inputPorts += store.portCount(nodeId, GraphStore::InputPort);
+        for (int portId = store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = store.nextPort(portId)) {
+            if (store.portValue(portId).type() == QVariant::String)
+                ++expressionPorts;
+        }
+    }
+    print(QStringLiteral("nodes"), store.nodeCount());
+    print(QStringLiteral("input_ports"), inputPorts);
+    print(QStringLiteral("output_ports"), store.portCount() - inputPorts);
+    print(QStringLiteral("expression_ports"), expressionPorts);
+    print(QStringLiteral("connections"), store.connectionCount());
+    print(QStringLiteral("isolated_nodes"), isolatedNodes);
+    print(QStringLiteral("max_node_degree"), maxDegree);
+    print(QStringLiteral("mean_node_degree"), store.nodeCount() > 0 ? 2.0 * store.connectionCount() / store.nodeCount() : 0.0);
+
+    QObject::connect(&graphCore, &GraphCore::errorOccurred, [this](const QString &error) {
+        m_err << error << "\n";
+    });
+    QElapsedTimer timer;
+    timer.start();
+    const bool evaluated = graphCore.evaluate();
+    printElapsed(QStringLiteral("evaluate_ms"), timer);
+    print(QStringLiteral("evaluated"), evaluated);
+    print(QStringLiteral("evaluation_levels"), graphCore.evaluator().levelCount());
+    print(QStringLiteral("cycle_nodes"), graphCore.evaluator().cycleNodes().size());
+    return Success;
+}
+
+/**
+ * @brief GraphCommandLine::read reads a graph file and prints its size and the time it took
+ * @return false if the file could not be read, the reason is printed
+ */
+bool GraphCommandLine::read(const QString &fileName, GraphData *data)
+{
+    QString errorString;
+    QElapsedTimer timer;
+    timer.start();
+    if (!GraphCore::readGraphData(fileName, data, &errorString)) {
+        m_err << errorString << "\n";
+        return false;
+    }
+    print(QStringLiteral("file"), fileName);
+    print(QStringLiteral("file_bytes"), QFileInfo(fileName).size());
+    printElapsed(QStringLiteral("read_ms"), timer);
+    return true;
+}
+
+/**
+ * @brief GraphCommandLine::build replaces the graph of a GraphCore and prints the time it took
+ */
+void GraphCommandLine::build(GraphCore *graphCore, const GraphData &data)
+{
+    QElapsedTimer timer;
+    timer.start();
+    graphCore->setGraphData(data);
+    printElapsed(QStringLiteral("build_ms"), timer);
+}
+
+/**
+ * @brief GraphCommandLine::check finds the problems GraphCore would skip while building the graph
+ * @return descriptions of the problems
+ */
+QStringList GraphCommandLine::check(const GraphData &data)
+{
+    QStringList problems;
+    // port type per port name, by node name
+    QHash<QString, QHash<QString, int>> nodePorts;
+    for (const GraphNodeData &node : data.nodes) {
+        if (node.name.isEmpty()) {
+            problems.append(tr("Node without name"));
+            continue;
+        }
+        if (nodePorts.contains(node.name)) {
+            problems.append(tr("Node '%1' exists more than once").arg(node.name));
+            continue;
+        }
+        QHash<QString, int> &ports = nodePorts[node.name];
+        QSet<QString> portNames[2];
+        for (const GraphPortData &port : node.ports) {
+            if (port.portType != GraphStore::OutputPort && port.portType != GraphStore::InputPort) {
+                problems.append(tr("Port '%1' of node '%2' has the unknown type %3").arg(port.name, node.name).arg(port.portType));
+                continue;
+            }
+            if (port.name.isEmpty()) {
+                problems.append(tr("Port without name in node '%1'").arg(node.name));
+                continue;
+            }
+            if (portNames[port.portType].contains(port.name)) {
+                problems.append(tr("Port '%1' exists more than once in node '%2'").arg(port.name, node.name));
+                continue;
+            }
+            portNames[port.portType].insert(port.name);
+            // an input and an output port may share a name, connections tell them apart by direction
+            ports[port.name] |= 1 << port.portType;
+            if (port.value.type() == QVariant::String) {
+                GraphExpression expression;
+                QString errorString;
+                if (!expression.compile(port.value.toString(), &errorString))
+                    problems.append(tr("Port '%1' of node '%2': %3").arg(port.name, node.name, errorString));
+            }
+        }
+    }
+
+    QSet<QString> connections;
+    for (const GraphConnectionData &conn : data.connections) {
+        const QString name = GraphCore::connectionName(conn.sourceNode, conn.outputPort, conn.targetNode, conn.inputPort);
+        if (!nodePorts.contains(conn.sourceNode) || !nodePorts.contains(conn.targetNode)) {
+            problems.append(tr("Connection '%1' refers to a missing node").arg(name));
+        } else if (!(nodePorts.value(conn.sourceNode).value(conn.outputPort) & (1 << GraphStore::OutputPort))) {
+            problems.append(tr("Connection '%1' starts at a missing output port").arg(name));
+        } else if (!(nodePorts.value(conn.targetNode).value(conn.inputPort) & (1 << GraphStore::InputPort))) {
+            problems.append(tr("Connection '%1' ends at a missing input port").arg(name));
+        } else if (conn.sourceNode == conn.targetNode) {
+            problems.append(tr("Connection '%1' connects a node to itself").arg(name));
+        } else if (connections.contains(name)) {
+            problems.append(tr("Connection '%1' exists more than once").arg(name));
+        } else {
+            connections.insert(name);
+        }
+    }
+    return problems;
+}
+
+void GraphCommandLine::print(const QString &key, const QVariant &value)
+{
+    if (value.type() == QVariant::Double)
+        m_out << key << ": " << QString::number(value.toDouble(), 'f', 2) << "\n";
+    else
+        m_out << key << ": " << value.toString() << "\n";
+    m_out.flush();
+}
+
+void GraphCommandLine::printElapsed(const QString &key, const QElapsedTimer &timer)
+{
+    print(key, timer.nsecsElapsed() / 1e6);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "graphdata.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+
+class GraphCore;
+
+class GraphCommandLine
+{
+    Q_DECLARE_TR_FUNCTIONS(GraphCommandLine)
+
+public:
+    enum ExitCode { Success = 0, Failure = 1, UsageError = 2 };
+
+    static bool isCommand(const char *argument);
+    static int run(const QStringList &arguments);
+
+private:
+    GraphCommandLine();
+
+    int load(const QString &fileName);
+    int validate(const QString &fileName);
+    int convert(const QString &inputFileName, const QString &outputFileName);
+    int stats(const QString &fileName);
+
+    bool read(const QString &fileName, GraphData *data);
+    void build(GraphCore *graphCore, const GraphData &data);
+    static QStringList check(const GraphData &data);
+    void print(const QString &key, const QVariant &value);
+    void printElapsed(const QString &key, const QElapsedTimer &timer);
+
+    QTextStream m_out;
+    QTextStream m_err;
+};
@@ -3,40 +3,66 @@
 #include "graphcore.h"
 #include "graphnodeport.h"
 
-GraphConnection::GraphConnection(GraphNodePort *outPort, GraphNodePort *inPort, const QString &name, GraphCore *graphCore)
-    : GraphGenericObject(name, graphCore)
-    , m_outputPort(outPort)
-    , m_inputPort(inPort)
+/**
+ * @brief The GraphConnection class is the QObject facade of a connection of the GraphStore
+ */
+
+/**
+ * @brief GraphConnection::GraphConnection ctor, facades are created by GraphCore::connectionObject()
+ * @param connectionId connection handle
+ * @param graphCore the graph
+ */
+GraphConnection::GraphConnection(int connectionId, GraphCore *graphCore)
+    : GraphGenericObject(connectionId, graphCore)
+{
+}
+
+QString GraphConnection::name() const
+{
+    return isValid() ? m_graphCore->connectionName(outputPortId(), inputPortId()) : QString();
+}
+
+QColor GraphConnection::color() const
+{
+    return isValid() ? store().portColor(outputPortId()) : QColor(Qt::gray);
+}
+
+int GraphConnection::outputPortId() const
+{
+    return isValid() ? store().connectionOutput(m_id) : GraphStore::InvalidId;
+}
+
+int GraphConnection::inputPortId() const
 {
-    m_color = outPort->color();
+    return isValid() ? store().connectionInput(m_id) : GraphStore::InvalidId;
 }
 
 GraphNodePort *GraphConnection::outputPort() const
 {
-    return m_outputPort;
+    return isValid() ? m_graphCore->portObject(outputPortId()) : nullptr;
 }
 
 GraphNodePort *GraphConnection::inputPort() const
 {
-    return m_inputPort;
+    return isValid() ? m_graphCore->portObject(inputPortId()) : nullptr;
 }
 
 QString GraphConnection::sourceNodeName() const
 {
-    return outputPort()->nodeName();
+    return isValid() ? store().nodeName(store().portNode(outputPortId())) : QString();
 }
 
 QString GraphConnection::outputPortName() const
 {
-    return outputPort()->name();
+    return isValid() ? store().portName(outputPortId()) : QString();
 }
 
 QString GraphConnection::targetNodeName() const
 {
-    return inputPort()->nodeName();
+    return isValid() ? store().nodeName(store().portNode(inputPortId())) : QString();
 }
 
 QString GraphConnection::inputPortName() const
 {
-    return inputPort()->name();
+    return isValid() ? store().portName(inputPortId()) : QString();
 }
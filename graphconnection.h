@@ -2,22 +2,25 @@
 
 #include "graphgenericobject.h"
 
-#include <QPointer>
-
 class GraphCore;
 class GraphNodePort;
 
 class GraphConnection : public GraphGenericObject
 {
     Q_OBJECT
-    Q_PROPERTY(QString sourceNodeName READ sourceNodeName CONSTANT)
-    Q_PROPERTY(QString outputPortName READ outputPortName CONSTANT)
-    Q_PROPERTY(QString targetNodeName READ targetNodeName CONSTANT)
-    Q_PROPERTY(QString inputPortName READ inputPortName CONSTANT)
+    Q_PROPERTY(QString sourceNodeName READ sourceNodeName NOTIFY elementChanged)
+    Q_PROPERTY(QString outputPortName READ outputPortName NOTIFY elementChanged)
+    Q_PROPERTY(QString targetNodeName READ targetNodeName NOTIFY elementChanged)
+    Q_PROPERTY(QString inputPortName READ inputPortName NOTIFY elementChanged)
 
 public:
-    explicit GraphConnection(GraphNodePort *outPort, GraphNodePort *inPort, const QString &name, GraphCore *graphCore);
+    explicit GraphConnection(int connectionId, GraphCore *graphCore);
+
+    QString name() const override;
+    QColor color() const override;
 
+    int outputPortId() const;
+    int inputPortId() const;
     GraphNodePort *outputPort() const;
     GraphNodePort *inputPort() const;
 
@@ -25,9 +28,4 @@ public:
     QString outputPortName() const;
     QString targetNodeName() const;
     QString inputPortName() const;
-
-private:
-    QPointer<GraphNodePort> m_outputPort;
-    QPointer<GraphNodePort> m_inputPort;
 };
-
@@ -0,0 +1,341 @@
+#include "graphconnectionitem.h"
+#include "graphprofiler.h"
+
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QtMath>
+
+#include <cstring>
+
+/**
+ * @brief The GraphConnectionItem class draws all connection curves of a graph
+ * Curves are tessellated into triangle strips and batched into one geometry node per
+ * colour, joined by degenerate triangles. Every curve owns a fixed slot in its batch,
+ * so only the curves attached to a node that moved or changed its ports are
+ * re-tessellated and uploaded. With a viewport set, changed curves outside of it are
+ * collapsed instead of tessellated and catch up once the viewport reaches them.
+ * The item is meant to live in the same coordinate space as the nodes: panning and
+ * zooming the scene only change its transform and never touch the vertex data.
+ */
+
+/**
+ * @brief GraphConnectionItem::GraphConnectionItem ctor
+ * @param parent parent item
+ */
+GraphConnectionItem::GraphConnectionItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+}
+
+/**
+ * @brief GraphConnectionItem::setGraph sets the graph whose connections are drawn
+ * The item follows connection additions and removals of the graph from then on
+ * @param graphCore graph
+ */
+void GraphConnectionItem::setGraph(GraphCore *graphCore)
+{
+    if (m_graphCore == graphCore)
+        return;
+
+    if (m_graphCore)
+        disconnect(m_graphCore, nullptr, this, nullptr);
+    m_graphCore = graphCore;
+    if (m_graphCore) {
+        connect(m_graphCore, &GraphCore::connectionAdded, this, &GraphConnectionItem::addConnection);
+        connect(m_graphCore, &GraphCore::connectionRemoved, this, &GraphConnectionItem::removeConnection);
+        connect(m_graphCore, &GraphCore::nodeMoved, this, &GraphConnectionItem::markNodeDirty);
+        connect(m_graphCore, &GraphCore::portAdded, this, [this](int portId) {
+            markNodeDirty(m_graphCore->store().portNode(portId));
+        });
+        connect(m_graphCore, &GraphCore::portRemoved, this, [this](int portId) {
+            markNodeDirty(m_graphCore->store().portNode(portId));
+        });
+    }
+    rebuild();
+    emit graphChanged(m_graphCore);
+}
+
+void GraphConnectionItem::setLineWidth(qreal lineWidth)
+{
+    if (qFuzzyCompare(m_lineWidth, lineWidth))
+        return;
+
+    m_lineWidth = lineWidth;
+    for (const Batch &batch : qAsConst(m_batches)) {
+        for (int connectionId : batch.connections)
+            m_dirtyConnections.insert(connectionId);
+    }
+    update();
+    emit lineWidthChanged(m_lineWidth);
+}
+
+/**
+ * @brief GraphConnectionItem::setViewport sets the region whose curves are kept up to date
+ * The curves that changed outside of the previous viewport and are inside the new one
+ * are looked up in the connection index of the graph and tessellated
+ * @param viewport region in item coordinates, a null rect disables culling
+ */
+void GraphConnectionItem::setViewport(const QRectF &viewport)
+{
+    if (m_viewport == viewport)
+        return;
+
+    m_viewport = viewport;
+    if (m_graphCore && !m_staleConnections.isEmpty()) {
+        if (m_viewport.isNull()) {
+            m_dirtyConnections.unite(m_staleConnections);
+            m_staleConnections.clear();
+        } else {
+            const qreal halfWidth = m_lineWidth / 2;
+            const QRectF region = m_viewport.adjusted(-halfWidth, -halfWidth, halfWidth, halfWidth);
+            for (int connectionId : m_graphCore->connectionIdsInRect(region)) {
+                if (m_staleConnections.remove(connectionId))
+                    m_dirtyConnections.insert(connectionId);
+            }
+        }
+        if (!m_dirtyConnections.isEmpty())
+            update();
+    }
+    emit viewportChanged(m_viewport);
+}
+
+/**
+ * @brief GraphConnectionItem::addConnection appends a curve to the batch of its colour
+ * @param connectionId connection handle
+ */
+void GraphConnectionItem::addConnection(int connectionId)
+{
+    const GraphStore &store = m_graphCore->store();
+    const QRgb color = store.portColor(store.connectionOutput(connectionId)).rgba();
+    Batch &batch = m_batches[color];
+    m_slots.insert(connectionId, Slot { color, batch.connections.size() });
+    batch.connections.append(connectionId);
+    batch.vertices.resize(batch.connections.size() * VerticesPerCurve);
+    batch.resized = true;
+    m_dirtyConnections.insert(connectionId);
+    update();
+}
+
+/**
+ * @brief GraphConnectionItem::removeConnection removes a curve from its batch
+ * The last curve of the batch is moved into the freed slot together with its
+ * vertices, so nothing has to be re-tessellated
+ * @param connectionId connection handle
+ */
+void GraphConnectionItem::removeConnection(int connectionId)
+{
+    auto it = m_slots.find(connectionId);
+    if (it == m_slots.end())
+        return;
+
+    const Slot slot = *it;
+    m_slots.erase(it);
+    m_dirtyConnections.remove(connectionId);
+    m_staleConnections.remove(connectionId);
+
+    Batch &batch = m_batches[slot.color];
+    const int last = batch.connections.size() - 1;
+    if (slot.index != last) {
+        const int moved = batch.connections.at(last);
+        batch.connections[slot.index] = moved;
+        m_slots[moved].index = slot.index;
+        std::memcpy(batch.vertices.data() + slot.index * VerticesPerCurve,
+                    batch.vertices.constData() + last * VerticesPerCurve,
+                    VerticesPerCurve * sizeof(QSGGeometry::Point2D));
+    }
+    batch.connections.removeLast();
+    if (batch.connections.isEmpty()) {
+        m_batches.remove(slot.color);
+    } else {
+        batch.vertices.resize(batch.connections.size() * VerticesPerCurve);
+        batch.resized = true;
+    }
+    update();
+}
+
+/**
+ * @brief GraphConnectionItem::markNodeDirty schedules the curves of a node for tessellation
+ * @param nodeId node handle
+ */
+void GraphConnectionItem::markNodeDirty(int nodeId)
+{
+    if (!m_graphCore)
+        return;
+
+    const QVector<int> connections = m_graphCore->store().nodeConnections(nodeId);
+    if (connections.isEmpty())
+        return;
+
+    for (int connectionId : connections)
+        m_dirtyConnections.insert(connectionId);
+    update();
+}
+
+/**
+ * @brief GraphConnectionItem::rebuild recreates all batches from the current graph
+ */
+void GraphConnectionItem::rebuild()
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphConnectionItem::rebuild");
+    m_batches.clear();
+    m_slots.clear();
+    m_dirtyConnections.clear();
+    m_staleConnections.clear();
+    if (m_graphCore) {
+        for (int connectionId : m_graphCore->connectionIds())
+            addConnection(connectionId);
+    }
+    update();
+}
+
+/**
+ * @brief GraphConnectionItem::isInViewport checks whether the curve of a connection may reach into the viewport
+ * @param connectionId connection handle
+ */
+bool GraphConnectionItem::isInViewport(int connectionId) const
+{
+    if (m_viewport.isNull())
+        return true;
+    const qreal halfWidth = m_lineWidth / 2;
+    const QRectF rect = m_graphCore->store().connectionRect(connectionId).adjusted(-halfWidth, -halfWidth, halfWidth, halfWidth);
+    return rect.intersects(m_viewport);
+}
+
+/**
+ * @brief GraphConnectionItem::tessellate writes the triangle strip of one curve
+ * The curve is sampled at regular steps of GraphStore::curvePoint().
+ * The strip is framed by a repeated first and last vertex, so consecutive curves of
+ * a batch are joined by degenerate triangles.
+ * @param connectionId connection handle
+ * @param out VerticesPerCurve vertices
+ */
+void GraphConnectionItem::tessellate(int connectionId, QSGGeometry::Point2D *out) const
+{
+    const GraphStore &store = m_graphCore->store();
+    const QPointF p0 = store.portAnchor(store.connectionOutput(connectionId));
+    const QPointF p2 = store.portAnchor(store.connectionInput(connectionId));
+    QPointF points[CurveSegments + 1];
+    for (int i = 0; i <= CurveSegments; ++i)
+        points[i] = GraphStore::curvePoint(p0, p2, qreal(i) / CurveSegments);
+
+    const qreal halfWidth = m_lineWidth / 2;
+    for (int i = 0; i <= CurveSegments; ++i) {
+        const QPointF tangent = points[qMin(i + 1, int(CurveSegments))] - points[qMax(i - 1, 0)];
+        const qreal length = qSqrt(QPointF::dotProduct(tangent, tangent));
+        QPointF normal;
+        if (length > 0)
+            normal = QPointF(-tangent.y(), tangent.x()) * (halfWidth / length);
+        out[1 + 2 * i].set(float(points[i].x() + normal.x()), float(points[i].y() + normal.y()));
+        out[2 + 2 * i].set(float(points[i].x() - normal.x()), float(points[i].y() - normal.y()));
+    }
+    out[0] = out[1];
+    out[VerticesPerCurve - 1] = out[VerticesPerCurve - 2];
+}
+
+/**
+ * @brief GraphConnectionItem::collapse writes a strip of degenerate triangles in place of a curve,
+ * so the outdated curve of a connection outside of the viewport is not drawn
+ * @param connectionId connection handle
+ * @param out VerticesPerCurve vertices
+ */
+void GraphConnectionItem::collapse(int connectionId, QSGGeometry::Point2D *out) const
+{
+    const GraphStore &store = m_graphCore->store();
+    const QPointF p0 = store.portAnchor(store.connectionOutput(connectionId));
+    for (int i = 0; i < VerticesPerCurve; ++i)
+        out[i].set(float(p0.x()), float(p0.y()));
+}
+
+/**
+ * @brief GraphConnectionItem::updatePaintNode syncs the batches into the scene graph
+ * Resized batches are uploaded as a whole, otherwise only the slots of the
+ * re-tessellated curves are copied
+ */
+QSGNode *GraphConnectionItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphConnectionItem::updatePaintNode");
+    QSGNode *root = oldNode;
+    if (!root) {
+        root = new QSGNode;
+        m_batchNodes.clear();
+        for (auto it = m_batches.begin(); it != m_batches.end(); ++it)
+            it->resized = true;
+    }
+
+    // drop the geometry nodes of colours that have no curves left
+    for (auto it = m_batchNodes.begin(); it != m_batchNodes.end(); ) {
+        if (m_batches.contains(it.key())) {
+            ++it;
+        } else {
+            root->removeChildNode(it.value());
+            delete it.value();
+            it = m_batchNodes.erase(it);
+        }
+    }
+
+    QHash<QRgb, QVector<int>> dirtySlots;
+    if (!m_graphCore)
+        m_dirtyConnections.clear();
+    for (int connectionId : qAsConst(m_dirtyConnections)) {
+        const auto it = m_slots.constFind(connectionId);
+        if (it == m_slots.constEnd())
+            continue;
+        const Slot slot = *it;
+        Batch &batch = m_batches[slot.color];
+        if (isInViewport(connectionId)) {
+            tessellate(connectionId, batch.vertices.data() + slot.index * VerticesPerCurve);
+        } else {
+            collapse(connectionId, batch.vertices.data() + slot.index * VerticesPerCurve);
+            m_staleConnections.insert(connectionId);
+        }
+        if (!batch.resized)
+            dirtySlots[slot.color].append(slot.index);
+    }
+    m_dirtyConnections.clear();
+
+    for (auto it = m_batches.begin(); it != m_batches.end(); ++it) {
+        Batch &batch = it.value();
+        const auto slots = dirtySlots.constFind(it.key());
+        if (!batch.resized && slots == dirtySlots.constEnd())
+            continue;
+
+        QSGGeometryNode *node = m_batchNodes.value(it.key());
+        if (!node) {
+            node = new QSGGeometryNode;
+            QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+            geometry->setDrawingMode(QSGGeometry::DrawTriangleStrip);
+            geometry->setVertexDataPattern(QSGGeometry::DynamicPattern);
+            node->setGeometry(geometry);
+            node->setFlag(QSGNode::OwnsGeometry);
+            QSGFlatColorMaterial *material = new QSGFlatColorMaterial;
+            material->setColor(QColor::fromRgba(it.key()));
+            node->setMaterial(material);
+            node->setFlag(QSGNode::OwnsMaterial);
+            root->appendChildNode(node);
+            m_batchNodes.insert(it.key(), node);
+            batch.resized = true;
+        }
+
+        QSGGeometry *geometry = node->geometry();
+        QSGGeometry::Point2D *vertices;
+        if (batch.resized) {
+            geometry->allocate(batch.vertices.size());
+            vertices = geometry->vertexDataAsPoint2D();
+            std::memcpy(vertices, batch.vertices.constData(),
+                        batch.vertices.size() * sizeof(QSGGeometry::Point2D));
+            batch.resized = false;
+        } else {
+            vertices = geometry->vertexDataAsPoint2D();
+            for (int index : *slots) {
+                std::memcpy(vertices + index * VerticesPerCurve,
+                            batch.vertices.constData() + index * VerticesPerCurve,
+                            VerticesPerCurve * sizeof(QSGGeometry::Point2D));
+            }
+        }
+        geometry->markVertexDataDirty();
+        node->markDirty(QSGNode::DirtyGeometry);
+    }
+
+    return root;
+}
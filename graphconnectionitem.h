@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QColor>
+#include <QHash>
+#include <QPointer>
+#include <QQuickItem>
+#include <QSGGeometry>
+#include <QSet>
+#include <QVector>
+
+#include "graphcore.h"
+
+class QSGGeometryNode;
+
+class GraphConnectionItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(GraphCore *graph READ graph WRITE setGraph NOTIFY graphChanged)
+    Q_PROPERTY(qreal lineWidth READ lineWidth WRITE setLineWidth NOTIFY lineWidthChanged)
+    Q_PROPERTY(QRectF viewport READ viewport WRITE setViewport NOTIFY viewportChanged)
+
+public:
+    // every curve is tessellated into the same number of segments, so it owns a fixed slot
+    // of vertices in the batch of its colour and can be rewritten in place
+    static const int CurveSegments = 16;
+    static const int VerticesPerCurve = 2 * (CurveSegments + 1) + 2;
+
+    explicit GraphConnectionItem(QQuickItem *parent = nullptr);
+
+    inline GraphCore *graph() const { return m_graphCore; }
+    inline qreal lineWidth() const { return m_lineWidth; }
+    inline QRectF viewport() const { return m_viewport; }
+
+public slots:
+    void setGraph(GraphCore *graphCore);
+    void setLineWidth(qreal lineWidth);
+    void setViewport(const QRectF &viewport);
+
+signals:
+    void graphChanged(GraphCore *graphCore);
+    void lineWidthChanged(qreal lineWidth);
+    void viewportChanged(const QRectF &viewport);
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *) override;
+
+private:
+    struct Batch
+    {
+        QVector<int> connections;
+        QVector<QSGGeometry::Point2D> vertices;
+        bool resized = true;
+    };
+
+    struct Slot
+    {
+        QRgb color;
+        int index;
+    };
+
+    void addConnection(int connectionId);
+    void removeConnection(int connectionId);
+    void markNodeDirty(int nodeId);
+    void rebuild();
+    bool isInViewport(int connectionId) const;
+    void tessellate(int connectionId, QSGGeometry::Point2D *out) const;
+    void collapse(int connectionId, QSGGeometry::Point2D *out) const;
+
+    QPointer<GraphCore> m_graphCore;
+    qreal m_lineWidth = 2;
+    // region in item coordinates outside of which curves are not tessellated, null for everything
+    QRectF m_viewport;
+    QHash<QRgb, Batch> m_batches;
+    QHash<int, Slot> m_slots;
+    QSet<int> m_dirtyConnections;
+    // curves that changed outside of the viewport, tessellated once they come into view
+    QSet<int> m_staleConnections;
+    // render side, only touched from updatePaintNode()
+    QHash<QRgb, QSGGeometryNode *> m_batchNodes;
+};
@@ -1,16 +1,21 @@
+#include "graphbinaryformat.h"
 #include "graphconnection.h"
 #include "graphcore.h"
-#include "graphcore.h"
+#include "graphjsonreader.h"
 #include "graphnode.h"
 #include "graphnodeport.h"
+#include "graphprofiler.h"
 
 #include <QFile>
+#include <QFutureWatcher>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QTextStream>
+#include <QSaveFile>
 #include <QVector>
 #include <QDebug>
+#include <QtConcurrent>
+#include <QtNumeric>
 
 /**
  * @brief The GraphCore class owns and managers all objects of the graph view
@@ -24,365 +29,1831 @@
 GraphCore::GraphCore(QObject *parent)
     : QObject(parent)
     , m_sourceFileName(tr("<Empty>"))
+    , m_nodeModel(new GraphHandleModel([this](int nodeId) -> QObject * { return nodeObject(nodeId); }, this))
+    , m_connectionModel(new GraphHandleModel([this](int connectionId) -> QObject * { return connectionObject(connectionId); }, this))
+    , m_visibleNodeModel(new GraphViewportModel(this))
+    , m_evaluator(m_store)
 {
+    m_autosaveTimer.setInterval(5000);
+    connect(&m_autosaveTimer, &QTimer::timeout, this, &GraphCore::autosave);
+    // one frame at 60 Hz
+    m_moveTimer.setInterval(16);
+    m_moveTimer.setSingleShot(true);
+    connect(&m_moveTimer, &QTimer::timeout, this, &GraphCore::flushMoves);
 }
 
-GraphNode *GraphCore::findNode(const QString &name) const
+/**
+ * @brief GraphCore::~GraphCore cancels a load or layout in progress and finishes saves in progress
+ */
+GraphCore::~GraphCore()
 {
-    return static_cast<GraphNode *>(m_graphNodes.value(name));
+    if (m_layoutWatcher) {
+        cancelLayout();
+        m_layoutWatcher->waitForFinished();
+    }
+    if (m_loadWatcher) {
+        cancelLoad();
+        m_loadWatcher->waitForFinished();
+    }
+    // nothing requested to be saved gets lost
+    const QString journalFileName = m_journal.fileName();
+    if (m_saveWatcher) {
+        m_saveWatcher->waitForFinished();
+        const SaveResult result = m_saveWatcher->result();
+        if (!result.ok) {
+            qWarning() << result.errorString;
+        } else if (m_journalSaveMark >= 0 && GraphJournal::fileNameFor(result.fileName) == journalFileName) {
+            QString errorString;
+            if (!m_journal.compact(m_journalSaveMark, &errorString))
+                qWarning() << errorString;
+        }
+    }
+    for (const QString &fileName : qAsConst(m_pendingSaves)) {
+        const SaveResult result = writeGraphFile(fileName, graphData());
+        if (!result.ok)
+            qWarning() << result.errorString;
+        else if (GraphJournal::fileNameFor(fileName) == journalFileName)
+            m_journal.discard();
+    }
+    // the journal keeps the unsaved changes for the next load
+    m_journal.close();
 }
 
-bool GraphCore::hasConnection(const GraphNodePort *graphNodePort) const
+/**
+ * @brief GraphCore::graphNodes returns the facades of all nodes, creating the missing ones
+ */
+QObjectList GraphCore::graphNodes() const
 {
-    for (const auto c : m_graphConnections) {
-        GraphConnection *conn = static_cast<GraphConnection *>(c);
-        if (conn->inputPort() == graphNodePort || conn->outputPort() == graphNodePort)
-            return true;
-    }
-    return false;
+    QObjectList nodes;
+    const QVector<int> ids = nodeIds();
+    nodes.reserve(ids.size());
+    for (int nodeId : ids)
+        nodes.append(nodeObject(nodeId));
+    return nodes;
 }
 
 /**
- * @brief GraphCore::save saves all objects to the source file
+ * @brief GraphCore::graphConnections returns the facades of all connections, creating the missing ones
  */
-void GraphCore::save()
+QObjectList GraphCore::graphConnections() const
 {
-    saveTo(sourceFileName());
+    QObjectList connections;
+    const QVector<int> ids = connectionIds();
+    connections.reserve(ids.size());
+    for (int connectionId : ids)
+        connections.append(connectionObject(connectionId));
+    return connections;
 }
 
 /**
- * @brief GraphCore::saveAs saves all objects to a new file
- * @param fileName new file name
+ * @brief GraphCore::nodeIds returns the handles of all nodes
  */
-void GraphCore::saveAs(const QString &fileName)
+QVector<int> GraphCore::nodeIds() const
 {
-    if (!saveTo(sourceFileName()))
-        return;
+    QVector<int> ids;
+    ids.reserve(m_store.nodeCount());
+    for (int nodeId = 0; nodeId < m_store.nodeCapacity(); ++nodeId) {
+        if (m_store.isNode(nodeId))
+            ids.append(nodeId);
+    }
+    return ids;
+}
 
-    if (sourceFileName() != fileName) {
-        m_sourceFileName = fileName;
-        emit sourceFileNameChanged(m_sourceFileName);
+/**
+ * @brief GraphCore::connectionIds returns the handles of all connections
+ */
+QVector<int> GraphCore::connectionIds() const
+{
+    QVector<int> ids;
+    ids.reserve(m_store.connectionCount());
+    for (int connectionId = 0; connectionId < m_store.connectionCapacity(); ++connectionId) {
+        if (m_store.isConnection(connectionId))
+            ids.append(connectionId);
     }
+    return ids;
+}
+
+GraphNode *GraphCore::findNode(const QString &name) const
+{
+    return nodeObject(m_store.findNode(name));
 }
 
 /**
- * @brief GraphCore::load loads data from file
- * @param fileName a file name
+ * @brief GraphCore::findConnection looks a connection up by the name built by connectionName()
+ * Node and port names may contain dots, so every split of both ends is tried against the store
+ * @param name connection name
+ * @return connection handle or GraphStore::InvalidId
  */
-void GraphCore::load(const QString &fileName)
+int GraphCore::findConnection(const QString &name) const
 {
-    if (!loadFrom(fileName))
-        return;
+    const int arrow = name.indexOf(QLatin1String("->"));
+    if (arrow < 0)
+        return GraphStore::InvalidId;
 
-    if (sourceFileName() != fileName) {
-        m_sourceFileName = fileName;
-        emit sourceFileNameChanged(m_sourceFileName);
+    const QStringRef source = name.leftRef(arrow);
+    const QStringRef target = name.midRef(arrow + 2);
+    for (int i = source.indexOf(QLatin1Char('.')); i >= 0; i = source.indexOf(QLatin1Char('.'), i + 1)) {
+        const int sourceNodeId = m_store.findNode(source.left(i).toString());
+        if (sourceNodeId == GraphStore::InvalidId)
+            continue;
+        const int outPortId = m_store.findPort(sourceNodeId, GraphStore::OutputPort, source.mid(i + 1).toString());
+        if (outPortId == GraphStore::InvalidId)
+            continue;
+        for (int j = target.indexOf(QLatin1Char('.')); j >= 0; j = target.indexOf(QLatin1Char('.'), j + 1)) {
+            const int destNodeId = m_store.findNode(target.left(j).toString());
+            if (destNodeId == GraphStore::InvalidId)
+                continue;
+            const int inPortId = m_store.findPort(destNodeId, GraphStore::InputPort, target.mid(j + 1).toString());
+            if (inPortId == GraphStore::InvalidId)
+                continue;
+            const int connectionId = m_store.findConnection(outPortId, inPortId);
+            if (connectionId != GraphStore::InvalidId)
+                return connectionId;
+        }
     }
-    emit graphChanged();
+    return GraphStore::InvalidId;
 }
 
 /**
- * @brief GraphCore::addGraphNode creates a new node
- * @param name of a new node
+ * @brief GraphCore::nodeObject returns the facade of a node, it is created or recycled on first use
+ * @param nodeId node handle
+ * @return facade or nullptr if there is no such node
  */
-bool GraphCore::addGraphNode(const QString &name, qreal x, qreal y)
+GraphNode *GraphCore::nodeObject(int nodeId) const
 {
-    if (name.isEmpty()) {
-        emit errorOccurred(tr("Graph node name is empty"));
-        return false;
-    }
-    if (m_graphNodes.contains(name)) {
-        emit errorOccurred(tr("Graph node '%1' already exists").arg(name));
-        return false;
+    if (!m_store.isNode(nodeId))
+        return nullptr;
+    if (m_nodeObjects.size() <= nodeId)
+        m_nodeObjects.resize(m_store.nodeCapacity());
+    if (!m_nodeObjects.at(nodeId)) {
+        GraphNode *node;
+        if (m_nodeObjectPool.isEmpty()) {
+            GRAPHVIEW_PROFILE_COUNT("GraphNode facades created", 1);
+            node = new GraphNode(nodeId, const_cast<GraphCore *>(this));
+        } else {
+            GRAPHVIEW_PROFILE_COUNT("GraphNode facades recycled", 1);
+            node = static_cast<GraphNode *>(m_nodeObjectPool.takeLast());
+            node->attach(nodeId);
+        }
+        m_nodeObjects[nodeId] = node;
     }
-    GraphNode *node = new GraphNode(QPointF(x, y), name, this);
-    m_graphNodes[name] = node;
-
-    connect(node, &GraphNode::outputPortsChanged, this, &GraphCore::graphChanged);
-    connect(node, &GraphNode::inputPortsChanged, this, &GraphCore::graphChanged);
-    connect(node, &GraphNode::errorOccurred, this, &GraphCore::errorOccurred);
-    emit graphChanged();
-    return true;
+    return static_cast<GraphNode *>(m_nodeObjects.at(nodeId));
 }
 
 /**
- * @brief GraphCore::removeGraphNode removes node
- * @param name of removed node
+ * @brief GraphCore::portObject returns the facade of a port, it is created or recycled on first use
+ * @param portId port handle
+ * @return facade or nullptr if there is no such port
  */
-bool GraphCore::removeGraphNode(const QString &name)
+GraphNodePort *GraphCore::portObject(int portId) const
 {
-    auto it = m_graphNodes.find(name);
-    if (it == m_graphNodes.end()) {
-        emit errorOccurred(tr("Graph node '%1' does not exist").arg(name));
-        return false;
+    if (!m_store.isPort(portId))
+        return nullptr;
+    if (m_portObjects.size() <= portId)
+        m_portObjects.resize(m_store.portCapacity());
+    if (!m_portObjects.at(portId)) {
+        GraphNodePort *port;
+        if (m_portObjectPool.isEmpty()) {
+            GRAPHVIEW_PROFILE_COUNT("GraphNodePort facades created", 1);
+            port = new GraphNodePort(portId, const_cast<GraphCore *>(this));
+        } else {
+            GRAPHVIEW_PROFILE_COUNT("GraphNodePort facades recycled", 1);
+            port = static_cast<GraphNodePort *>(m_portObjectPool.takeLast());
+            port->attach(portId);
+        }
+        m_portObjects[portId] = port;
     }
-    QObject *node = it.value();
-    m_graphNodes.erase(it);
-    emit graphChanged();
-    node->deleteLater();
-    return true;
+    return static_cast<GraphNodePort *>(m_portObjects.at(portId));
 }
 
 /**
- * @brief GraphCore::addGraphConnection creates a new connection
- * @param src name of the source node
- * @param out output port name of the source node
- * @param dest name of the destination node
- * @param in input port name of the destination node
+ * @brief GraphCore::connectionObject returns the facade of a connection, it is created or recycled on first use
+ * @param connectionId connection handle
+ * @return facade or nullptr if there is no such connection
  */
-bool GraphCore::addGraphConnection(const QString &src, const QString &out, const QString &dest, const QString &in)
+GraphConnection *GraphCore::connectionObject(int connectionId) const
 {
-    if (src == dest) {
-        emit errorOccurred(tr("Source and target node cannot be the same: %1").arg(src));
-        return false;
+    if (!m_store.isConnection(connectionId))
+        return nullptr;
+    if (m_connectionObjects.size() <= connectionId)
+        m_connectionObjects.resize(m_store.connectionCapacity());
+    if (!m_connectionObjects.at(connectionId)) {
+        GraphConnection *conn;
+        if (m_connectionObjectPool.isEmpty()) {
+            GRAPHVIEW_PROFILE_COUNT("GraphConnection facades created", 1);
+            conn = new GraphConnection(connectionId, const_cast<GraphCore *>(this));
+        } else {
+            GRAPHVIEW_PROFILE_COUNT("GraphConnection facades recycled", 1);
+            conn = static_cast<GraphConnection *>(m_connectionObjectPool.takeLast());
+            conn->attach(connectionId);
+        }
+        m_connectionObjects[connectionId] = conn;
     }
+    return static_cast<GraphConnection *>(m_connectionObjects.at(connectionId));
+}
 
-    const QString name = QString(QLatin1String("%1.%2->%3.%4")).arg(src, out, dest, in);
-    if (m_graphConnections.contains(name)) {
-        emit errorOccurred(tr("Connection '%1' already exists").arg(name));
-        return false;
-    }
-    GraphNode *sourceNode = qobject_cast<GraphNode *>(m_graphNodes.value(src));
-    if (!sourceNode) {
-        emit errorOccurred(tr("Unable to find '%1' node").arg(src));
-        return false;
-    }
-    GraphNode *destNode = qobject_cast<GraphNode *>(m_graphNodes.value(dest));
-    if (!destNode) {
-        emit errorOccurred(tr("Unable to find '%1' node").arg(dest));
-        return false;
-    }
-    GraphNodePort *outPort = sourceNode->outputPort(out);
-    if (!outPort) {
-        emit errorOccurred(tr("Unable to find '%1' port").arg(out));
-        return false;
-    }
-    GraphNodePort *inPort = destNode->inputPort(in);
-    if (!inPort) {
-        emit errorOccurred(tr("Unable to find '%1' port").arg(in));
-        return false;
-    }
+/**
+ * @brief GraphCore::nodesInRect returns the nodes whose bounding boxes intersect the region
+ * Uses the spatial index, so only the part of the scene around the region is visited
+ * @param rect region in scene coordinates
+ */
+QObjectList GraphCore::nodesInRect(const QRectF &rect) const
+{
+    QObjectList nodes;
+    for (int nodeId : nodeIdsInRect(rect))
+        nodes.append(nodeObject(nodeId));
+    return nodes;
+}
 
-    GraphConnection *conn = new GraphConnection(outPort, inPort, name, this);
-    m_graphConnections[name] = conn;
-    connect(conn, &GraphConnection::errorOccurred, this, &GraphCore::errorOccurred);
-    emit graphChanged();
-    return true;
+/**
+ * @brief GraphCore::nodeIdsInRect returns the handles of the nodes intersecting the region
+ * @param rect region in scene coordinates
+ */
+QVector<int> GraphCore::nodeIdsInRect(const QRectF &rect) const
+{
+    return m_spatialIndex.query(rect);
 }
 
 /**
- * @brief GraphCore::removeGraphConnection removes connection
- * @param name of connection
+ * @brief GraphCore::connectionsInRect returns the connections whose curves may intersect the region
+ * @param rect region in scene coordinates
  */
-bool GraphCore::removeGraphConnection(const QString &name)
+QObjectList GraphCore::connectionsInRect(const QRectF &rect) const
 {
-    auto it = m_graphConnections.find(name);
-    if (it == m_graphConnections.end()) {
-        emit errorOccurred(tr("Connection '%1' does not exist").arg(name));
-        return false;
-    }
-    QObject *obj = it.value();
-    m_graphConnections.erase(it);
-    emit graphChanged();
-    obj->deleteLater();
-    return true;
+    QObjectList connections;
+    for (int connectionId : connectionIdsInRect(rect))
+        connections.append(connectionObject(connectionId));
+    return connections;
 }
 
 /**
- * @brief GraphCore::setZoomFactor sets a new zoom factor
- * @param zoomFactor value of a new zoom factor
+ * @brief GraphCore::connectionIdsInRect returns the handles of the connections whose bounding boxes intersect the region
+ * Uses the bounding-volume hierarchy of the curves, O(log n) plus the number of hits
+ * @param rect region in scene coordinates
  */
-void GraphCore::setZoomFactor(double zoomFactor)
+QVector<int> GraphCore::connectionIdsInRect(const QRectF &rect) const
 {
-    qWarning("Floating point comparison needs context sanity check");
-    if (qFuzzyCompare(m_zoomFactor, zoomFactor))
-        return;
+    return m_connectionIndex.query(rect);
+}
 
-    m_zoomFactor = zoomFactor;
+/**
+ * @brief GraphCore::connectionAt returns the connection whose curve passes closest to a point
+ * @param point position in scene coordinates
+ * @param tolerance largest distance from the curve that still counts as a hit
+ * @return connection or nullptr
+ */
+QObject *GraphCore::connectionAt(const QPointF &point, qreal tolerance) const
+{
+    const int connectionId = connectionIdAt(point, tolerance);
+    return connectionId == GraphStore::InvalidId ? nullptr : connectionObject(connectionId);
 }
 
 /**
- * @brief GraphCore::saveTo saves all current data to file
- * @param fileName file name
- * @return result of saving
+ * @brief GraphCore::connectionIdAt picks the connection whose curve passes closest to a point
+ * Only the curves whose bounding boxes are within the tolerance are measured, against a
+ * polyline through GraphStore::curvePoint()
+ * @param point position in scene coordinates
+ * @param tolerance largest distance from the curve that still counts as a hit
+ * @return connection handle or InvalidId
  */
-bool GraphCore::saveTo(const QString &fileName)
+int GraphCore::connectionIdAt(const QPointF &point, qreal tolerance) const
 {
-    QFile outputFile(fileName);
-    if (!outputFile.open(QFile::WriteOnly | QFile::Truncate)) {
-        emit errorOccurred(tr("Unable to open file '%1'").arg(fileName));
-        return false;
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::connectionIdAt");
+    const int segments = 32;
+    const QRectF region(point.x() - tolerance, point.y() - tolerance, 2 * tolerance, 2 * tolerance);
+    int closest = GraphStore::InvalidId;
+    qreal closestDistance = tolerance * tolerance;
+    for (int connectionId : m_connectionIndex.query(region)) {
+        const QPointF p0 = m_store.portAnchor(m_store.connectionOutput(connectionId));
+        const QPointF p2 = m_store.portAnchor(m_store.connectionInput(connectionId));
+        QPointF a = p0;
+        for (int i = 1; i <= segments; ++i) {
+            const QPointF b = GraphStore::curvePoint(p0, p2, qreal(i) / segments);
+            // squared distance from the point to the segment a-b
+            const QPointF ab = b - a;
+            const qreal length = QPointF::dotProduct(ab, ab);
+            const qreal t = length > 0 ? qBound(qreal(0), QPointF::dotProduct(point - a, ab) / length, qreal(1)) : 0;
+            const QPointF offset = point - (a + t * ab);
+            const qreal distance = QPointF::dotProduct(offset, offset);
+            if (distance <= closestDistance) {
+                closestDistance = distance;
+                closest = connectionId;
+            }
+            a = b;
+        }
     }
+    return closest;
+}
 
-    QJsonObject sceneObject;
-    sceneObject[getKey(JsonKeyID::ZoomFactor)] = m_zoomFactor;
+/**
+ * @brief GraphCore::hasConnection checks whether the port takes part in any connection
+ * The store keeps the degree of every port, so the cost does not depend on the number of connections
+ * @param graphNodePort a port
+ */
+bool GraphCore::hasConnection(const GraphNodePort *graphNodePort) const
+{
+    GRAPHVIEW_PROFILE_COUNT("GraphCore::hasConnection", 1);
+    return graphNodePort->isValid() && m_store.portDegree(graphNodePort->id()) > 0;
+}
 
-    QJsonArray nodes;
-    for (const auto n : m_graphNodes) {
-        QJsonObject nodeObject;
-        GraphNode *node = static_cast<GraphNode *>(n);
-        nodeObject[getKey(JsonKeyID::Name)] = node->name();
-        nodeObject[getKey(JsonKeyID::XCoord)] = node->coord().x();
-        nodeObject[getKey(JsonKeyID::YCoord)] = node->coord().y();
+/**
+ * @brief GraphCore::connectionCount returns the number of connections attached to the port
+ * @param graphNodePort a port
+ */
+int GraphCore::connectionCount(const GraphNodePort *graphNodePort) const
+{
+    return graphNodePort->isValid() ? m_store.portDegree(graphNodePort->id()) : 0;
+}
 
-        QJsonArray ports;
-        for (const auto out : (node->outputPorts() + node->inputPorts())) {
-            GraphNodePort *outPort = static_cast<GraphNodePort *>(out);
-            QJsonObject portObject;
-            portObject[getKey(JsonKeyID::Name)] = outPort->name();
-            portObject[getKey(JsonKeyID::Type)] = outPort->portType();
-            const QVariant &value = outPort->value();
-            if (value.type() == QVariant::Double)
-                portObject[getKey(JsonKeyID::Value)] = value.toDouble();
-            else
-                portObject[getKey(JsonKeyID::Value)] = value.toString();
+/**
+ * @brief GraphCore::nodeDegree returns the number of connections attached to any port of the node
+ * @param graphNode a node
+ */
+int GraphCore::nodeDegree(const GraphNode *graphNode) const
+{
+    return graphNode->isValid() ? m_store.nodeDegree(graphNode->id()) : 0;
+}
 
-            ports.append(portObject);
-        }
-        nodeObject[getKey(JsonKeyID::Ports)] = ports;
+/**
+ * @brief GraphCore::portConnections returns connections attached to the port, O(degree)
+ * @param graphNodePort a port
+ */
+QObjectList GraphCore::portConnections(const GraphNodePort *graphNodePort) const
+{
+    QObjectList connections;
+    if (!graphNodePort->isValid())
+        return connections;
+    for (int connectionId : m_store.portConnections(graphNodePort->id()))
+        connections.append(connectionObject(connectionId));
+    return connections;
+}
 
-        nodes.append(nodeObject);
+/**
+ * @brief GraphCore::nodeConnections returns connections attached to any port of the node, O(degree)
+ * @param graphNode a node
+ */
+QObjectList GraphCore::nodeConnections(const GraphNode *graphNode) const
+{
+    QObjectList connections;
+    if (!graphNode->isValid())
+        return connections;
+    for (int connectionId : m_store.nodeConnections(graphNode->id()))
+        connections.append(connectionObject(connectionId));
+    return connections;
+}
+
+/**
+ * @brief GraphCore::addPort appends a port to a node
+ * @param nodeId node handle
+ * @param portType direction
+ * @param name port name, unique per node and direction
+ * @param value port value
+ * @return handle of the new port or GraphStore::InvalidId
+ */
+int GraphCore::addPort(int nodeId, GraphStore::PortType portType, const QString &name, const QVariant &value)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::addPort");
+    if (!m_store.isNode(nodeId))
+        return GraphStore::InvalidId;
+    if (!GraphStore::isPortType(portType)) {
+        emit errorOccurred(tr("Port '%1' has the unknown type %2").arg(name).arg(int(portType)));
+        return GraphStore::InvalidId;
     }
-    sceneObject[getKey(JsonKeyID::Nodes)] = nodes;
 
-    QJsonArray connections;
-    for (const auto c : m_graphConnections) {
-        GraphConnection *conn = static_cast<GraphConnection *>(c);
-        QJsonObject connectionObject;
-        connectionObject[getKey(JsonKeyID::Source)] = conn->outputPort()->node()->name();
-        connectionObject[getKey(JsonKeyID::Output)] = conn->outputPort()->name();
-        connectionObject[getKey(JsonKeyID::Target)] = conn->inputPort()->node()->name();
-        connectionObject[getKey(JsonKeyID::Input)] = conn->inputPort()->name();
-        connections.append(connectionObject);
+    const int portId = m_store.addPort(nodeId, portType, name, value);
+    if (portId == GraphStore::InvalidId) {
+        if (portType == GraphStore::OutputPort)
+            emit errorOccurred(tr("Output port '%1' already exists").arg(name));
+        else
+            emit errorOccurred(tr("Input port '%1' already exists").arg(name));
+        return GraphStore::InvalidId;
     }
-    sceneObject[getKey(JsonKeyID::Connections)] = connections;
+    invalidateResults(nodeId);
+    if (QObject *node = m_nodeObjects.value(nodeId))
+        static_cast<GraphNode *>(node)->appendPortObject(portObject(portId));
+    m_journal.portAdded(m_store.nodeName(nodeId), portType, name, value);
 
-    QJsonDocument doc;
-    doc.setObject(sceneObject);
+    m_pendingChanges.portsChanged(m_store.nodeNameId(nodeId));
+    emit portAdded(portId);
+    commitChanges();
+    return portId;
+}
+
+/**
+ * @brief GraphCore::removePort removes a port of a node together with its connections
+ * @param nodeId node handle
+ * @param portType direction
+ * @param name port name
+ */
+bool GraphCore::removePort(int nodeId, GraphStore::PortType portType, const QString &name)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::removePort");
+    if (!m_store.isNode(nodeId) || !GraphStore::isPortType(portType))
+        return false;
+
+    const int portId = m_store.findPort(nodeId, portType, name);
+    if (portId == GraphStore::InvalidId) {
+        if (portType == GraphStore::OutputPort)
+            emit errorOccurred(tr("Output port '%1' does not exist").arg(name));
+        else
+            emit errorOccurred(tr("Input port '%1' does not exist").arg(name));
+        return false;
+    }
+    invalidateResults(nodeId);
+    removePortConnections(portId);
+    m_journal.portRemoved(m_store.nodeName(nodeId), portType, name);
 
-    QTextStream stream(&outputFile);
-    stream << doc.toJson();
+    m_pendingChanges.portsChanged(m_store.nodeNameId(nodeId));
+    emit portRemoved(portId);
+    QObject *port = m_portObjects.value(portId);
+    QObject *node = m_nodeObjects.value(nodeId);
+    if (port && node)
+        static_cast<GraphNode *>(node)->removePortObject(static_cast<GraphNodePort *>(port));
+    releaseObject(m_portObjects, m_portObjectPool, portId);
+    m_store.removePort(portId);
+    // the ports below moved up
+    updateConnectionBounds(nodeId);
+    commitChanges();
     return true;
 }
 
-bool GraphCore::loadFrom(const QString &fileName)
+/**
+ * @brief GraphCore::setNodeCoord moves a node
+ * @param nodeId node handle
+ * @param coord new position in scene coordinates
+ */
+void GraphCore::setNodeCoord(int nodeId, const QPointF &coord)
 {
-    QFile inputFile(fileName);
-    if (!inputFile.open(QFile::ReadOnly | QFile::Text)) {
-        emit errorOccurred(tr("Unable to open file '%1'").arg(fileName));
+    // supersedes a move queued for the next frame
+    m_pendingMoves.remove(nodeId);
+    moveNode(nodeId, coord, true);
+}
+
+/**
+ * @brief GraphCore::moveNodeTo moves a node by name, e.g. while it is dragged
+ * The move is applied with the others requested within the same frame, see flushMoves()
+ * @param name node name
+ * @param x new horizontal position in scene coordinates
+ * @param y new vertical position in scene coordinates
+ * @return false if the node does not exist
+ */
+bool GraphCore::moveNodeTo(const QString &name, qreal x, qreal y)
+{
+    const int nodeId = m_store.findNode(name);
+    if (nodeId == GraphStore::InvalidId) {
+        emit errorOccurred(tr("Graph node '%1' does not exist").arg(name));
         return false;
     }
+    queueMove(nodeId, QPointF(x, y));
+    return true;
+}
 
-    QTextStream stream(&inputFile);
-    QJsonParseError err;
-    QJsonDocument doc = QJsonDocument::fromJson(stream.readAll().toLocal8Bit(), &err);
-    if (err.error != QJsonParseError::ParseError::NoError) {
-        emit errorOccurred(err.errorString());
-        return false;
+/**
+ * @brief GraphCore::moveNodesBy moves several nodes by the same offset, e.g. a dragged selection
+ * The offset adds to moves requested earlier in the same frame, see flushMoves()
+ * @param names node names
+ * @param dx horizontal offset
+ * @param dy vertical offset
+ * @return false if some of the nodes do not exist, the others are moved anyway
+ */
+bool GraphCore::moveNodesBy(const QStringList &names, qreal dx, qreal dy)
+{
+    bool moved = true;
+    for (const QString &name : names) {
+        const int nodeId = m_store.findNode(name);
+        if (nodeId == GraphStore::InvalidId) {
+            emit errorOccurred(tr("Graph node '%1' does not exist").arg(name));
+            moved = false;
+            continue;
+        }
+        queueMove(nodeId, m_pendingMoves.value(nodeId, m_store.nodeCoord(nodeId)) + QPointF(dx, dy));
     }
+    return moved;
+}
 
-    QJsonObject sceneObject = doc.object();
-    if (sceneObject.isEmpty()) {
-        emit errorOccurred(tr("File '%1' does not contain proper data").arg(fileName));
-        return false;
+/**
+ * @brief GraphCore::flushMoves applies the moves requested since the last frame in one update
+ * Every node moves once, to the last position requested for it, so only the connections
+ * attached to the moved nodes are touched and views are notified once per frame
+ */
+void GraphCore::flushMoves()
+{
+    m_moveTimer.stop();
+    if (m_pendingMoves.isEmpty())
+        return;
+
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::flushMoves");
+    GRAPHVIEW_PROFILE_COUNT("GraphCore::flushMoves::nodes", m_pendingMoves.size());
+    const QHash<int, QPointF> moves = m_pendingMoves;
+    m_pendingMoves.clear();
+    beginUpdate();
+    for (auto it = moves.cbegin(); it != moves.cend(); ++it)
+        moveNode(it.key(), it.value(), true);
+    endUpdate();
+}
+
+/**
+ * @brief GraphCore::queueMove records the position a node moves to with the next frame
+ */
+void GraphCore::queueMove(int nodeId, const QPointF &coord)
+{
+    m_pendingMoves.insert(nodeId, coord);
+    if (!m_moveTimer.isActive())
+        m_moveTimer.start();
+}
+
+/**
+ * @brief GraphCore::moveNode moves a node
+ * @param nodeId node handle
+ * @param coord new position in scene coordinates
+ * @param journaled false for intermediate positions, e.g. the frames of a running layout
+ */
+void GraphCore::moveNode(int nodeId, const QPointF &coord, bool journaled)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::moveNode");
+    if (!m_store.isNode(nodeId) || m_store.nodeCoord(nodeId) == coord)
+        return;
+    // NaN never compares equal, so it is caught here before it reaches the spatial indices
+    if (!qIsFinite(coord.x()) || !qIsFinite(coord.y())) {
+        qWarning() << "Ignoring a non-finite position of node" << m_store.nodeName(nodeId) << coord;
+        return;
     }
 
+    m_store.setNodeCoord(nodeId, coord);
+    m_spatialIndex.update(nodeId, m_store.nodeRect(nodeId));
+    updateConnectionBounds(nodeId);
+    if (journaled)
+        m_journal.nodeMoved(m_store.nodeName(nodeId), coord);
+    m_pendingChanges.nodeMoved(m_store.nodeNameId(nodeId));
+    if (QObject *node = m_nodeObjects.value(nodeId))
+        emit static_cast<GraphNode *>(node)->coordChanged();
+    emit nodeMoved(nodeId);
+    commitChanges();
+}
 
-    for (auto conn : m_graphConnections)
-        conn->deleteLater();
-    m_graphConnections.clear();
+/**
+ * @brief GraphCore::setPortValue changes the value of a port, the results downstream become dirty
+ * @param portId port handle
+ * @param value new value, a string is an expression
+ */
+void GraphCore::setPortValue(int portId, const QVariant &value)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::setPortValue");
+    if (!m_store.isPort(portId) || m_store.portValue(portId) == value)
+        return;
 
-    for (auto node : m_graphNodes)
-        node->deleteLater();
-    m_graphNodes.clear();
+    const int nodeId = m_store.portNode(portId);
+    const QColor oldColor = m_store.portColor(portId);
+    m_store.setPortValue(portId, value);
+    m_journal.portValueChanged(m_store.nodeName(nodeId), m_store.portType(portId), m_store.portName(portId), value);
+    invalidateResults(nodeId);
+    m_pendingChanges.portsChanged(m_store.nodeNameId(nodeId));
+    if (QObject *port = m_portObjects.value(portId))
+        emit static_cast<GraphNodePort *>(port)->valueChanged();
+    // the colour follows the type of the value, connections take the colour of their output
+    if (m_store.portColor(portId) != oldColor) {
+        if (QObject *port = m_portObjects.value(portId))
+            emit static_cast<GraphNodePort *>(port)->elementChanged();
+        for (int connectionId = m_store.firstConnection(portId); connectionId != GraphStore::InvalidId;
+             connectionId = m_store.nextConnection(connectionId, portId)) {
+            if (m_store.connectionOutput(connectionId) != portId)
+                continue;
+            if (QObject *connection = m_connectionObjects.value(connectionId))
+                emit static_cast<GraphConnection *>(connection)->elementChanged();
+        }
+    }
+    commitChanges();
+}
 
-    m_zoomFactor = sceneObject.value(getKey(JsonKeyID::ZoomFactor)).toInt(1.0);
+/**
+ * @brief GraphCore::graphData returns a copy of the whole graph as plain values
+ */
+GraphData GraphCore::graphData() const
+{
+    return graphData(m_store, m_zoomFactor);
+}
 
-    QSignalBlocker block(this);
-    const QJsonArray nodes = sceneObject.value(getKey(JsonKeyID::Nodes)).toArray();
-    for (const auto &node : nodes) {
-        if (!node.isObject()) {
-            qWarning() << "Node is not a JSON object";
+/**
+ * @brief GraphCore::graphData converts a store into plain values
+ * Reads nothing but the given store, so it may run on any thread with a copy of the store
+ * @param store graph elements
+ * @param zoomFactor zoom factor saved with the graph
+ */
+GraphData GraphCore::graphData(const GraphStore &store, double zoomFactor)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::graphData");
+    GraphData data;
+    data.zoomFactor = zoomFactor;
+    data.nodes.reserve(store.nodeCount());
+    for (int nodeId = 0; nodeId < store.nodeCapacity(); ++nodeId) {
+        if (!store.isNode(nodeId))
             continue;
+        GraphNodeData nodeData;
+        nodeData.name = store.nodeName(nodeId);
+        nodeData.coord = store.nodeCoord(nodeId);
+        for (int portId = store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = store.nextPort(portId)) {
+            GraphPortData portData;
+            portData.name = store.portName(portId);
+            portData.portType = store.portType(portId);
+            portData.value = store.portValue(portId);
+            nodeData.ports.append(portData);
         }
-        const QJsonObject &nodeObject = node.toObject();
-        const QString &name = nodeObject.value(getKey(JsonKeyID::Name)).toString();
-        const qreal x = nodeObject.value(getKey(JsonKeyID::XCoord)).toDouble();
-        const qreal y = nodeObject.value(getKey(JsonKeyID::YCoord)).toDouble();
-        if (!addGraphNode(name, x, y)) {
-            qWarning() << "Unable to add a new node:" << name;
+        data.nodes.append(nodeData);
+    }
+
+    data.connections.reserve(store.connectionCount());
+    for (int connectionId = 0; connectionId < store.connectionCapacity(); ++connectionId) {
+        if (!store.isConnection(connectionId))
             continue;
-        }
-        GraphNode *graphNode = findNode(name);
-        const QJsonArray &ports = nodeObject.value(getKey(JsonKeyID::Ports)).toArray();
-        for (const auto &p : ports) {
-            const QJsonObject &port = p.toObject();
-            const QString &name = port.value(getKey(JsonKeyID::Name)).toString();
-            const int portType = port.value(getKey(JsonKeyID::Type)).toInt();
-            const QJsonValue &value = port.value(getKey(JsonKeyID::Value));
-            QVariant val;
-            if (value.isDouble()) {
-                val = value.toDouble();
-            }
-            else {
-                const QString &str = value.toString();
-                bool ok = false;
-                int intVal = str.toInt(&ok);
-                if (ok)
-                    val = intVal;
-                else
-                    val = str;
-            }
-            if (portType == GraphNodePort::OutputPort)
-                graphNode->addOutputPort(name, value);
-            else
-                graphNode->addInputPort(name, value);
-        }
+        const int outPortId = store.connectionOutput(connectionId);
+        const int inPortId = store.connectionInput(connectionId);
+        GraphConnectionData connectionData;
+        connectionData.sourceNode = store.nodeName(store.portNode(outPortId));
+        connectionData.outputPort = store.portName(outPortId);
+        connectionData.targetNode = store.nodeName(store.portNode(inPortId));
+        connectionData.inputPort = store.portName(inPortId);
+        data.connections.append(connectionData);
     }
+    return data;
+}
+
+/**
+ * @brief GraphCore::setGraphData replaces the whole graph, the change is committed as one update
+ * @param data new graph
+ */
+void GraphCore::setGraphData(const GraphData &data)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::setGraphData");
+    beginUpdate();
+    clearGraph();
+
+    int portCount = 0;
+    for (const GraphNodeData &nodeData : data.nodes)
+        portCount += nodeData.ports.size();
+    m_store.reserve(data.nodes.size(), portCount, data.connections.size());
 
-    const QJsonArray connections = sceneObject.value(getKey(JsonKeyID::Connections)).toArray();
-    for (const auto &conn : connections) {
-        if (!conn.isObject()) {
-            qWarning() << "Connection is not a JSON object";
+    m_zoomFactor = data.zoomFactor;
+    for (const GraphNodeData &nodeData : data.nodes) {
+        if (!addGraphNode(nodeData.name, nodeData.coord.x(), nodeData.coord.y())) {
+            qWarning() << "Unable to add a new node:" << nodeData.name;
             continue;
         }
-        const QJsonObject &connectionObject = conn.toObject();
-        const QString &source = connectionObject.value(getKey(JsonKeyID::Source)).toString();
-        const QString &out = connectionObject.value(getKey(JsonKeyID::Output)).toString();
-        const QString &target = connectionObject.value(getKey(JsonKeyID::Target)).toString();
-        const QString &in = connectionObject.value(getKey(JsonKeyID::Input)).toString();
-        if (!addGraphConnection(source, out, target, in)) {
-            qWarning() << "Unable to add a new connection:" << source << out << target << in;
+        const int nodeId = m_store.findNode(nodeData.name);
+        for (const GraphPortData &portData : nodeData.ports) {
+            // like before the store, every type but an output is loaded as an input
+            const GraphStore::PortType portType = portData.portType == GraphStore::OutputPort ? GraphStore::OutputPort
+                                                                                             : GraphStore::InputPort;
+            addPort(nodeId, portType, portData.name, portData.value);
+        }
+    }
+
+    for (const GraphConnectionData &conn : data.connections) {
+        if (!addGraphConnection(conn.sourceNode, conn.outputPort, conn.targetNode, conn.inputPort)) {
+            qWarning() << "Unable to add a new connection:" << conn.sourceNode << conn.outputPort << conn.targetNode << conn.inputPort;
             continue;
         }
     }
+    endUpdate();
+}
 
+/**
+ * @brief GraphCore::readGraphData reads a graph file without touching any GraphCore
+ * The format is chosen by the file suffix: binary for GraphBinaryFormat::fileSuffix(), JSON otherwise
+ * @param fileName file name
+ * @param data receives the graph
+ * @param errorString receives a description of the error
+ * @return false if the file could not be read
+ */
+bool GraphCore::readGraphData(const QString &fileName, GraphData *data, QString *errorString)
+{
+    LoadResult result = readGraphFile(fileName, nullptr, GraphJsonReader::ProgressHandler());
+    if (!result.ok) {
+        *errorString = result.errorString;
+        return false;
+    }
+    *data = std::move(result.data);
     return true;
 }
 
-GraphCore::JsonKeyID GraphCore::getId(const QString &key)
+/**
+ * @brief GraphCore::writeGraphData writes a graph file without touching any GraphCore
+ * The format is chosen by the file suffix: binary for GraphBinaryFormat::fileSuffix(), JSON otherwise
+ * @param fileName file name
+ * @param data graph
+ * @param errorString receives a description of the error
+ * @return false if the file could not be written
+ */
+bool GraphCore::writeGraphData(const QString &fileName, const GraphData &data, QString *errorString)
 {
-    static QHash<QString, GraphCore::JsonKeyID> aliases;
-    if (aliases.isEmpty()) {
-        for (int i = 0; i < JsonKeyID::END_ID; ++i) {
-            const JsonKeyID key = static_cast<JsonKeyID>(i);
-            aliases[getKey(key)] = key;
-        }
-    }
-    return aliases.value(key, JsonKeyID::Undefined);
+    const SaveResult result = writeGraphFile(fileName, data);
+    if (!result.ok)
+        *errorString = result.errorString;
+    return result.ok;
 }
 
-QString GraphCore::getKey(GraphCore::JsonKeyID id)
+/**
+ * @brief GraphCore::save saves all objects to the source file in the background
+ * The result is reported by saved() or errorOccurred()
+ */
+void GraphCore::save()
 {
-    static QVector<QString> aliases;
-    if (aliases.isEmpty()) {
-        aliases.reserve(JsonKeyID::END_ID);
-        aliases << QStringLiteral("name") << QStringLiteral("zoom_factor")
-                << QStringLiteral("nodes") << QStringLiteral("connections")
-                << QStringLiteral("ports") << QStringLiteral("type")
-                << QStringLiteral("x") << QStringLiteral("y") << QStringLiteral("value")
-                << QStringLiteral("source") << QStringLiteral("target")
-                << QStringLiteral("output") << QStringLiteral("input");
-    }
+    saveAsync(sourceFileName());
+}
+
+/**
+ * @brief GraphCore::saveAs saves all objects to a new file in the background
+ * The new file becomes the source file right away, so later saves go to it as well.
+ * The journal moves to the new file, the changes it held are part of the saved graph.
+ * @param fileName new file name
+ */
+void GraphCore::saveAs(const QString &fileName)
+{
+    if (!isJournaling() || m_journal.fileName() != GraphJournal::fileNameFor(fileName)) {
+        m_journal.discard();
+        stopJournal();
+        startJournal(fileName, 0);
+    }
+    saveAsync(fileName);
+
+    if (sourceFileName() != fileName) {
+        m_sourceFileName = fileName;
+        emit sourceFileNameChanged(m_sourceFileName);
+    }
+}
+
+/**
+ * @brief GraphCore::load loads data from file
+ * @param fileName a file name
+ */
+void GraphCore::load(const QString &fileName)
+{
+    if (!loadFrom(fileName))
+        return;
+
+    if (sourceFileName() != fileName) {
+        m_sourceFileName = fileName;
+        emit sourceFileNameChanged(m_sourceFileName);
+    }
+}
+
+/**
+ * @brief GraphCore::beginUpdate starts a batch of changes
+ * Until the matching endUpdate() the changes are only collected, then they are
+ * reported at once by changesCommitted() and a single graphChanged().
+ * Updates can be nested, the outermost one commits the changes.
+ * Typed signals like nodeAdded() are still emitted for every change.
+ */
+void GraphCore::beginUpdate()
+{
+    if (m_updateDepth++ > 0)
+        return;
+
+    m_nodeModel->beginBatch();
+    m_visibleNodeModel->beginBatch();
+    m_connectionModel->beginBatch();
+}
+
+/**
+ * @brief GraphCore::endUpdate finishes a batch of changes started by beginUpdate()
+ */
+void GraphCore::endUpdate()
+{
+    if (m_updateDepth == 0) {
+        qWarning() << "GraphCore::endUpdate() without beginUpdate()";
+        return;
+    }
+    if (--m_updateDepth > 0)
+        return;
+
+    m_nodeModel->endBatch();
+    m_visibleNodeModel->endBatch();
+    m_connectionModel->endBatch();
+    commitChanges();
+}
+
+/**
+ * @brief GraphCore::addGraphNode creates a new node
+ * @param name of a new node
+ */
+bool GraphCore::addGraphNode(const QString &name, qreal x, qreal y)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::addGraphNode");
+    if (name.isEmpty()) {
+        emit errorOccurred(tr("Graph node name is empty"));
+        return false;
+    }
+    if (!qIsFinite(x) || !qIsFinite(y)) {
+        emit errorOccurred(tr("Graph node '%1' has an invalid position").arg(name));
+        return false;
+    }
+    const int nodeId = m_store.addNode(name, QPointF(x, y));
+    if (nodeId == GraphStore::InvalidId) {
+        emit errorOccurred(tr("Graph node '%1' already exists").arg(name));
+        return false;
+    }
+    m_nodeModel->append(nodeId);
+    m_spatialIndex.insert(nodeId, m_store.nodeRect(nodeId));
+    m_journal.nodeAdded(name, QPointF(x, y));
+    invalidateResults(nodeId);
+
+    m_pendingChanges.nodeAdded(m_store.nodeNameId(nodeId));
+    emit nodeAdded(nodeId);
+    commitChanges();
+    return true;
+}
+
+/**
+ * @brief GraphCore::removeGraphNode removes node together with its ports and their connections
+ * @param name of removed node
+ */
+bool GraphCore::removeGraphNode(const QString &name)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::removeGraphNode");
+    const int nodeId = m_store.findNode(name);
+    if (nodeId == GraphStore::InvalidId) {
+        emit errorOccurred(tr("Graph node '%1' does not exist").arg(name));
+        return false;
+    }
+    // the rows of the node and of all its connections leave the models in one pass
+    beginUpdate();
+    invalidateResults(nodeId);
+    const QVector<int> ports = m_store.nodePorts(nodeId);
+    for (int portId : ports)
+        removePortConnections(portId);
+    m_nodeModel->remove(nodeId);
+    m_spatialIndex.remove(nodeId);
+    m_pendingMoves.remove(nodeId);
+    m_journal.nodeRemoved(name);
+
+    m_pendingChanges.nodeRemoved(m_store.nodeNameId(nodeId));
+    emit nodeRemoved(nodeId);
+    for (int portId : ports)
+        releaseObject(m_portObjects, m_portObjectPool, portId);
+    releaseObject(m_nodeObjects, m_nodeObjectPool, nodeId);
+    m_store.removeNode(nodeId);
+    m_evaluator.forgetNode(nodeId);
+    endUpdate();
+    return true;
+}
+
+/**
+ * @brief GraphCore::removeGraphNodes removes several nodes with their ports and connections in one update
+ * During the update the models only mark the removed rows, so every node costs O(ports + degree)
+ * and the views and changesCommitted() are notified once
+ * @param names of removed nodes
+ * @return false if some of the nodes do not exist, the others are removed anyway
+ */
+bool GraphCore::removeGraphNodes(const QStringList &names)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::removeGraphNodes");
+    bool removed = true;
+    beginUpdate();
+    for (const QString &name : names) {
+        if (!removeGraphNode(name))
+            removed = false;
+    }
+    endUpdate();
+    return removed;
+}
+
+/**
+ * @brief GraphCore::addGraphConnection creates a new connection, convenience overload taking names
+ * @param src name of the source node
+ * @param out output port name of the source node
+ * @param dest name of the destination node
+ * @param in input port name of the destination node
+ */
+bool GraphCore::addGraphConnection(const QString &src, const QString &out, const QString &dest, const QString &in)
+{
+    const int sourceNodeId = m_store.findNode(src);
+    if (sourceNodeId == GraphStore::InvalidId) {
+        emit errorOccurred(tr("Unable to find '%1' node").arg(src));
+        return false;
+    }
+    const int destNodeId = m_store.findNode(dest);
+    if (destNodeId == GraphStore::InvalidId) {
+        emit errorOccurred(tr("Unable to find '%1' node").arg(dest));
+        return false;
+    }
+    const int outPortId = m_store.findPort(sourceNodeId, GraphStore::OutputPort, out);
+    if (outPortId == GraphStore::InvalidId) {
+        emit errorOccurred(tr("Unable to find '%1' port").arg(out));
+        return false;
+    }
+    const int inPortId = m_store.findPort(destNodeId, GraphStore::InputPort, in);
+    if (inPortId == GraphStore::InvalidId) {
+        emit errorOccurred(tr("Unable to find '%1' port").arg(in));
+        return false;
+    }
+    return addGraphConnection(outPortId, inPortId);
+}
+
+/**
+ * @brief GraphCore::addGraphConnection connects an output port to an input port
+ * @param outPortId output port handle
+ * @param inPortId input port handle
+ */
+bool GraphCore::addGraphConnection(int outPortId, int inPortId)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::addGraphConnection");
+    if (!m_store.isPort(outPortId) || m_store.portType(outPortId) != GraphStore::OutputPort) {
+        emit errorOccurred(tr("Port %1 is not an output port").arg(outPortId));
+        return false;
+    }
+    if (!m_store.isPort(inPortId) || m_store.portType(inPortId) != GraphStore::InputPort) {
+        emit errorOccurred(tr("Port %1 is not an input port").arg(inPortId));
+        return false;
+    }
+    if (m_store.portNode(outPortId) == m_store.portNode(inPortId)) {
+        emit errorOccurred(tr("Source and target node cannot be the same: %1").arg(m_store.nodeName(m_store.portNode(outPortId))));
+        return false;
+    }
+    if (m_store.findConnection(outPortId, inPortId) != GraphStore::InvalidId) {
+        emit errorOccurred(tr("Connection '%1' already exists").arg(connectionName(outPortId, inPortId)));
+        return false;
+    }
+
+    const int connectionId = m_store.addConnection(outPortId, inPortId);
+    m_connectionIndex.insert(connectionId, m_store.connectionRect(connectionId));
+    m_connectionModel->append(connectionId);
+    m_journal.connectionAdded(m_store.nodeName(m_store.portNode(outPortId)), m_store.portName(outPortId),
+                              m_store.nodeName(m_store.portNode(inPortId)), m_store.portName(inPortId));
+    for (int portId : { outPortId, inPortId }) {
+        if (m_store.portDegree(portId) == 1)
+            notifyPortConnected(portId);
+    }
+    invalidateResults(m_store.portNode(inPortId));
+
+    m_pendingChanges.connectionAdded(changeKey(outPortId, inPortId));
+    emit connectionAdded(connectionId);
+    commitChanges();
+    return true;
+}
+
+/**
+ * @brief GraphCore::removeGraphConnection removes connection, convenience overload taking its name
+ * @param name of connection
+ */
+bool GraphCore::removeGraphConnection(const QString &name)
+{
+    const int connectionId = findConnection(name);
+    if (connectionId == GraphStore::InvalidId) {
+        emit errorOccurred(tr("Connection '%1' does not exist").arg(name));
+        return false;
+    }
+    return removeGraphConnection(connectionId);
+}
+
+/**
+ * @brief GraphCore::removeGraphConnection removes connection
+ * @param connectionId connection handle
+ */
+bool GraphCore::removeGraphConnection(int connectionId)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::removeGraphConnection");
+    if (!m_store.isConnection(connectionId)) {
+        emit errorOccurred(tr("Connection %1 does not exist").arg(connectionId));
+        return false;
+    }
+    removeConnection(connectionId);
+    commitChanges();
+    return true;
+}
+
+/**
+ * @brief GraphCore::setZoomFactor sets a new zoom factor
+ * @param zoomFactor value of a new zoom factor
+ */
+void GraphCore::setZoomFactor(double zoomFactor)
+{
+    qWarning("Floating point comparison needs context sanity check");
+    if (qFuzzyCompare(m_zoomFactor, zoomFactor))
+        return;
+
+    m_zoomFactor = zoomFactor;
+    m_journal.zoomFactorChanged(zoomFactor);
+}
+
+/**
+ * @brief GraphCore::saveTo saves all current data to file synchronously
+ * The format is chosen by the file suffix: binary for GraphBinaryFormat::fileSuffix(), JSON otherwise
+ * @param fileName file name
+ * @return result of saving
+ */
+bool GraphCore::saveTo(const QString &fileName)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::saveTo");
+    flushMoves();
+    const SaveResult result = writeGraphFile(fileName, graphData());
+    if (!result.ok) {
+        emit errorOccurred(result.errorString);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief GraphCore::writeGraphFile writes a graph snapshot to file
+ * The file is written to a temporary file which replaces the target only when complete.
+ * Does not touch any GraphCore state, so it may run on any thread. The only shared
+ * data it reads is the key table of getKey(), which is immutable once initialised
+ * @param fileName file name
+ * @param data graph snapshot
+ */
+GraphCore::SaveResult GraphCore::writeGraphFile(const QString &fileName, const GraphData &data)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::writeGraphFile");
+    SaveResult result;
+    result.fileName = fileName;
+    if (GraphBinaryFormat::isBinaryFileName(fileName)) {
+        result.ok = GraphBinaryFormat::write(data, fileName, &result.errorString);
+        return result;
+    }
+
+    QJsonObject sceneObject;
+    sceneObject[getKey(JsonKeyID::ZoomFactor)] = data.zoomFactor;
+
+    QJsonArray nodes;
+    for (const GraphNodeData &node : data.nodes) {
+        QJsonObject nodeObject;
+        nodeObject[getKey(JsonKeyID::Name)] = node.name;
+        nodeObject[getKey(JsonKeyID::XCoord)] = node.coord.x();
+        nodeObject[getKey(JsonKeyID::YCoord)] = node.coord.y();
+
+        QJsonArray ports;
+        for (const GraphPortData &port : node.ports) {
+            QJsonObject portObject;
+            portObject[getKey(JsonKeyID::Name)] = port.name;
+            portObject[getKey(JsonKeyID::Type)] = port.portType;
+            if (port.value.type() == QVariant::Double)
+                portObject[getKey(JsonKeyID::Value)] = port.value.toDouble();
+            else
+                portObject[getKey(JsonKeyID::Value)] = port.value.toString();
+
+            ports.append(portObject);
+        }
+        nodeObject[getKey(JsonKeyID::Ports)] = ports;
+
+        nodes.append(nodeObject);
+    }
+    sceneObject[getKey(JsonKeyID::Nodes)] = nodes;
+
+    QJsonArray connections;
+    for (const GraphConnectionData &conn : data.connections) {
+        QJsonObject connectionObject;
+        connectionObject[getKey(JsonKeyID::Source)] = conn.sourceNode;
+        connectionObject[getKey(JsonKeyID::Output)] = conn.outputPort;
+        connectionObject[getKey(JsonKeyID::Target)] = conn.targetNode;
+        connectionObject[getKey(JsonKeyID::Input)] = conn.inputPort;
+        connections.append(connectionObject);
+    }
+    sceneObject[getKey(JsonKeyID::Connections)] = connections;
+
+    QJsonDocument doc;
+    doc.setObject(sceneObject);
+
+    QSaveFile outputFile(fileName);
+    if (!outputFile.open(QFile::WriteOnly)) {
+        result.errorString = tr("Unable to open file '%1'").arg(fileName);
+        return result;
+    }
+    const QByteArray json = doc.toJson();
+    if (outputFile.write(json) != json.size() || !outputFile.commit()) {
+        result.errorString = tr("Unable to write file '%1': %2").arg(fileName, outputFile.errorString());
+        return result;
+    }
+    result.ok = true;
+    return result;
+}
+
+/**
+ * @brief GraphCore::saveAsync saves a snapshot of the graph on a worker thread
+ * The snapshot is a copy of the store taken immediately, so the graph can be edited while
+ * the file is written. The store consists of implicitly shared containers, so the copy is O(1)
+ * and edits made during the save only detach the containers they touch. The conversion
+ * to plain values happens on the worker as well.
+ * Saves requested while another one is in progress are coalesced: each requested file
+ * is written once more with the graph as it is when the running save finishes.
+ * @param fileName file name
+ */
+void GraphCore::saveAsync(const QString &fileName)
+{
+    if (m_saveWatcher) {
+        if (!m_pendingSaves.contains(fileName))
+            m_pendingSaves.append(fileName);
+        return;
+    }
+
+    flushMoves();
+    const GraphStore snapshot = m_store;
+    const double zoomFactor = m_zoomFactor;
+    if (isJournaling() && m_journal.fileName() == GraphJournal::fileNameFor(fileName)) {
+        QString errorString;
+        m_journalSaveMark = m_journal.mark(&errorString);
+        if (m_journalSaveMark < 0)
+            emit errorOccurred(errorString);
+    }
+    m_saveWatcher = new QFutureWatcher<SaveResult>(this);
+    connect(m_saveWatcher, &QFutureWatcher<SaveResult>::finished, this, [this]() {
+        const SaveResult result = m_saveWatcher->result();
+        m_saveWatcher->deleteLater();
+        m_saveWatcher = nullptr;
+
+        // the saved file holds everything journaled before the snapshot
+        const qint64 journalSaveMark = m_journalSaveMark;
+        m_journalSaveMark = -1;
+        if (result.ok && journalSaveMark >= 0 && m_journal.fileName() == GraphJournal::fileNameFor(result.fileName)) {
+            QString errorString;
+            if (!m_journal.compact(journalSaveMark, &errorString))
+                emit errorOccurred(errorString);
+        }
+
+        if (result.ok)
+            emit saved(result.fileName);
+        else
+            emit errorOccurred(result.errorString);
+
+        if (!m_pendingSaves.isEmpty())
+            saveAsync(m_pendingSaves.takeFirst());
+        else
+            emit savingChanged(false);
+    });
+    m_saveWatcher->setFuture(QtConcurrent::run([fileName, snapshot, zoomFactor]() {
+        return writeGraphFile(fileName, graphData(snapshot, zoomFactor));
+    }));
+    emit savingChanged(true);
+}
+
+/**
+ * @brief GraphCore::loadFrom replaces the graph by the content of the file
+ * The format is chosen by the file suffix: binary for GraphBinaryFormat::fileSuffix(), JSON otherwise
+ * @param fileName file name
+ * @return result of loading
+ */
+bool GraphCore::loadFrom(const QString &fileName)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::loadFrom");
+    m_loadCancelFlag.reset(new QAtomicInt(0));
+    const LoadResult result = readGraphFile(fileName, m_loadCancelFlag.data(), [this](qint64 bytesRead, qint64 bytesTotal) {
+        emit loadProgress(bytesRead, bytesTotal);
+    });
+    m_loadCancelFlag.reset();
+    return applyLoadResult(fileName, result);
+}
+
+/**
+ * @brief GraphCore::readGraphFile reads a graph file into a detached GraphData
+ * Does not touch any GraphCore state, so it may run on any thread
+ * @param fileName file name
+ * @param cancelFlag reading stops once the flag becomes non-zero
+ * @param progressHandler called after every chunk of a JSON file
+ */
+GraphCore::LoadResult GraphCore::readGraphFile(const QString &fileName, const QAtomicInt *cancelFlag,
+                                               const GraphJsonReader::ProgressHandler &progressHandler)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::readGraphFile");
+    LoadResult result;
+    if (GraphBinaryFormat::isBinaryFileName(fileName)) {
+        result.ok = GraphBinaryFormat::read(fileName, &result.data, &result.errorString);
+        return result;
+    }
+
+    QFile inputFile(fileName);
+    if (!inputFile.open(QFile::ReadOnly)) {
+        result.errorString = tr("Unable to open file '%1'").arg(fileName);
+        return result;
+    }
+
+    GraphJsonReader reader(&inputFile);
+    reader.setCancelFlag(cancelFlag);
+    reader.setProgressHandler(progressHandler);
+    result.ok = reader.read(&result.data);
+    if (!result.ok) {
+        result.cancelled = reader.isCancelled();
+        result.errorString = tr("File '%1' does not contain proper data: %2").arg(fileName, reader.errorString());
+        result.data = GraphData();
+    }
+    return result;
+}
+
+/**
+ * @brief GraphCore::applyLoadResult swaps the loaded graph in or reports why loading failed
+ * The current graph stays untouched unless the whole file has been read
+ * @return true if the graph has been replaced
+ */
+bool GraphCore::applyLoadResult(const QString &fileName, const LoadResult &result)
+{
+    if (result.cancelled) {
+        emit loadCancelled(fileName);
+        return false;
+    }
+    if (!result.ok) {
+        emit errorOccurred(result.errorString);
+        return false;
+    }
+    stopJournal();
+    setGraphData(result.data);
+    replayJournal(fileName);
+    return true;
+}
+
+/**
+ * @brief GraphCore::loadAsync loads a file on a worker thread
+ * The current graph stays interactive while the file is read, then it is replaced in one update.
+ * A load that fails or is cancelled leaves the current graph untouched.
+ * Starting another load cancels the one in progress.
+ * @param fileName a file name
+ */
+void GraphCore::loadAsync(const QString &fileName)
+{
+    if (m_loadWatcher) {
+        // the worker stops at the next chunk or record, its result is dropped
+        cancelLoad();
+        m_loadWatcher->waitForFinished();
+        delete m_loadWatcher;
+    }
+
+    QSharedPointer<QAtomicInt> cancelFlag(new QAtomicInt(0));
+    m_loadCancelFlag = cancelFlag;
+    m_loadWatcher = new QFutureWatcher<LoadResult>(this);
+    connect(m_loadWatcher, &QFutureWatcher<LoadResult>::finished, this, [this, fileName]() {
+        const LoadResult result = m_loadWatcher->result();
+        m_loadWatcher->deleteLater();
+        m_loadWatcher = nullptr;
+        m_loadCancelFlag.reset();
+        emit loadingChanged(false);
+
+        if (!applyLoadResult(fileName, result))
+            return;
+        if (sourceFileName() != fileName) {
+            m_sourceFileName = fileName;
+            emit sourceFileNameChanged(m_sourceFileName);
+        }
+    });
+
+    // progress is emitted from the worker thread and queued to receivers living in other threads
+    m_loadWatcher->setFuture(QtConcurrent::run([this, fileName, cancelFlag]() {
+        return readGraphFile(fileName, cancelFlag.data(), [this](qint64 bytesRead, qint64 bytesTotal) {
+            emit loadProgress(bytesRead, bytesTotal);
+        });
+    }));
+    emit loadingChanged(true);
+}
+
+/**
+ * @brief GraphCore::cancelLoad stops reading a file, the current graph is kept
+ */
+void GraphCore::cancelLoad()
+{
+    if (m_loadCancelFlag)
+        m_loadCancelFlag->storeRelease(1);
+}
+
+/**
+ * @brief GraphCore::autosave appends the changes made since the last autosave to the journal
+ * The cost depends on the number of changes, not on the size of the graph.
+ * Called periodically while a journal is open, see autosaveInterval
+ */
+void GraphCore::autosave()
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::autosave");
+    QString errorString;
+    if (!m_journal.flush(&errorString))
+        emit errorOccurred(errorString);
+}
+
+/**
+ * @brief GraphCore::evaluate recomputes every node whose results are dirty
+ * Results are also computed on demand by portResult(), which recomputes only what the port
+ * depends on. Cycles and failing expressions are reported by errorOccurred(), the rest of
+ * the graph is evaluated anyway
+ * @return false if some nodes or ports could not be evaluated
+ */
+bool GraphCore::evaluate()
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::evaluate");
+    QString errorString;
+    const bool ok = m_evaluator.evaluate(&errorString);
+    if (!ok)
+        emit errorOccurred(errorString);
+    emit evaluated();
+    return ok;
+}
+
+/**
+ * @brief GraphCore::portResult returns the value computed for a port
+ * A dirty port is brought up to date first, together with the dirty nodes it depends on
+ * @param portId port handle
+ * @return the result, invalid if the port could not be evaluated
+ */
+QVariant GraphCore::portResult(int portId)
+{
+    if (!m_store.isPort(portId))
+        return QVariant();
+
+    if (m_evaluator.isPortDirty(portId)) {
+        QString errorString;
+        if (!m_evaluator.pull(m_store.portNode(portId), &errorString))
+            emit errorOccurred(errorString);
+    }
+    return m_evaluator.result(portId);
+}
+
+/**
+ * @brief GraphCore::layout arranges all nodes, blocking until the layout is done
+ * @param algorithm layout algorithm
+ */
+void GraphCore::layout(LayoutAlgorithm algorithm)
+{
+    cancelLayout();
+    flushMoves();
+    const GraphLayout::Input input = GraphLayout::snapshot(m_store);
+    applyLayout(input, GraphLayout::run(GraphLayout::Algorithm(algorithm), input, nullptr, GraphLayout::FrameHandler()), true);
+}
+
+/**
+ * @brief GraphCore::layoutAsync arranges all nodes on a worker thread
+ * The graph stays interactive meanwhile. Layouts that move nodes step by step show their
+ * intermediate positions, which are not journaled, the final positions are applied in one
+ * update. Nodes removed while the layout runs are skipped, nodes added keep their position.
+ * Starting another layout cancels the one in progress.
+ * @param algorithm layout algorithm
+ */
+void GraphCore::layoutAsync(LayoutAlgorithm algorithm)
+{
+    if (m_layoutWatcher) {
+        cancelLayout();
+        m_layoutWatcher->waitForFinished();
+        delete m_layoutWatcher;
+    }
+
+    flushMoves();
+    const GraphLayout::Input input = GraphLayout::snapshot(m_store);
+    QSharedPointer<QAtomicInt> cancelFlag(new QAtomicInt(0));
+    m_layoutCancelFlag = cancelFlag;
+    m_layoutWatcher = new QFutureWatcher<QVector<QPointF>>(this);
+    connect(m_layoutWatcher, &QFutureWatcher<QVector<QPointF>>::finished, this, [this, input, cancelFlag]() {
+        const QVector<QPointF> coords = m_layoutWatcher->result();
+        m_layoutWatcher->deleteLater();
+        m_layoutWatcher = nullptr;
+        m_layoutCancelFlag.reset();
+        // also drops the frames still queued
+        const bool cancelled = cancelFlag->fetchAndStoreOrdered(1);
+        emit layoutingChanged(false);
+
+        if (!cancelled)
+            applyLayout(input, coords, true);
+    });
+
+    // a frame is queued only when the previous one has been applied, a slow GUI thread skips frames
+    QSharedPointer<QAtomicInt> framePending(new QAtomicInt(0));
+    const GraphLayout::FrameHandler frameHandler = [this, input, cancelFlag, framePending](const QVector<QPointF> &coords, int step, int stepCount) {
+        if (!framePending->testAndSetOrdered(0, 1))
+            return;
+        QMetaObject::invokeMethod(this, [this, input, cancelFlag, framePending, coords, step, stepCount]() {
+            framePending->storeRelease(0);
+            if (cancelFlag->loadAcquire())
+                return;
+            applyLayout(input, coords, false);
+            emit layoutProgress(step, stepCount);
+        }, Qt::QueuedConnection);
+    };
+    m_layoutWatcher->setFuture(QtConcurrent::run([input, cancelFlag, frameHandler, algorithm]() {
+        return GraphLayout::run(GraphLayout::Algorithm(algorithm), input, cancelFlag.data(), frameHandler);
+    }));
+    emit layoutingChanged(true);
+}
+
+/**
+ * @brief GraphCore::cancelLayout stops a layout in progress, the nodes stay where they are
+ */
+void GraphCore::cancelLayout()
+{
+    if (m_layoutCancelFlag)
+        m_layoutCancelFlag->storeRelease(1);
+}
+
+/**
+ * @brief GraphCore::applyLayout moves the nodes of a layout snapshot in one update
+ * @param input snapshot the layout was computed from
+ * @param coords positions in the order of the snapshot
+ * @param journaled false for intermediate positions
+ */
+void GraphCore::applyLayout(const GraphLayout::Input &input, const QVector<QPointF> &coords, bool journaled)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::applyLayout");
+    if (coords.size() != input.nodeIds.size())
+        return;
+
+    beginUpdate();
+    for (int i = 0; i < coords.size(); ++i) {
+        const int nodeId = input.nodeIds.at(i);
+        // the handle may have been reused by a node added while the layout was running
+        if (m_store.isNode(nodeId) && m_store.nodeNameId(nodeId) == input.nodeNameIds.at(i))
+            moveNode(nodeId, coords.at(i), journaled);
+    }
+    endUpdate();
+}
+
+/**
+ * @brief GraphCore::profile returns the profiling statistics together with the element counts
+ * Timings and counters are only collected by builds with CONFIG+=profiling, see GraphProfiler.
+ * elements holds the number of nodes, ports and connections, the facades bound to them and the
+ * detached facades kept for reuse
+ */
+QVariantMap GraphCore::profile() const
+{
+    const auto boundCount = [](const QVector<QObject *> &objects) {
+        return int(objects.size() - objects.count(nullptr));
+    };
+    QVariantMap elements;
+    elements.insert(QStringLiteral("nodes"), m_store.nodeCount());
+    elements.insert(QStringLiteral("ports"), m_store.portCount());
+    elements.insert(QStringLiteral("connections"), m_store.connectionCount());
+    elements.insert(QStringLiteral("nodeFacades"), boundCount(m_nodeObjects));
+    elements.insert(QStringLiteral("portFacades"), boundCount(m_portObjects));
+    elements.insert(QStringLiteral("connectionFacades"), boundCount(m_connectionObjects));
+    elements.insert(QStringLiteral("pooledFacades"),
+                    m_nodeObjectPool.size() + m_portObjectPool.size() + m_connectionObjectPool.size());
+
+    QVariantMap profile = GraphProfiler::instance()->statistics();
+    profile.insert(QStringLiteral("elements"), elements);
+    return profile;
+}
+
+/**
+ * @brief GraphCore::writeTrace exports the recorded profiling events as a Chrome trace
+ * The file opens in chrome://tracing and the Perfetto UI
+ * @param fileName trace file name
+ * @return false if the file could not be written
+ */
+bool GraphCore::writeTrace(const QString &fileName)
+{
+    QString errorString;
+    if (!GraphProfiler::instance()->writeTrace(fileName, &errorString)) {
+        emit errorOccurred(errorString);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief GraphCore::resetProfile drops the recorded profiling events and counters
+ */
+void GraphCore::resetProfile()
+{
+    GraphProfiler::instance()->reset();
+}
+
+/**
+ * @brief GraphCore::setAutosaveInterval sets how often the journal is written
+ * @param autosaveInterval interval in milliseconds, 0 writes the journal only on save and exit
+ */
+void GraphCore::setAutosaveInterval(int autosaveInterval)
+{
+    if (m_autosaveTimer.interval() == autosaveInterval)
+        return;
+
+    m_autosaveTimer.setInterval(autosaveInterval);
+    if (autosaveInterval <= 0)
+        m_autosaveTimer.stop();
+    else if (isJournaling())
+        m_autosaveTimer.start();
+    emit autosaveIntervalChanged(autosaveInterval);
+}
+
+/**
+ * @brief GraphCore::startJournal starts recording changes to the journal of a graph file
+ * @param fileName graph file name
+ * @param validSize part of an existing journal to keep, 0 starts an empty journal
+ */
+void GraphCore::startJournal(const QString &fileName, qint64 validSize)
+{
+    QString errorString;
+    if (!m_journal.open(GraphJournal::fileNameFor(fileName), validSize, &errorString)) {
+        emit errorOccurred(errorString);
+        return;
+    }
+    if (m_autosaveTimer.interval() > 0)
+        m_autosaveTimer.start();
+}
+
+/**
+ * @brief GraphCore::stopJournal writes the pending changes and stops recording
+ */
+void GraphCore::stopJournal()
+{
+    m_autosaveTimer.stop();
+    m_journal.close();
+}
+
+/**
+ * @brief GraphCore::replayJournal applies the journal left next to a graph file, then keeps recording to it
+ * A journal outlives a session only if its changes were not saved, e.g. after a crash.
+ * Its records stay in the journal until the next save compacts it.
+ * @param fileName graph file name
+ */
+void GraphCore::replayJournal(const QString &fileName)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::replayJournal");
+    QVector<GraphJournal::Record> records;
+    qint64 validSize = 0;
+    QString errorString;
+    if (!GraphJournal::read(GraphJournal::fileNameFor(fileName), &records, &validSize, &errorString)) {
+        emit errorOccurred(errorString);
+        return;
+    }
+
+    if (!records.isEmpty()) {
+        beginUpdate();
+        int applied = 0;
+        for (const GraphJournal::Record &record : qAsConst(records)) {
+            if (applyJournalRecord(record))
+                ++applied;
+        }
+        endUpdate();
+        if (applied != records.size())
+            qWarning() << "Skipped" << records.size() - applied << "journal records of" << fileName;
+        emit journalReplayed(fileName, applied);
+    }
+    startJournal(fileName, validSize);
+}
+
+/**
+ * @brief GraphCore::applyJournalRecord repeats one recorded change
+ * @param record journal record
+ * @return false if the change does not fit the graph
+ */
+bool GraphCore::applyJournalRecord(const GraphJournal::Record &record)
+{
+    switch (record.operation) {
+    case GraphJournal::AddNode:
+        return addGraphNode(record.nodeName, record.coord.x(), record.coord.y());
+    case GraphJournal::RemoveNode:
+        return removeGraphNode(record.nodeName);
+    case GraphJournal::MoveNode: {
+        const int nodeId = m_store.findNode(record.nodeName);
+        if (nodeId == GraphStore::InvalidId)
+            return false;
+        setNodeCoord(nodeId, record.coord);
+        return true;
+    }
+    case GraphJournal::AddPort: {
+        const int nodeId = m_store.findNode(record.nodeName);
+        return nodeId != GraphStore::InvalidId
+                && addPort(nodeId, GraphStore::PortType(record.portType), record.portName, record.value) != GraphStore::InvalidId;
+    }
+    case GraphJournal::RemovePort: {
+        const int nodeId = m_store.findNode(record.nodeName);
+        return nodeId != GraphStore::InvalidId
+                && removePort(nodeId, GraphStore::PortType(record.portType), record.portName);
+    }
+    case GraphJournal::SetPortValue: {
+        const int nodeId = m_store.findNode(record.nodeName);
+        if (nodeId == GraphStore::InvalidId)
+            return false;
+        const int portId = m_store.findPort(nodeId, GraphStore::PortType(record.portType), record.portName);
+        if (portId == GraphStore::InvalidId)
+            return false;
+        setPortValue(portId, record.value);
+        return true;
+    }
+    case GraphJournal::AddConnection:
+        return addGraphConnection(record.nodeName, record.portName, record.targetNodeName, record.targetPortName);
+    case GraphJournal::RemoveConnection:
+        return removeGraphConnection(connectionName(record.nodeName, record.portName, record.targetNodeName, record.targetPortName));
+    case GraphJournal::SetZoomFactor:
+        setZoomFactor(record.zoomFactor);
+        return true;
+    case GraphJournal::ClearGraph:
+        clearGraph();
+        return true;
+    default:
+        break;
+    }
+    return false;
+}
+
+/**
+ * @brief GraphCore::clearGraph removes all nodes and connections
+ * The store keeps the capacity of its tables and the facades are kept for reuse,
+ * so building a graph of similar size afterwards hardly allocates.
+ * The change is recorded as a reset of the graph
+ */
+void GraphCore::clearGraph()
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::clearGraph");
+    // a running layout refers to the nodes about to go away
+    cancelLayout();
+    m_pendingMoves.clear();
+    beginUpdate();
+    m_journal.graphCleared();
+    for (int connectionId : connectionIds())
+        emit connectionRemoved(connectionId);
+    m_connectionModel->clear();
+
+    m_visibleNodeModel->clearNodes();
+    for (int nodeId : nodeIds())
+        emit nodeRemoved(nodeId);
+    m_nodeModel->clear();
+    m_spatialIndex.clear();
+    m_connectionIndex.clear();
+
+    for (int id = 0; id < m_connectionObjects.size(); ++id)
+        releaseObject(m_connectionObjects, m_connectionObjectPool, id);
+    for (int id = 0; id < m_portObjects.size(); ++id)
+        releaseObject(m_portObjects, m_portObjectPool, id);
+    for (int id = 0; id < m_nodeObjects.size(); ++id)
+        releaseObject(m_nodeObjects, m_nodeObjectPool, id);
+    m_connectionObjects.clear();
+    m_portObjects.clear();
+    m_nodeObjects.clear();
+    m_store.clear();
+    m_evaluator.clear();
+    m_invalidatedNodes.clear();
+
+    m_pendingChanges.reset();
+    endUpdate();
+}
+
+/**
+ * @brief GraphCore::commitChanges reports the collected changes unless an update is in progress
+ * graphChanged() is emitted only if the structure of the graph has changed
+ */
+void GraphCore::commitChanges()
+{
+    if (m_updateDepth > 0)
+        return;
+    GRAPHVIEW_PROFILE_SCOPE("GraphCore::commitChanges");
+
+    // reading the result of a notified port pulls it, so the graph has to be consistent by now
+    const QVector<int> invalidatedNodes = m_invalidatedNodes;
+    m_invalidatedNodes.clear();
+    for (int nodeId : invalidatedNodes) {
+        if (!m_store.isNode(nodeId))
+            continue;
+        for (int portId = m_store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = m_store.nextPort(portId)) {
+            if (QObject *port = m_portObjects.value(portId)) {
+                GRAPHVIEW_PROFILE_COUNT("GraphNodePort::resultChanged", 1);
+                emit static_cast<GraphNodePort *>(port)->resultChanged();
+            }
+        }
+    }
+
+    if (m_pendingChanges.isEmpty())
+        return;
+
+    GraphChangeSet changes = m_pendingChanges;
+    m_pendingChanges = GraphChangeSet();
+    // shared with the store until either changes, so this does not copy the names
+    changes.setNames(m_store.names());
+    GRAPHVIEW_PROFILE_COUNT("GraphCore::changesCommitted", 1);
+    emit changesCommitted(changes);
+    if (changes.isStructural()) {
+        GRAPHVIEW_PROFILE_COUNT("GraphCore::graphChanged", 1);
+        emit graphChanged();
+    }
+}
+
+/**
+ * @brief GraphCore::removeConnection removes a connection without committing the change
+ * @param connectionId connection handle
+ */
+void GraphCore::removeConnection(int connectionId)
+{
+    const int outPortId = m_store.connectionOutput(connectionId);
+    const int inPortId = m_store.connectionInput(connectionId);
+    m_connectionModel->remove(connectionId);
+    m_journal.connectionRemoved(m_store.nodeName(m_store.portNode(outPortId)), m_store.portName(outPortId),
+                                m_store.nodeName(m_store.portNode(inPortId)), m_store.portName(inPortId));
+    invalidateResults(m_store.portNode(inPortId));
+
+    m_pendingChanges.connectionRemoved(changeKey(outPortId, inPortId));
+    emit connectionRemoved(connectionId);
+    releaseObject(m_connectionObjects, m_connectionObjectPool, connectionId);
+    m_connectionIndex.remove(connectionId);
+    m_store.removeConnection(connectionId);
+    for (int portId : { outPortId, inPortId }) {
+        if (m_store.portDegree(portId) == 0)
+            notifyPortConnected(portId);
+    }
+}
+
+/**
+ * @brief GraphCore::updateConnectionBounds refits the boxes of the connections of a node after its ports moved
+ * @param nodeId node handle
+ */
+void GraphCore::updateConnectionBounds(int nodeId)
+{
+    for (int portId = m_store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = m_store.nextPort(portId)) {
+        for (int connectionId = m_store.firstConnection(portId); connectionId != GraphStore::InvalidId;
+             connectionId = m_store.nextConnection(connectionId, portId))
+            m_connectionIndex.update(connectionId, m_store.connectionRect(connectionId));
+    }
+}
+
+/**
+ * @brief GraphCore::removePortConnections removes all connections of a port, O(degree)
+ * @param portId port handle
+ */
+void GraphCore::removePortConnections(int portId)
+{
+    while (m_store.firstConnection(portId) != GraphStore::InvalidId)
+        removeConnection(m_store.firstConnection(portId));
+}
+
+/**
+ * @brief GraphCore::notifyPortConnected tells the facade of a port, if any, that its connection state changed
+ * @param portId port handle
+ */
+void GraphCore::notifyPortConnected(int portId)
+{
+    if (QObject *port = m_portObjects.value(portId))
+        emit static_cast<GraphNodePort *>(port)->isConnectedChanged();
+}
+
+/**
+ * @brief GraphCore::invalidateResults marks a node and everything downstream of it dirty
+ * Removals call it before the store forgets the connections leading downstream.
+ * The port facades of the dirtied nodes are notified when the change is committed
+ * @param nodeId node handle
+ */
+void GraphCore::invalidateResults(int nodeId)
+{
+    m_evaluator.markDirty(nodeId, &m_invalidatedNodes);
+}
+
+/**
+ * @brief GraphCore::releaseObject detaches the facade of a removed element and keeps it for reuse
+ * @param objects facades of one kind of elements
+ * @param pool detached facades of the same kind
+ * @param id element handle
+ */
+void GraphCore::releaseObject(QVector<QObject *> &objects, QVector<QObject *> &pool, int id)
+{
+    if (id >= objects.size() || !objects.at(id))
+        return;
+
+    GraphGenericObject *object = static_cast<GraphGenericObject *>(objects.at(id));
+    object->detach();
+    pool.append(object);
+    objects[id] = nullptr;
+}
+
+/**
+ * @brief GraphCore::connectionName builds the unique name of a connection from its ends
+ */
+QString GraphCore::connectionName(const QString &src, const QString &out, const QString &dest, const QString &in)
+{
+    return QString(QLatin1String("%1.%2->%3.%4")).arg(src, out, dest, in);
+}
+
+/**
+ * @brief GraphCore::connectionName builds the name of a connection between two ports
+ * @param outPortId output port handle
+ * @param inPortId input port handle
+ */
+QString GraphCore::connectionName(int outPortId, int inPortId) const
+{
+    return connectionName(m_store.nodeName(m_store.portNode(outPortId)), m_store.portName(outPortId),
+                          m_store.nodeName(m_store.portNode(inPortId)), m_store.portName(inPortId));
+}
+
+/**
+ * @brief GraphCore::changeKey returns the key GraphChangeSet records a connection by
+ * @param outPortId output port handle
+ * @param inPortId input port handle
+ */
+GraphChangeSet::ConnectionKey GraphCore::changeKey(int outPortId, int inPortId) const
+{
+    return GraphChangeSet::connectionKey(m_store.nodeNameId(m_store.portNode(outPortId)), m_store.portNameId(outPortId),
+                                         m_store.nodeNameId(m_store.portNode(inPortId)), m_store.portNameId(inPortId));
+}
+
+GraphCore::JsonKeyID GraphCore::getId(const QString &key)
+{
+    // initialised once in one statement, so readers on worker threads can share it
+    static const QHash<QString, GraphCore::JsonKeyID> aliases = []() -> QHash<QString, GraphCore::JsonKeyID> {
+        QHash<QString, GraphCore::JsonKeyID> ids;
+        for (int i = 0; i < JsonKeyID::END_ID; ++i) {
+            const JsonKeyID id = static_cast<JsonKeyID>(i);
+            ids.insert(getKey(id), id);
+        }
+        return ids;
+    }();
+    return aliases.value(key, JsonKeyID::Undefined);
+}
+
+QString GraphCore::getKey(GraphCore::JsonKeyID id)
+{
+    // called by loads and saves on worker threads, the table is initialised thread-safely
+    static const QVector<QString> aliases = {
+        QStringLiteral("name"), QStringLiteral("zoom_factor"),
+        QStringLiteral("nodes"), QStringLiteral("connections"),
+        QStringLiteral("ports"), QStringLiteral("type"),
+        QStringLiteral("x"), QStringLiteral("y"), QStringLiteral("value"),
+        QStringLiteral("source"), QStringLiteral("target"),
+        QStringLiteral("output"), QStringLiteral("input")
+    };
     return aliases.value(id);
 }
@@ -1,8 +1,27 @@
 #pragma once
 
-#include <QObject>
+#include "graphboundstree.h"
+#include "graphchangeset.h"
+#include "graphdata.h"
+#include "graphevaluator.h"
+#include "graphhandlemodel.h"
+#include "graphjournal.h"
+#include "graphjsonreader.h"
+#include "graphlayout.h"
+#include "graphquadtree.h"
+#include "graphstore.h"
+#include "graphviewportmodel.h"
 
+#include <QAtomicInt>
+#include <QFutureWatcher>
 #include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
 
 class GraphNode;
 class GraphConnection;
@@ -14,53 +33,225 @@ class GraphCore : public QObject
     Q_PROPERTY(QString sourceFileName READ sourceFileName NOTIFY sourceFileNameChanged)
     Q_PROPERTY(QObjectList graphNodes READ graphNodes NOTIFY graphChanged)
     Q_PROPERTY(QObjectList graphConnections READ graphConnections NOTIFY graphChanged)
+    Q_PROPERTY(GraphHandleModel *nodeModel READ nodeModel CONSTANT)
+    Q_PROPERTY(GraphHandleModel *connectionModel READ connectionModel CONSTANT)
+    Q_PROPERTY(GraphViewportModel *visibleNodeModel READ visibleNodeModel CONSTANT)
     Q_PROPERTY(double zoomFactor READ zoomFactor WRITE setZoomFactor)
+    Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged)
+    Q_PROPERTY(bool saving READ isSaving NOTIFY savingChanged)
+    Q_PROPERTY(bool layouting READ isLayouting NOTIFY layoutingChanged)
+    Q_PROPERTY(QVariantMap profile READ profile)
+    Q_PROPERTY(int autosaveInterval READ autosaveInterval WRITE setAutosaveInterval NOTIFY autosaveIntervalChanged)
 
+public:
     enum JsonKeyID {
         Undefined = -1,
         Name = 0, ZoomFactor, Nodes, Connections, Ports, Type,
         XCoord, YCoord, Value, Source, Target, Output, Input, END_ID
     };
-public:
+
+    enum LayoutAlgorithm {
+        LayeredLayout = GraphLayout::LayeredLayout,
+        ForceDirectedLayout = GraphLayout::ForceDirectedLayout
+    };
+    Q_ENUM(LayoutAlgorithm)
+
     explicit GraphCore(QObject *parent = nullptr);
+    ~GraphCore() override;
 
     inline QString sourceFileName() const { return m_sourceFileName; }
-    inline QObjectList graphNodes() const { return m_graphNodes.values(); }
-    inline QObjectList graphConnections() const { return m_graphConnections.values(); }
+    inline const GraphStore &store() const { return m_store; }
+    QObjectList graphNodes() const;
+    QObjectList graphConnections() const;
+    QVector<int> nodeIds() const;
+    QVector<int> connectionIds() const;
+    inline GraphHandleModel *nodeModel() const { return m_nodeModel; }
+    inline GraphHandleModel *connectionModel() const { return m_connectionModel; }
+    inline GraphViewportModel *visibleNodeModel() const { return m_visibleNodeModel; }
     inline double zoomFactor() const { return m_zoomFactor; }
+    inline bool isUpdating() const { return m_updateDepth > 0; }
+    inline bool isLoading() const { return !m_loadWatcher.isNull(); }
+    inline bool isSaving() const { return !m_saveWatcher.isNull(); }
+    inline bool isLayouting() const { return !m_layoutWatcher.isNull(); }
+    inline int autosaveInterval() const { return m_autosaveTimer.interval(); }
+    inline bool isJournaling() const { return m_journal.isOpen(); }
+    inline const GraphEvaluator &evaluator() const { return m_evaluator; }
+    inline bool isNodeDirty(int nodeId) const { return m_evaluator.isNodeDirty(nodeId); }
+    inline bool isPortDirty(int portId) const { return m_store.isPort(portId) && m_evaluator.isPortDirty(portId); }
+    QVariant portResult(int portId);
+    QVariantMap profile() const;
 
-    GraphNode *findNode(const QString &name) const;
+    Q_INVOKABLE GraphNode *findNode(const QString &name) const;
+    int findConnection(const QString &name) const;
+    GraphNode *nodeObject(int nodeId) const;
+    GraphNodePort *portObject(int portId) const;
+    GraphConnection *connectionObject(int connectionId) const;
+
+    Q_INVOKABLE QObjectList nodesInRect(const QRectF &rect) const;
+    QVector<int> nodeIdsInRect(const QRectF &rect) const;
+    Q_INVOKABLE QObjectList connectionsInRect(const QRectF &rect) const;
+    QVector<int> connectionIdsInRect(const QRectF &rect) const;
+    Q_INVOKABLE QObject *connectionAt(const QPointF &point, qreal tolerance) const;
+    int connectionIdAt(const QPointF &point, qreal tolerance) const;
     bool hasConnection(const GraphNodePort *graphNodePort) const;
+    int connectionCount(const GraphNodePort *graphNodePort) const;
+    int nodeDegree(const GraphNode *graphNode) const;
+    QObjectList portConnections(const GraphNodePort *graphNodePort) const;
+    QObjectList nodeConnections(const GraphNode *graphNode) const;
+
+    int addPort(int nodeId, GraphStore::PortType portType, const QString &name, const QVariant &value);
+    bool removePort(int nodeId, GraphStore::PortType portType, const QString &name);
+    void setNodeCoord(int nodeId, const QPointF &coord);
+    void setPortValue(int portId, const QVariant &value);
+    bool addGraphConnection(int outPortId, int inPortId);
+    bool removeGraphConnection(int connectionId);
+
+    GraphData graphData() const;
+    static GraphData graphData(const GraphStore &store, double zoomFactor);
+    void setGraphData(const GraphData &data);
+    static bool readGraphData(const QString &fileName, GraphData *data, QString *errorString);
+    static bool writeGraphData(const QString &fileName, const GraphData &data, QString *errorString);
+
+    static QString connectionName(const QString &src, const QString &out, const QString &dest, const QString &in);
+    QString connectionName(int outPortId, int inPortId) const;
+
+    static JsonKeyID getId(const QString &key);
+    static QString getKey(JsonKeyID id);
 
 public slots:
     void save();
     void saveAs(const QString &fileName);
     void load(const QString &fileName);
+    void loadAsync(const QString &fileName);
+    void cancelLoad();
+    void autosave();
+    bool evaluate();
+    void layout(LayoutAlgorithm algorithm);
+    void layoutAsync(LayoutAlgorithm algorithm);
+    void cancelLayout();
+    bool writeTrace(const QString &fileName);
+    void resetProfile();
+    void setAutosaveInterval(int autosaveInterval);
+
+    void beginUpdate();
+    void endUpdate();
 
     bool addGraphNode(const QString &name, qreal x, qreal y);
     bool removeGraphNode(const QString &name);
+    bool removeGraphNodes(const QStringList &names);
 
     bool addGraphConnection(const QString &src, const QString &out, const QString &dest, const QString &in);
     bool removeGraphConnection(const QString &name);
 
     void setZoomFactor(double zoomFactor);
 
+    bool moveNodeTo(const QString &name, qreal x, qreal y);
+    bool moveNodesBy(const QStringList &names, qreal dx, qreal dy);
+    void flushMoves();
+
 signals:
     void sourceFileNameChanged(const QString &sourceFileName);
     void zoomFactorChanged(double zoomFactor);
     void graphChanged();
+    void savingChanged(bool saving);
+    void saved(const QString &fileName);
+    void loadingChanged(bool loading);
+    void loadProgress(qint64 bytesRead, qint64 bytesTotal);
+    void loadCancelled(const QString &fileName);
+    void layoutingChanged(bool layouting);
+    void layoutProgress(int step, int stepCount);
+    void autosaveIntervalChanged(int autosaveInterval);
+    void journalReplayed(const QString &fileName, int changeCount);
+    void evaluated();
+    void changesCommitted(const GraphChangeSet &changes);
+    // element signals carry store handles, removals are reported while the element still exists
+    void nodeAdded(int nodeId);
+    void nodeRemoved(int nodeId);
+    void nodeMoved(int nodeId);
+    void portAdded(int portId);
+    void portRemoved(int portId);
+    void connectionAdded(int connectionId);
+    void connectionRemoved(int connectionId);
     void errorOccurred(const QString &error);
 
 protected:
     bool saveTo(const QString &fileName);
     bool loadFrom(const QString &fileName);
 
-    static JsonKeyID getId(const QString &key);
-    static QString getKey(JsonKeyID id);
-
 private:
+    struct LoadResult
+    {
+        GraphData data;
+        QString errorString;
+        bool ok = false;
+        bool cancelled = false;
+    };
+
+    struct SaveResult
+    {
+        QString fileName;
+        QString errorString;
+        bool ok = false;
+    };
+
+    static SaveResult writeGraphFile(const QString &fileName, const GraphData &data);
+    void saveAsync(const QString &fileName);
+
+    static LoadResult readGraphFile(const QString &fileName, const QAtomicInt *cancelFlag,
+                                    const GraphJsonReader::ProgressHandler &progressHandler);
+    bool applyLoadResult(const QString &fileName, const LoadResult &result);
+
+    void startJournal(const QString &fileName, qint64 validSize);
+    void stopJournal();
+    void replayJournal(const QString &fileName);
+    bool applyJournalRecord(const GraphJournal::Record &record);
+
+    void applyLayout(const GraphLayout::Input &input, const QVector<QPointF> &coords, bool journaled);
+    void moveNode(int nodeId, const QPointF &coord, bool journaled);
+    void queueMove(int nodeId, const QPointF &coord);
+    void removeConnection(int connectionId);
+    void updateConnectionBounds(int nodeId);
+    void removePortConnections(int portId);
+    GraphChangeSet::ConnectionKey changeKey(int outPortId, int inPortId) const;
+    void notifyPortConnected(int portId);
+    void invalidateResults(int nodeId);
+    void releaseObject(QVector<QObject *> &objects, QVector<QObject *> &pool, int id);
+    void clearGraph();
+    void commitChanges();
+
     QString m_sourceFileName;
     double m_zoomFactor = 1.0;
-    QHash<QString, QObject *> m_graphNodes;
-    QHash<QString, QObject *> m_graphConnections;    
+    GraphStore m_store;
+    // facades indexed by handle, created on demand
+    mutable QVector<QObject *> m_nodeObjects;
+    mutable QVector<QObject *> m_portObjects;
+    mutable QVector<QObject *> m_connectionObjects;
+    // detached facades, bound again to new elements instead of allocating new ones
+    mutable QVector<QObject *> m_nodeObjectPool;
+    mutable QVector<QObject *> m_portObjectPool;
+    mutable QVector<QObject *> m_connectionObjectPool;
+    GraphHandleModel *m_nodeModel;
+    GraphHandleModel *m_connectionModel;
+    GraphViewportModel *m_visibleNodeModel;
+    GraphQuadTree m_spatialIndex;
+    // bounding boxes of the connection curves, for picking and culling
+    GraphBoundsTree m_connectionIndex;
+    GraphEvaluator m_evaluator;
+    // nodes whose results became dirty since the last commit, their port facades are notified on commit
+    QVector<int> m_invalidatedNodes;
+    int m_updateDepth = 0;
+    GraphChangeSet m_pendingChanges;
+    QSharedPointer<QAtomicInt> m_loadCancelFlag;
+    QPointer<QFutureWatcher<LoadResult>> m_loadWatcher;
+    QPointer<QFutureWatcher<SaveResult>> m_saveWatcher;
+    QStringList m_pendingSaves;
+    QSharedPointer<QAtomicInt> m_layoutCancelFlag;
+    QPointer<QFutureWatcher<QVector<QPointF>>> m_layoutWatcher;
+    GraphJournal m_journal;
+    // end of the journal part covered by the save in progress
+    qint64 m_journalSaveMark = -1;
+    QTimer m_autosaveTimer;
+    // positions requested by moveNodeTo() and moveNodesBy(), applied once per frame
+    QHash<int, QPointF> m_pendingMoves;
+    QTimer m_moveTimer;
 };
@@ -0,0 +1,55 @@
+# Core graph model shared by the application and the benchmark
+
+QT += concurrent
+
+# CONFIG+=profiling compiles in the GRAPHVIEW_PROFILE_* instrumentation, see graphprofiler.h
+profiling: DEFINES += GRAPHVIEW_PROFILING
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+        $$PWD/graphbinaryformat.cpp \
+        $$PWD/graphboundstree.cpp \
+        $$PWD/graphchangeset.cpp \
+        $$PWD/graphconnection.cpp \
+        $$PWD/graphcore.cpp \
+        $$PWD/graphevaluator.cpp \
+        $$PWD/graphexpression.cpp \
+        $$PWD/graphgenericobject.cpp \
+        $$PWD/graphhandlemodel.cpp \
+        $$PWD/graphjournal.cpp \
+        $$PWD/graphjsonreader.cpp \
+        $$PWD/graphlayout.cpp \
+        $$PWD/graphnametable.cpp \
+        $$PWD/graphnode.cpp \
+        $$PWD/graphnodeport.cpp \
+        $$PWD/graphobjectmodel.cpp \
+        $$PWD/graphportmodel.cpp \
+        $$PWD/graphprofiler.cpp \
+        $$PWD/graphquadtree.cpp \
+        $$PWD/graphstore.cpp \
+        $$PWD/graphviewportmodel.cpp
+
+HEADERS += \
+    $$PWD/graphbinaryformat.h \
+    $$PWD/graphboundstree.h \
+    $$PWD/graphchangeset.h \
+    $$PWD/graphconnection.h \
+    $$PWD/graphdata.h \
+    $$PWD/graphcore.h \
+    $$PWD/graphevaluator.h \
+    $$PWD/graphexpression.h \
+    $$PWD/graphgenericobject.h \
+    $$PWD/graphhandlemodel.h \
+    $$PWD/graphjournal.h \
+    $$PWD/graphjsonreader.h \
+    $$PWD/graphlayout.h \
+    $$PWD/graphnametable.h \
+    $$PWD/graphnode.h \
+    $$PWD/graphnodeport.h \
+    $$PWD/graphobjectmodel.h \
+    $$PWD/graphportmodel.h \
+    $$PWD/graphprofiler.h \
+    $$PWD/graphquadtree.h \
+    $$PWD/graphstore.h \
+    $$PWD/graphviewportmodel.h
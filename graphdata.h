@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QPointF>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+/**
+ * Plain value representation of a graph, independent from the QObject tree.
+ * Used to move a whole graph between GraphCore and the file formats.
+ */
+
+struct GraphPortData
+{
+    QString name;
+    int portType = 0;
+    QVariant value;
+};
+
+struct GraphNodeData
+{
+    QString name;
+    QPointF coord;
+    QVector<GraphPortData> ports;
+};
+
+struct GraphConnectionData
+{
+    QString sourceNode;
+    QString outputPort;
+    QString targetNode;
+    QString inputPort;
+};
+
+struct GraphData
+{
+    double zoomFactor = 1.0;
+    QVector<GraphNodeData> nodes;
+    QVector<GraphConnectionData> connections;
+};
+
+Q_DECLARE_TYPEINFO(GraphPortData, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(GraphNodeData, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(GraphConnectionData, Q_MOVABLE_TYPE);
@@ -0,0 +1,715 @@
+#include "graphevaluator.h"
+
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QVarLengthArray>
+
+/**
+ * @brief The GraphEvaluator class propagates port values along the connections of a graph
+ *
+ * A node is evaluated once every node feeding it has been evaluated: a connected input
+ * port takes the result of the output port it is connected to, an unconnected one its own
+ * value. Output ports holding an expression string compute it from the input ports of the
+ * node, other output values pass through unchanged.
+ *
+ * Expression strings are compiled once and cached by text, every port keeps a kernel with
+ * the names of its expression bound to input ports. A kernel is rebuilt only when the
+ * string of its port changes, and rebound when the ports of the node change.
+ *
+ * Results are kept between evaluations. A node is dirty until it has been evaluated and
+ * becomes dirty again when markDirty() is called for it or for a node upstream, which
+ * marks the whole downstream cone and stops at nodes that are dirty already, so a node
+ * is never clean while something upstream of it is dirty. evaluate() recomputes the dirty
+ * nodes only, pull() only the dirty nodes a node depends on, so the work of an edit is
+ * proportional to the part of the graph it affects.
+ *
+ * Nodes are ordered with Kahn's algorithm over the connection tables of the store. Nodes
+ * on a cycle, and everything downstream of one, are reported and left out. Independent
+ * nodes run concurrently on a thread pool: a finished node hands the first successor it
+ * made ready to its own thread and queues the others, so chains stay on one thread while
+ * branches spread over the pool. Wide graphs are evaluated level by level instead, the
+ * expression outputs of a level that share their code are run as column batches.
+ *
+ * The store must not change while an evaluation runs, changes made between evaluations
+ * must be reported by markDirty() and forgetNode(). Nodes the evaluator has never seen
+ * are dirty, so a fresh evaluator evaluates the whole graph.
+ */
+
+class GraphEvaluatorTask : public QRunnable
+{
+public:
+    GraphEvaluatorTask(GraphEvaluator *evaluator, int nodeId)
+        : m_evaluator(evaluator), m_nodeId(nodeId)
+    {
+    }
+
+    void run() override
+    {
+        m_evaluator->runChain(m_nodeId);
+    }
+
+private:
+    GraphEvaluator *m_evaluator;
+    int m_nodeId;
+};
+
+class GraphEvaluatorRangeTask : public QRunnable
+{
+public:
+    GraphEvaluatorRangeTask(const std::function<void(int, int)> &function, int begin, int end, QSemaphore *finished)
+        : m_function(function), m_begin(begin), m_end(end), m_finished(finished)
+    {
+    }
+
+    void run() override
+    {
+        m_function(m_begin, m_end);
+        m_finished->release();
+    }
+
+private:
+    const std::function<void(int, int)> &m_function;
+    int m_begin;
+    int m_end;
+    QSemaphore *m_finished;
+};
+
+/**
+ * @brief GraphEvaluator::GraphEvaluator ctor
+ * @param store graph to evaluate, the evaluator keeps a reference
+ */
+GraphEvaluator::GraphEvaluator(const GraphStore &store)
+    : m_store(store)
+    , m_threadPool(QThreadPool::globalInstance())
+{
+}
+
+/**
+ * @brief GraphEvaluator::evaluate recomputes all dirty nodes
+ * @param errorString receives the cycles and the expressions that could not be evaluated
+ * @return false if some nodes or ports could not be evaluated, the others still have their results
+ */
+bool GraphEvaluator::evaluate(QString *errorString)
+{
+    growDirtyFlags();
+    beginMarking();
+    QVector<int> nodes;
+    nodes.reserve(m_dirtyNodeCount);
+    for (int nodeId : qAsConst(m_dirtyNodes)) {
+        if (m_store.isNode(nodeId) && m_nodeDirty.at(nodeId) && !isMarked(nodeId)) {
+            mark(nodeId);
+            nodes.append(nodeId);
+        }
+    }
+    m_dirtyNodes.clear();
+    return run(nodes, errorString);
+}
+
+/**
+ * @brief GraphEvaluator::pull recomputes a node and the dirty nodes upstream of it
+ * @param nodeId node handle
+ * @param errorString receives the cycles and the expressions that could not be evaluated
+ * @return false if some nodes or ports could not be evaluated
+ */
+bool GraphEvaluator::pull(int nodeId, QString *errorString)
+{
+    growDirtyFlags();
+    if (!m_store.isNode(nodeId) || !m_nodeDirty.at(nodeId))
+        return true;
+
+    // clean nodes have clean upstream nodes, the walk stops at them
+    beginMarking();
+    QVector<int> nodes;
+    nodes.append(nodeId);
+    mark(nodeId);
+    for (int i = 0; i < nodes.size(); ++i) {
+        const int current = nodes.at(i);
+        for (int portId = m_store.firstPort(current); portId != GraphStore::InvalidId; portId = m_store.nextPort(portId)) {
+            if (m_store.portType(portId) != GraphStore::InputPort)
+                continue;
+            for (int connectionId = m_store.firstConnection(portId); connectionId != GraphStore::InvalidId;
+                 connectionId = m_store.nextConnection(connectionId, portId)) {
+                const int upstream = m_store.portNode(m_store.connectionOutput(connectionId));
+                if (m_nodeDirty.at(upstream) && !isMarked(upstream)) {
+                    mark(upstream);
+                    nodes.append(upstream);
+                }
+            }
+        }
+    }
+    return run(nodes, errorString);
+}
+
+/**
+ * @brief GraphEvaluator::clear drops all results, kernels and dirty flags, e.g. when the graph is replaced
+ */
+void GraphEvaluator::clear()
+{
+    m_results.clear();
+    m_nodeDirty.clear();
+    m_dirtyNodes.clear();
+    m_dirtyNodeCount = 0;
+    m_nodeMarks.clear();
+    m_markEpoch = 0;
+    m_expressions.clear();
+    m_kernelIndices.clear();
+    m_kernels.clear();
+    m_freeKernels.clear();
+    m_order.clear();
+    m_levelOffsets.clear();
+    m_cycleNodes.clear();
+}
+
+/**
+ * @brief GraphEvaluator::markDirty marks a node and every node downstream of it dirty
+ * Called after the value or the ports of a node changed and for the input node of a
+ * connection being added or removed. Removals must be reported before the store
+ * forgets the connections that lead downstream
+ * @param nodeId node handle
+ * @param dirtiedNodes receives the nodes that were clean before, may be null
+ */
+void GraphEvaluator::markDirty(int nodeId, QVector<int> *dirtiedNodes)
+{
+    growDirtyFlags();
+    if (m_nodeDirty.at(nodeId))
+        return;
+
+    QVector<int> stack;
+    stack.append(nodeId);
+    setDirty(nodeId, true);
+    while (!stack.isEmpty()) {
+        const int current = stack.takeLast();
+        m_dirtyNodes.append(current);
+        ++m_dirtiedNodeCount;
+        if (dirtiedNodes)
+            dirtiedNodes->append(current);
+        for (int portId = m_store.firstPort(current); portId != GraphStore::InvalidId; portId = m_store.nextPort(portId)) {
+            if (m_store.portType(portId) != GraphStore::OutputPort)
+                continue;
+            for (int connectionId = m_store.firstConnection(portId); connectionId != GraphStore::InvalidId;
+                 connectionId = m_store.nextConnection(connectionId, portId)) {
+                const int downstream = m_store.portNode(m_store.connectionInput(connectionId));
+                if (!m_nodeDirty.at(downstream)) {
+                    setDirty(downstream, true);
+                    stack.append(downstream);
+                }
+            }
+        }
+    }
+
+    // nodes cleaned by pull() stay listed until the next evaluate(), drop them before the list outgrows the graph
+    if (m_dirtyNodes.size() > 2 * m_store.nodeCapacity() + 64) {
+        beginMarking();
+        QVector<int> dirtyNodes;
+        for (int id : qAsConst(m_dirtyNodes)) {
+            if (m_nodeDirty.at(id) && !isMarked(id)) {
+                mark(id);
+                dirtyNodes.append(id);
+            }
+        }
+        m_dirtyNodes.swap(dirtyNodes);
+    }
+}
+
+/**
+ * @brief GraphEvaluator::forgetNode drops the dirty flag of a removed node
+ * The nodes downstream must have been marked by markDirty() before the removal
+ * @param nodeId handle of the removed node
+ */
+void GraphEvaluator::forgetNode(int nodeId)
+{
+    if (nodeId < m_nodeDirty.size() && m_nodeDirty.at(nodeId))
+        setDirty(nodeId, false);
+}
+
+/**
+ * @brief GraphEvaluator::invalidate marks every node dirty so that the next evaluation recomputes the whole graph
+ */
+void GraphEvaluator::invalidate()
+{
+    growDirtyFlags();
+    for (int nodeId = 0; nodeId < m_store.nodeCapacity(); ++nodeId) {
+        if (m_store.isNode(nodeId) && !m_nodeDirty.at(nodeId)) {
+            setDirty(nodeId, true);
+            m_dirtyNodes.append(nodeId);
+            ++m_dirtiedNodeCount;
+        }
+    }
+}
+
+/**
+ * @brief GraphEvaluator::growDirtyFlags covers nodes added to the store since the flags were last grown
+ * Such nodes have never been evaluated, so they start out dirty
+ */
+void GraphEvaluator::growDirtyFlags()
+{
+    const int known = m_nodeDirty.size();
+    if (known >= m_store.nodeCapacity())
+        return;
+
+    m_nodeDirty.resize(m_store.nodeCapacity());
+    for (int nodeId = known; nodeId < m_store.nodeCapacity(); ++nodeId) {
+        if (m_store.isNode(nodeId)) {
+            setDirty(nodeId, true);
+            m_dirtyNodes.append(nodeId);
+            ++m_dirtiedNodeCount;
+        }
+    }
+}
+
+void GraphEvaluator::setDirty(int nodeId, bool dirty)
+{
+    if (m_nodeDirty.at(nodeId) == dirty)
+        return;
+    m_nodeDirty[nodeId] = dirty;
+    m_dirtyNodeCount += dirty ? 1 : -1;
+}
+
+/**
+ * @brief GraphEvaluator::beginMarking drops all node marks
+ */
+void GraphEvaluator::beginMarking()
+{
+    if (m_nodeMarks.size() < m_store.nodeCapacity())
+        m_nodeMarks.resize(m_store.nodeCapacity());
+    if (++m_markEpoch == 0) {
+        m_nodeMarks.fill(0);
+        m_markEpoch = 1;
+    }
+}
+
+/**
+ * @brief GraphEvaluator::run evaluates a set of nodes and cleans them
+ * @param nodes the marked nodes, every dirty node upstream of them is among them
+ * @param errorString receives the cycles and the expressions that could not be evaluated
+ * @return false if some nodes or ports could not be evaluated
+ */
+bool GraphEvaluator::run(const QVector<int> &nodes, QString *errorString)
+{
+    m_errors.clear();
+    if (m_results.size() < m_store.portCapacity())
+        m_results.resize(m_store.portCapacity());
+    prepareKernels(nodes);
+    buildSchedule(nodes);
+
+    m_resultSlots = m_results.data();
+    m_pendingSlots = m_pendingInputs.data();
+    if (m_batchWidth > 0 && m_order.size() >= qMax(1, levelCount()) * m_batchWidth) {
+        evaluateLevels();
+    } else if (m_order.size() < ParallelThreshold || !m_threadPool || m_threadPool->maxThreadCount() < 2) {
+        for (int nodeId : qAsConst(m_order))
+            evaluateNode(nodeId);
+    } else {
+        // the sources make up the first level, running tasks bring other nodes down to 0 as well
+        for (int i = 0; i < m_levelOffsets.at(1); ++i)
+            m_threadPool->start(new GraphEvaluatorTask(this, m_order.at(i)));
+        m_finishedNodes.acquire(m_order.size());
+    }
+    m_resultSlots = nullptr;
+    m_pendingSlots = nullptr;
+
+    for (int nodeId : qAsConst(m_order))
+        setDirty(nodeId, false);
+    m_recomputedNodeCount += m_order.size();
+    // nodes on a cycle are left without results until an edit marks them again
+    for (int nodeId : qAsConst(m_cycleNodes)) {
+        for (int portId = m_store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = m_store.nextPort(portId))
+            m_results[portId] = QVariant();
+        setDirty(nodeId, false);
+    }
+
+    if (!m_cycleNodes.isEmpty()) {
+        QStringList names;
+        for (int i = 0; i < qMin(m_cycleNodes.size(), 5); ++i)
+            names.append(m_store.nodeName(m_cycleNodes.at(i)));
+        m_errors.prepend(tr("%1 nodes are on or behind a cycle and were not evaluated: %2")
+                         .arg(m_cycleNodes.size()).arg(names.join(QLatin1String(", "))));
+    }
+    if (m_errors.isEmpty())
+        return true;
+
+    *errorString = m_errors.mid(0, 5).join(QLatin1Char('\n'));
+    if (m_errors.size() > 5)
+        *errorString += QLatin1Char('\n') + tr("%1 more errors").arg(m_errors.size() - 5);
+    return false;
+}
+
+/**
+ * @brief GraphEvaluator::prepareKernels brings the kernels of the ports of some nodes up to date
+ * Runs before the evaluation starts so that the worker threads only read the kernels
+ * @param nodes nodes about to be evaluated
+ */
+void GraphEvaluator::prepareKernels(const QVector<int> &nodes)
+{
+    if (m_expressions.size() > ExpressionCacheSize)
+        m_expressions.clear();
+
+    m_kernelIndices.reserve(m_store.portCapacity());
+    while (m_kernelIndices.size() < m_store.portCapacity())
+        m_kernelIndices.append(-1);
+
+    for (int nodeId : nodes) {
+        for (int portId = m_store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = m_store.nextPort(portId))
+            prepareKernel(portId);
+    }
+}
+
+/**
+ * @brief GraphEvaluator::prepareKernel compiles and binds the kernel of a port if the port holds a string
+ * @param portId port handle
+ */
+void GraphEvaluator::prepareKernel(int portId)
+{
+    int &index = m_kernelIndices[portId];
+    if (m_store.portValue(portId).type() != QVariant::String) {
+        if (index >= 0) {
+            m_kernels[index] = Kernel();
+            m_freeKernels.append(index);
+            index = -1;
+        }
+        return;
+    }
+
+    if (index < 0) {
+        if (m_freeKernels.isEmpty()) {
+            index = m_kernels.size();
+            m_kernels.append(Kernel());
+        } else {
+            index = m_freeKernels.takeLast();
+        }
+    }
+    Kernel &kernel = m_kernels[index];
+    // usually shares its data with the cached text, which makes the comparison a pointer check
+    const QString text = m_store.portValue(portId).toString();
+    if (!kernel.compiled || kernel.text != text) {
+        const CompiledExpression &compiled = compile(text);
+        kernel.compiled = true;
+        kernel.text = text;
+        kernel.expression = compiled.expression;
+        kernel.errorString = compiled.errorString;
+        kernel.nodeId = GraphStore::InvalidId;
+    }
+    const int nodeId = m_store.portNode(portId);
+    if (kernel.nodeId != nodeId || kernel.nodeRevision != m_store.nodeRevision(nodeId))
+        bindKernel(&kernel, portId);
+}
+
+/**
+ * @brief GraphEvaluator::compile compiles an expression text, or takes it from the cache
+ * @param text expression
+ * @return the code, or a null expression and the error
+ */
+const GraphEvaluator::CompiledExpression &GraphEvaluator::compile(const QString &text)
+{
+    QHash<QString, CompiledExpression>::iterator it = m_expressions.find(text);
+    if (it != m_expressions.end())
+        return it.value();
+
+    CompiledExpression compiled;
+    QSharedPointer<GraphExpression> expression = QSharedPointer<GraphExpression>::create();
+    if (expression->compile(text, &compiled.errorString))
+        compiled.expression = expression;
+    ++m_compileCount;
+    return m_expressions.insert(text, compiled).value();
+}
+
+/**
+ * @brief GraphEvaluator::bindKernel resolves the names of a kernel to slots
+ * The names of output port expressions are the input ports of the node, input port
+ * expressions have no names to refer to
+ * @param kernel kernel of the port
+ * @param portId port handle
+ */
+void GraphEvaluator::bindKernel(Kernel *kernel, int portId)
+{
+    const int nodeId = m_store.portNode(portId);
+    kernel->nodeId = nodeId;
+    kernel->nodeRevision = m_store.nodeRevision(nodeId);
+    kernel->slotPorts.clear();
+    if (!kernel->expression)
+        return;
+
+    const QStringList &names = kernel->expression->names();
+    kernel->slotPorts.reserve(names.size());
+    for (const QString &name : names) {
+        kernel->slotPorts.append(m_store.portType(portId) == GraphStore::OutputPort
+                                 ? m_store.findPort(nodeId, GraphStore::InputPort, name)
+                                 : int(GraphStore::InvalidId));
+    }
+}
+
+/**
+ * @brief GraphEvaluator::buildSchedule orders a set of nodes topologically with Kahn's algorithm
+ * Fills the successor rows, the number of pending inputs of every node, the order of
+ * the evaluable nodes grouped by level and the nodes left over by cycles. Only connections
+ * between nodes of the set count. The level of a node is the length of the longest path
+ * leading to it, nodes of one level are independent
+ * @param nodes the marked nodes
+ */
+void GraphEvaluator::buildSchedule(const QVector<int> &nodes)
+{
+    const int count = nodes.size();
+    if (m_scheduleIndices.size() < m_store.nodeCapacity())
+        m_scheduleIndices.resize(m_store.nodeCapacity());
+    for (int i = 0; i < count; ++i)
+        m_scheduleIndices[nodes.at(i)] = i;
+
+    QVector<int> inDegree(count, 0);
+    m_successorOffsets.resize(count + 1);
+    m_successorOffsets[0] = 0;
+    m_successors.clear();
+    for (int i = 0; i < count; ++i) {
+        const int nodeId = nodes.at(i);
+        for (int portId = m_store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = m_store.nextPort(portId)) {
+            if (m_store.portType(portId) != GraphStore::OutputPort)
+                continue;
+            for (int connectionId = m_store.firstConnection(portId); connectionId != GraphStore::InvalidId;
+                 connectionId = m_store.nextConnection(connectionId, portId)) {
+                const int successor = m_store.portNode(m_store.connectionInput(connectionId));
+                if (!isMarked(successor))
+                    continue;
+                m_successors.append(successor);
+                ++inDegree[m_scheduleIndices.at(successor)];
+            }
+        }
+        m_successorOffsets[i + 1] = m_successors.size();
+    }
+
+    m_pendingInputs.resize(count);
+    for (int i = 0; i < count; ++i)
+        m_pendingInputs[i].store(inDegree.at(i));
+
+    QVector<int> order;
+    order.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        if (inDegree.at(i) == 0)
+            order.append(i);
+    }
+    QVector<int> levels(count, 0);
+    int levelCount = order.isEmpty() ? 0 : 1;
+    for (int i = 0; i < order.size(); ++i) {
+        const int index = order.at(i);
+        for (int s = m_successorOffsets.at(index); s < m_successorOffsets.at(index + 1); ++s) {
+            const int successor = m_scheduleIndices.at(m_successors.at(s));
+            levels[successor] = qMax(levels.at(successor), levels.at(index) + 1);
+            if (--inDegree[successor] == 0) {
+                order.append(successor);
+                levelCount = qMax(levelCount, levels.at(successor) + 1);
+            }
+        }
+    }
+
+    // counting sort by level keeps the order topological
+    m_levelOffsets.fill(0, levelCount + 1);
+    for (int index : qAsConst(order))
+        ++m_levelOffsets[levels.at(index) + 1];
+    for (int level = 0; level < levelCount; ++level)
+        m_levelOffsets[level + 1] += m_levelOffsets.at(level);
+    m_order.resize(order.size());
+    QVector<int> cursors = m_levelOffsets;
+    for (int index : qAsConst(order))
+        m_order[cursors[levels.at(index)]++] = nodes.at(index);
+
+    m_cycleNodes.clear();
+    for (int i = 0; i < count; ++i) {
+        if (inDegree.at(i) > 0)
+            m_cycleNodes.append(nodes.at(i));
+    }
+}
+
+/**
+ * @brief GraphEvaluator::runChain evaluates a node and keeps going with a successor it made ready
+ * Runs on a thread of the pool, further ready successors are queued as new tasks
+ * @param nodeId a node whose upstream nodes are all evaluated
+ */
+void GraphEvaluator::runChain(int nodeId)
+{
+    while (nodeId != GraphStore::InvalidId) {
+        evaluateNode(nodeId);
+        const int index = m_scheduleIndices.at(nodeId);
+        int next = GraphStore::InvalidId;
+        for (int s = m_successorOffsets.at(index); s < m_successorOffsets.at(index + 1); ++s) {
+            const int successor = m_successors.at(s);
+            if (m_pendingSlots[m_scheduleIndices.at(successor)].deref())
+                continue;
+            if (next == GraphStore::InvalidId)
+                next = successor;
+            else
+                m_threadPool->start(new GraphEvaluatorTask(this, successor));
+        }
+        m_finishedNodes.release();
+        nodeId = next;
+    }
+}
+
+/**
+ * @brief GraphEvaluator::evaluateLevels evaluates the graph one level at a time
+ * The input ports of a level are resolved in parallel ranges of nodes, then the expression
+ * outputs of the level are grouped by their code and every group is run in column batches
+ */
+void GraphEvaluator::evaluateLevels()
+{
+    for (int level = 0; level < levelCount(); ++level) {
+        const int begin = m_levelOffsets.at(level);
+        forEachRange(m_levelOffsets.at(level + 1) - begin, NodeGrain, [this, begin](int from, int to) {
+            for (int i = from; i < to; ++i)
+                evaluateInputs(m_order.at(begin + i));
+        });
+
+        QHash<const GraphExpression *, QVector<int>> batches;
+        for (int i = begin; i < m_levelOffsets.at(level + 1); ++i) {
+            const int nodeId = m_order.at(i);
+            for (int portId = m_store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = m_store.nextPort(portId)) {
+                if (m_store.portType(portId) != GraphStore::OutputPort)
+                    continue;
+                const int index = m_kernelIndices.at(portId);
+                if (index >= 0 && m_kernels.at(index).expression && !m_kernels.at(index).slotPorts.contains(int(GraphStore::InvalidId)))
+                    batches[m_kernels.at(index).expression.data()].append(portId);
+                else
+                    m_resultSlots[portId] = evaluateValue(portId);
+            }
+        }
+        for (QHash<const GraphExpression *, QVector<int>>::const_iterator it = batches.constBegin(); it != batches.constEnd(); ++it)
+            evaluateBatch(*it.key(), it.value());
+    }
+}
+
+/**
+ * @brief GraphEvaluator::evaluateBatch runs one expression for many output ports
+ * The slot values of the ports are gathered into columns and the code runs once per range
+ * @param expression code shared by the ports
+ * @param portIds output ports whose kernels bind every slot
+ */
+void GraphEvaluator::evaluateBatch(const GraphExpression &expression, const QVector<int> &portIds)
+{
+    const int slotCount = expression.names().size();
+    forEachRange(portIds.size(), BatchGrain, [&](int from, int to) {
+        const int count = to - from;
+        QVector<double> columns(slotCount * count);
+        QVector<double> results(count);
+        QVector<bool> valid(count, true);
+        for (int lane = 0; lane < count; ++lane) {
+            const int portId = portIds.at(from + lane);
+            const Kernel &kernel = m_kernels.at(m_kernelIndices.at(portId));
+            for (int slot = 0; slot < slotCount; ++slot) {
+                if (!readSlot(portId, kernel, slot, &columns[slot * count + lane]))
+                    valid[lane] = false;
+            }
+        }
+        expression.evaluateBatch(columns.constData(), count, results.data());
+        for (int lane = 0; lane < count; ++lane)
+            m_resultSlots[portIds.at(from + lane)] = valid.at(lane) ? QVariant(results.at(lane)) : QVariant();
+    });
+}
+
+/**
+ * @brief GraphEvaluator::forEachRange splits count items into ranges run on the thread pool
+ * The calling thread takes the first range and waits for the others
+ * @param count number of items
+ * @param grain smallest range worth a task
+ * @param function called with the begin and end of every range
+ */
+void GraphEvaluator::forEachRange(int count, int grain, const std::function<void(int, int)> &function)
+{
+    const int threadCount = m_threadPool ? m_threadPool->maxThreadCount() : 1;
+    const int rangeCount = qMin(threadCount, (count + grain - 1) / grain);
+    if (rangeCount < 2) {
+        function(0, count);
+        return;
+    }
+
+    QSemaphore finished;
+    const int rangeSize = (count + rangeCount - 1) / rangeCount;
+    for (int range = 1; range < rangeCount; ++range)
+        m_threadPool->start(new GraphEvaluatorRangeTask(function, range * rangeSize, qMin(count, (range + 1) * rangeSize), &finished));
+    function(0, rangeSize);
+    finished.acquire(rangeCount - 1);
+}
+
+/**
+ * @brief GraphEvaluator::evaluateNode computes the results of the ports of one node
+ * @param nodeId node handle
+ */
+void GraphEvaluator::evaluateNode(int nodeId)
+{
+    evaluateInputs(nodeId);
+    for (int portId = m_store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = m_store.nextPort(portId)) {
+        if (m_store.portType(portId) == GraphStore::OutputPort)
+            m_resultSlots[portId] = evaluateValue(portId);
+    }
+}
+
+/**
+ * @brief GraphEvaluator::evaluateInputs computes the results of the input ports of one node
+ * @param nodeId node handle
+ */
+void GraphEvaluator::evaluateInputs(int nodeId)
+{
+    for (int portId = m_store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = m_store.nextPort(portId)) {
+        if (m_store.portType(portId) != GraphStore::InputPort)
+            continue;
+        const int connectionId = m_store.firstConnection(portId);
+        m_resultSlots[portId] = connectionId != GraphStore::InvalidId
+                ? m_resultSlots[m_store.connectionOutput(connectionId)]
+                : evaluateValue(portId);
+    }
+}
+
+/**
+ * @brief GraphEvaluator::evaluateValue computes the value of an unconnected port
+ * Strings run the kernel of the port, other values are taken as they are
+ * @param portId port handle
+ * @return the result, invalid if the expression fails
+ */
+QVariant GraphEvaluator::evaluateValue(int portId)
+{
+    const int index = m_kernelIndices.at(portId);
+    if (index < 0)
+        return m_store.portValue(portId);
+
+    const Kernel &kernel = m_kernels.at(index);
+    if (!kernel.expression) {
+        reportError(portId, kernel.errorString);
+        return QVariant();
+    }
+    QVarLengthArray<double, 8> slotValues(kernel.slotPorts.size());
+    for (int slot = 0; slot < slotValues.size(); ++slot) {
+        if (!readSlot(portId, kernel, slot, &slotValues[slot]))
+            return QVariant();
+    }
+    return kernel.expression->evaluate(slotValues.constData());
+}
+
+/**
+ * @brief GraphEvaluator::readSlot reads the value bound to a slot of a kernel
+ * @param portId port of the kernel, for error reporting
+ * @param kernel kernel of the port
+ * @param slot slot index
+ * @param value receives the result of the bound input port
+ * @return false if the name is unknown or its value is not a number
+ */
+bool GraphEvaluator::readSlot(int portId, const Kernel &kernel, int slot, double *value)
+{
+    const int inputId = kernel.slotPorts.at(slot);
+    if (inputId == GraphStore::InvalidId) {
+        reportError(portId, tr("Unknown name '%1' in '%2'").arg(kernel.expression->names().at(slot), kernel.text));
+        return false;
+    }
+    bool ok;
+    *value = m_resultSlots[inputId].toDouble(&ok);
+    if (!ok)
+        reportError(portId, tr("'%1' is not a number").arg(kernel.expression->names().at(slot)));
+    return ok;
+}
+
+void GraphEvaluator::reportError(int portId, const QString &error)
+{
+    reportError(tr("%1.%2: %3").arg(m_store.nodeName(m_store.portNode(portId)), m_store.portName(portId), error));
+}
+
+void GraphEvaluator::reportError(const QString &error)
+{
+    QMutexLocker locker(&m_errorMutex);
+    m_errors.append(error);
+}
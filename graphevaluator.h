@@ -0,0 +1,150 @@
+#pragma once
+
+#include "graphexpression.h"
+#include "graphstore.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QHash>
+#include <QMutex>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include <functional>
+
+class QThreadPool;
+
+class GraphEvaluator
+{
+    Q_DECLARE_TR_FUNCTIONS(GraphEvaluator)
+
+public:
+    // graphs with fewer evaluable nodes are evaluated on the calling thread
+    static const int ParallelThreshold = 64;
+    // graphs whose levels hold at least this many nodes on average are evaluated level by level,
+    // the expression outputs of a level that share their code run as one batch
+    static const int BatchWidth = 256;
+
+    explicit GraphEvaluator(const GraphStore &store);
+
+    inline QThreadPool *threadPool() const { return m_threadPool; }
+    inline void setThreadPool(QThreadPool *threadPool) { m_threadPool = threadPool; }
+    inline int batchWidth() const { return m_batchWidth; }
+    // 0 evaluates node by node whatever the shape of the graph
+    inline void setBatchWidth(int batchWidth) { m_batchWidth = batchWidth; }
+
+    bool evaluate(QString *errorString);
+    bool pull(int nodeId, QString *errorString);
+    void clear();
+
+    void markDirty(int nodeId, QVector<int> *dirtiedNodes = nullptr);
+    void forgetNode(int nodeId);
+    void invalidate();
+    // nodes never evaluated are dirty, a port is dirty whenever its node is
+    inline bool isNodeDirty(int nodeId) const { return nodeId >= m_nodeDirty.size() || m_nodeDirty.at(nodeId); }
+    inline bool isPortDirty(int portId) const { return isNodeDirty(m_store.portNode(portId)); }
+    inline int dirtyNodeCount() const { return m_dirtyNodeCount; }
+
+    // the result computed by the last evaluation of the node, see pull()
+    inline QVariant result(int portId) const { return m_results.value(portId); }
+    inline int evaluatedNodeCount() const { return m_order.size(); }
+    inline int levelCount() const { return qMax(0, m_levelOffsets.size() - 1); }
+    inline const QVector<int> &cycleNodes() const { return m_cycleNodes; }
+    // number of expression texts parsed since construction, equal texts are parsed once
+    inline int compileCount() const { return m_compileCount; }
+    // nodes made dirty and nodes recomputed since construction or resetCounters()
+    inline qint64 dirtiedNodeCount() const { return m_dirtiedNodeCount; }
+    inline qint64 recomputedNodeCount() const { return m_recomputedNodeCount; }
+    inline void resetCounters() { m_dirtiedNodeCount = 0; m_recomputedNodeCount = 0; }
+
+private:
+    friend class GraphEvaluatorTask;
+    friend class GraphEvaluatorRangeTask;
+
+    // expression code compiled from one text, shared by all ports holding that text
+    struct CompiledExpression
+    {
+        QSharedPointer<const GraphExpression> expression;
+        QString errorString;
+    };
+
+    // expression of one port with its names bound to the input ports of the node
+    struct Kernel
+    {
+        bool compiled = false;
+        QString text;
+        int nodeId = GraphStore::InvalidId;
+        quint32 nodeRevision = 0;
+        QSharedPointer<const GraphExpression> expression;
+        QString errorString;
+        QVector<int> slotPorts;
+    };
+
+    // compiled texts kept for reuse, the cache is dropped when it grows beyond this
+    static const int ExpressionCacheSize = 4096;
+    static const int NodeGrain = 256;
+    static const int BatchGrain = 1024;
+
+    void growDirtyFlags();
+    void beginMarking();
+    inline void mark(int nodeId) { m_nodeMarks[nodeId] = m_markEpoch; }
+    inline bool isMarked(int nodeId) const { return m_nodeMarks.at(nodeId) == m_markEpoch; }
+    void setDirty(int nodeId, bool dirty);
+    bool run(const QVector<int> &nodes, QString *errorString);
+    void prepareKernels(const QVector<int> &nodes);
+    void prepareKernel(int portId);
+    const CompiledExpression &compile(const QString &text);
+    void bindKernel(Kernel *kernel, int portId);
+    void buildSchedule(const QVector<int> &nodes);
+    void runChain(int nodeId);
+    void evaluateLevels();
+    void evaluateBatch(const GraphExpression &expression, const QVector<int> &portIds);
+    void forEachRange(int count, int grain, const std::function<void(int, int)> &function);
+    void evaluateNode(int nodeId);
+    void evaluateInputs(int nodeId);
+    QVariant evaluateValue(int portId);
+    bool readSlot(int portId, const Kernel &kernel, int slot, double *value);
+    void reportError(int portId, const QString &error);
+    void reportError(const QString &error);
+
+    const GraphStore &m_store;
+    QThreadPool *m_threadPool;
+    int m_batchWidth = BatchWidth;
+    QVector<QVariant> m_results;
+    QVector<bool> m_nodeDirty;
+    // nodes made dirty since the last evaluate(), may hold nodes cleaned by pull() or removed since
+    QVector<int> m_dirtyNodes;
+    int m_dirtyNodeCount = 0;
+    qint64 m_dirtiedNodeCount = 0;
+    qint64 m_recomputedNodeCount = 0;
+    // a node is marked when its entry equals the epoch, so that marks are dropped in O(1)
+    QVector<quint32> m_nodeMarks;
+    quint32 m_markEpoch = 0;
+    QHash<QString, CompiledExpression> m_expressions;
+    int m_compileCount = 0;
+    // kernel of every port holding a string, -1 for the other ports
+    QVector<int> m_kernelIndices;
+    QVector<Kernel> m_kernels;
+    QVector<int> m_freeKernels;
+    // position of every node in the scheduled nodes, valid for the marked nodes only
+    QVector<int> m_scheduleIndices;
+    // downstream nodes of every scheduled node in compressed rows by schedule index,
+    // a node is listed once per connection
+    QVector<int> m_successorOffsets;
+    QVector<int> m_successors;
+    // upstream connections of every scheduled node that are not evaluated yet, by schedule index
+    QVector<QAtomicInt> m_pendingInputs;
+    // scheduled nodes in topological order sorted by level, without the nodes on or behind a cycle
+    QVector<int> m_order;
+    QVector<int> m_levelOffsets;
+    QVector<int> m_cycleNodes;
+    // raw table pointers shared by the worker threads during evaluate()
+    QVariant *m_resultSlots = nullptr;
+    QAtomicInt *m_pendingSlots = nullptr;
+    QSemaphore m_finishedNodes;
+    QMutex m_errorMutex;
+    QStringList m_errors;
+};
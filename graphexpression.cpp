@@ -0,0 +1,323 @@
+#include "graphexpression.h"
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <functional>
+
+/**
+ * @brief The GraphExpression class is the compiled form of the arithmetic held by expression ports
+ * Expressions consist of numbers, names, the operators + - * / with the usual precedence,
+ * unary minus and parentheses, e.g. "50 + 50 * 1" or "Integer_1 * 2".
+ *
+ * compile() parses the text once into postfix code for a small stack machine, constant
+ * subexpressions are folded on the way. Every distinct name gets a slot, the caller binds
+ * the slots to values, the evaluator binds them to the input ports of the node.
+ * evaluateBatch() runs the same code over many slot rows at once, one instruction at a time
+ * over whole columns, so the inner loops are plain array arithmetic the compiler can vectorise.
+ */
+
+class GraphExpressionCompiler
+{
+public:
+    GraphExpressionCompiler(const QString &text, GraphExpression *expression)
+        : m_text(text), m_expression(expression)
+    {
+    }
+
+    bool compile()
+    {
+        if (!parseSum())
+            return false;
+        skipSpaces();
+        if (m_pos < m_text.size())
+            return setError(GraphExpression::tr("Unexpected '%1' at %2").arg(m_text.at(m_pos)).arg(m_pos));
+        return true;
+    }
+
+    inline QString errorString() const { return m_errorString; }
+
+private:
+    bool parseSum()
+    {
+        if (!parseProduct())
+            return false;
+        for (;;) {
+            skipSpaces();
+            if (m_pos >= m_text.size())
+                return true;
+            const QChar op = m_text.at(m_pos);
+            if (op != QLatin1Char('+') && op != QLatin1Char('-'))
+                return true;
+            ++m_pos;
+            if (!parseProduct())
+                return false;
+            emitBinary(op == QLatin1Char('+') ? GraphExpression::Add : GraphExpression::Subtract);
+        }
+    }
+
+    bool parseProduct()
+    {
+        if (!parseFactor())
+            return false;
+        for (;;) {
+            skipSpaces();
+            if (m_pos >= m_text.size())
+                return true;
+            const QChar op = m_text.at(m_pos);
+            if (op != QLatin1Char('*') && op != QLatin1Char('/'))
+                return true;
+            ++m_pos;
+            if (!parseFactor())
+                return false;
+            emitBinary(op == QLatin1Char('*') ? GraphExpression::Multiply : GraphExpression::Divide);
+        }
+    }
+
+    bool parseFactor()
+    {
+        skipSpaces();
+        if (m_pos >= m_text.size())
+            return setError(GraphExpression::tr("Unexpected end of expression"));
+
+        const QChar c = m_text.at(m_pos);
+        if (c == QLatin1Char('-')) {
+            ++m_pos;
+            if (!parseFactor())
+                return false;
+            emitNegate();
+            return true;
+        }
+        if (c == QLatin1Char('(')) {
+            ++m_pos;
+            if (!parseSum())
+                return false;
+            skipSpaces();
+            if (m_pos >= m_text.size() || m_text.at(m_pos) != QLatin1Char(')'))
+                return setError(GraphExpression::tr("Missing ')' at %1").arg(m_pos));
+            ++m_pos;
+            return true;
+        }
+        if (c.isDigit() || c == QLatin1Char('.'))
+            return parseNumber();
+        if (c.isLetter() || c == QLatin1Char('_'))
+            return parseName();
+        return setError(GraphExpression::tr("Unexpected '%1' at %2").arg(c).arg(m_pos));
+    }
+
+    bool parseNumber()
+    {
+        const int start = m_pos;
+        while (m_pos < m_text.size() && (m_text.at(m_pos).isDigit() || m_text.at(m_pos) == QLatin1Char('.')))
+            ++m_pos;
+        if (m_pos < m_text.size() && (m_text.at(m_pos) == QLatin1Char('e') || m_text.at(m_pos) == QLatin1Char('E'))) {
+            ++m_pos;
+            if (m_pos < m_text.size() && (m_text.at(m_pos) == QLatin1Char('+') || m_text.at(m_pos) == QLatin1Char('-')))
+                ++m_pos;
+            while (m_pos < m_text.size() && m_text.at(m_pos).isDigit())
+                ++m_pos;
+        }
+        bool ok;
+        const double value = m_text.midRef(start, m_pos - start).toDouble(&ok);
+        if (!ok)
+            return setError(GraphExpression::tr("Invalid number at %1").arg(start));
+        emitConstant(value);
+        return true;
+    }
+
+    bool parseName()
+    {
+        const int start = m_pos;
+        while (m_pos < m_text.size() && (m_text.at(m_pos).isLetterOrNumber() || m_text.at(m_pos) == QLatin1Char('_')))
+            ++m_pos;
+        const QString name = m_text.mid(start, m_pos - start);
+        int slot = m_expression->m_names.indexOf(name);
+        if (slot < 0) {
+            slot = m_expression->m_names.size();
+            m_expression->m_names.append(name);
+        }
+        append(GraphExpression::LoadSlot, slot, 1);
+        return true;
+    }
+
+    void emitConstant(double value)
+    {
+        m_expression->m_constants.append(value);
+        append(GraphExpression::PushConstant, m_expression->m_constants.size() - 1, 1);
+    }
+
+    void emitBinary(GraphExpression::OpCode opCode)
+    {
+        QVector<GraphExpression::Instruction> &code = m_expression->m_code;
+        const int size = code.size();
+        if (size >= 2 && code.at(size - 2).opCode == GraphExpression::PushConstant
+                && code.at(size - 1).opCode == GraphExpression::PushConstant) {
+            QVector<double> &constants = m_expression->m_constants;
+            const double lhs = constants.at(code.at(size - 2).operand);
+            const double rhs = constants.at(code.at(size - 1).operand);
+            double value;
+            switch (opCode) {
+            case GraphExpression::Add: value = lhs + rhs; break;
+            case GraphExpression::Subtract: value = lhs - rhs; break;
+            case GraphExpression::Multiply: value = lhs * rhs; break;
+            default: value = lhs / rhs; break;
+            }
+            // the rhs constant was pushed last
+            constants.removeLast();
+            code.removeLast();
+            constants[code.last().operand] = value;
+            --m_depth;
+            return;
+        }
+        append(opCode, 0, -1);
+    }
+
+    void emitNegate()
+    {
+        QVector<GraphExpression::Instruction> &code = m_expression->m_code;
+        if (code.last().opCode == GraphExpression::PushConstant) {
+            double &value = m_expression->m_constants[code.last().operand];
+            value = -value;
+            return;
+        }
+        append(GraphExpression::Negate, 0, 0);
+    }
+
+    void append(GraphExpression::OpCode opCode, int operand, int depthChange)
+    {
+        GraphExpression::Instruction instruction;
+        instruction.opCode = opCode;
+        instruction.operand = operand;
+        m_expression->m_code.append(instruction);
+        m_depth += depthChange;
+        m_expression->m_stackDepth = qMax(m_expression->m_stackDepth, m_depth);
+    }
+
+    void skipSpaces()
+    {
+        while (m_pos < m_text.size() && m_text.at(m_pos).isSpace())
+            ++m_pos;
+    }
+
+    bool setError(const QString &error)
+    {
+        m_errorString = error;
+        return false;
+    }
+
+    const QString &m_text;
+    GraphExpression *m_expression;
+    int m_pos = 0;
+    int m_depth = 0;
+    QString m_errorString;
+};
+
+namespace {
+
+template <typename Operation>
+inline void applyColumns(const double *lhs, const double *rhs, double *result, int count, Operation operation)
+{
+    for (int i = 0; i < count; ++i)
+        result[i] = operation(lhs[i], rhs[i]);
+}
+
+} // namespace
+
+/**
+ * @brief GraphExpression::compile parses an expression, replacing the previous code
+ * @param text expression
+ * @param errorString receives a description of the error
+ * @return false if the text is not a valid expression, the expression is left invalid
+ */
+bool GraphExpression::compile(const QString &text, QString *errorString)
+{
+    *this = GraphExpression();
+    GraphExpressionCompiler compiler(text, this);
+    if (!compiler.compile()) {
+        *this = GraphExpression();
+        *errorString = tr("Invalid expression '%1': %2").arg(text, compiler.errorString());
+        return false;
+    }
+    m_code.squeeze();
+    m_constants.squeeze();
+    return true;
+}
+
+/**
+ * @brief GraphExpression::evaluate runs the code once
+ * @param slotValues values of the names, in the order of names()
+ * @return the value of the expression
+ */
+double GraphExpression::evaluate(const double *slotValues) const
+{
+    Q_ASSERT(isValid());
+    QVarLengthArray<double, 16> buffer(m_stackDepth);
+    double *stack = buffer.data();
+    int top = -1;
+    for (const Instruction &instruction : m_code) {
+        switch (instruction.opCode) {
+        case PushConstant: stack[++top] = m_constants.at(instruction.operand); break;
+        case LoadSlot: stack[++top] = slotValues[instruction.operand]; break;
+        case Add: stack[top - 1] += stack[top]; --top; break;
+        case Subtract: stack[top - 1] -= stack[top]; --top; break;
+        case Multiply: stack[top - 1] *= stack[top]; --top; break;
+        case Divide: stack[top - 1] /= stack[top]; --top; break;
+        case Negate: stack[top] = -stack[top]; break;
+        }
+    }
+    return stack[0];
+}
+
+/**
+ * @brief GraphExpression::evaluateBatch runs the code over many rows of slot values
+ * Every instruction processes a whole column, slot columns are read in place
+ * @param slotColumns count values per name, the columns follow each other in the order of names()
+ * @param count number of rows
+ * @param results receives count values
+ */
+void GraphExpression::evaluateBatch(const double *slotColumns, int count, double *results) const
+{
+    Q_ASSERT(isValid());
+    if (count <= 0)
+        return;
+
+    QVector<double> registers(m_stackDepth * count);
+    QVarLengthArray<const double *, 16> operands(m_stackDepth);
+    int top = -1;
+    for (const Instruction &instruction : m_code) {
+        switch (instruction.opCode) {
+        case PushConstant: {
+            double *column = registers.data() + (++top) * count;
+            std::fill(column, column + count, m_constants.at(instruction.operand));
+            operands[top] = column;
+            break;
+        }
+        case LoadSlot:
+            operands[++top] = slotColumns + instruction.operand * count;
+            break;
+        case Negate: {
+            const double *operand = operands[top];
+            double *column = registers.data() + top * count;
+            for (int i = 0; i < count; ++i)
+                column[i] = -operand[i];
+            operands[top] = column;
+            break;
+        }
+        default: {
+            const double *lhs = operands[top - 1];
+            const double *rhs = operands[top];
+            --top;
+            double *column = registers.data() + top * count;
+            switch (instruction.opCode) {
+            case Add: applyColumns(lhs, rhs, column, count, std::plus<double>()); break;
+            case Subtract: applyColumns(lhs, rhs, column, count, std::minus<double>()); break;
+            case Multiply: applyColumns(lhs, rhs, column, count, std::multiplies<double>()); break;
+            default: applyColumns(lhs, rhs, column, count, std::divides<double>()); break;
+            }
+            operands[top] = column;
+            break;
+        }
+        }
+    }
+    std::copy(operands[0], operands[0] + count, results);
+}
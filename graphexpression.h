@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class GraphExpression
+{
+    Q_DECLARE_TR_FUNCTIONS(GraphExpression)
+
+public:
+    enum OpCode : quint8 {
+        PushConstant, LoadSlot, Add, Subtract, Multiply, Divide, Negate
+    };
+
+    struct Instruction
+    {
+        OpCode opCode;
+        int operand;    // constant index for PushConstant, slot for LoadSlot
+    };
+
+    bool compile(const QString &text, QString *errorString);
+
+    inline bool isValid() const { return !m_code.isEmpty(); }
+    inline bool isConstant() const { return m_names.isEmpty(); }
+    // slot i of evaluate() and evaluateBatch() takes the value of names().at(i)
+    inline const QStringList &names() const { return m_names; }
+    inline const QVector<Instruction> &code() const { return m_code; }
+
+    double evaluate(const double *slotValues) const;
+    void evaluateBatch(const double *slotColumns, int count, double *results) const;
+
+private:
+    QVector<Instruction> m_code;
+    QVector<double> m_constants;
+    QStringList m_names;
+    int m_stackDepth = 0;
+
+    friend class GraphExpressionCompiler;
+};
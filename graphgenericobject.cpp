@@ -1,6 +1,46 @@
 #include "graphgenericobject.h"
 
-GraphGenericObject::GraphGenericObject(const QString &name, QObject *parent)
-    : QObject(parent), m_name(name)
+#include "graphcore.h"
+
+/**
+ * @brief The GraphGenericObject class is the base of the QObject facades of graph elements
+ * A facade holds only the handle of its element, all data is read from the GraphStore
+ * of the graph. Facades are created by GraphCore on demand and recycled for new
+ * elements once their element is removed.
+ */
+
+/**
+ * @brief GraphGenericObject::GraphGenericObject ctor
+ * @param id handle of the element in the store
+ * @param graphCore the graph, also the parent of the facade
+ */
+GraphGenericObject::GraphGenericObject(int id, GraphCore *graphCore)
+    : QObject(graphCore), m_graphCore(graphCore), m_id(id)
+{
+}
+
+/**
+ * @brief GraphGenericObject::attach binds a recycled facade to another element
+ * Subclasses reload their cached state and notify the properties that changed
+ * @param id element handle
+ */
+void GraphGenericObject::attach(int id)
+{
+    m_id = id;
+    emit elementChanged();
+}
+
+/**
+ * @brief GraphGenericObject::detach unbinds the facade from a removed element
+ * The handle may be reused by a new element, so a detached facade reads nothing anymore
+ */
+void GraphGenericObject::detach()
+{
+    m_id = GraphStore::InvalidId;
+    emit elementChanged();
+}
+
+const GraphStore &GraphGenericObject::store() const
 {
+    return m_graphCore->store();
 }
@@ -3,22 +3,35 @@
 #include <QObject>
 #include <QColor>
 
+class GraphCore;
+class GraphStore;
+
 class GraphGenericObject : public QObject
 {
     Q_OBJECT
-    Q_PROPERTY(QString name READ name CONSTANT)
-    Q_PROPERTY(QColor color READ color CONSTANT)
+    Q_PROPERTY(QString name READ name NOTIFY elementChanged)
+    Q_PROPERTY(QColor color READ color NOTIFY elementChanged)
 public:
-    explicit GraphGenericObject(const QString &name, QObject *parent);
+    explicit GraphGenericObject(int id, GraphCore *graphCore);
+
+    inline int id() const { return m_id; }
+    inline bool isValid() const { return m_id >= 0; }
+    inline GraphCore *graphCore() const { return m_graphCore; }
+
+    virtual QString name() const = 0;
+    virtual QColor color() const = 0;
 
-    inline QString name() const { return m_name; }
-    inline QColor color() const { return m_color; }
+    virtual void attach(int id);
+    virtual void detach();
 
 signals:
+    // the facade was bound to another element or unbound, or the colour of its element changed
+    void elementChanged();
     void errorOccurred(const QString &error);
 
 protected:
-    QString m_name;
-    QColor m_color;
-};
+    const GraphStore &store() const;
 
+    GraphCore *m_graphCore;
+    int m_id;
+};
@@ -0,0 +1,233 @@
+#include "graphhandlemodel.h"
+
+#include "graphgenericobject.h"
+#include "graphobjectmodel.h"
+
+#include <algorithm>
+
+/**
+ * @brief The GraphHandleModel class exposes a list of graph elements by their store handles
+ * The rows hold only handles. The QObject facade of an element is resolved when a view
+ * reads its row, so a view showing a few rows of a large graph creates only a few facades.
+ * The roles are the ones of GraphObjectModel.
+ * The row of every handle is kept, so a row is found without searching the model.
+ */
+
+/**
+ * @brief GraphHandleModel::GraphHandleModel ctor
+ * @param resolver returns the facade of a handle
+ * @param parent
+ */
+GraphHandleModel::GraphHandleModel(const Resolver &resolver, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_resolver(resolver)
+{
+}
+
+int GraphHandleModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return m_ids.size();
+}
+
+QVariant GraphHandleModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_ids.size())
+        return QVariant();
+
+    GraphGenericObject *object = static_cast<GraphGenericObject *>(m_resolver(m_ids.at(index.row())));
+    if (!object)
+        return QVariant();
+
+    switch (role) {
+    case GraphObjectModel::ObjectRole:
+        return QVariant::fromValue<QObject *>(object);
+    case Qt::DisplayRole:
+    case GraphObjectModel::NameRole:
+        return object->name();
+    case GraphObjectModel::ColorRole:
+        return object->color();
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> GraphHandleModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[GraphObjectModel::ObjectRole] = QByteArrayLiteral("object");
+    roles[GraphObjectModel::NameRole] = QByteArrayLiteral("name");
+    roles[GraphObjectModel::ColorRole] = QByteArrayLiteral("color");
+    return roles;
+}
+
+QObject *GraphHandleModel::objectAt(int row) const
+{
+    if (row < 0 || row >= m_ids.size())
+        return nullptr;
+    return m_resolver(m_ids.at(row));
+}
+
+/**
+ * @brief GraphHandleModel::append adds a new row at the end of the model
+ * @param id element handle
+ */
+void GraphHandleModel::append(int id)
+{
+    if (m_batchDepth > 0) {
+        m_pendingIds.append(id);
+        return;
+    }
+    const int row = m_ids.size();
+    beginInsertRows(QModelIndex(), row, row);
+    m_ids.append(id);
+    setRow(id, row);
+    endInsertRows();
+    emit countChanged(m_ids.size());
+}
+
+/**
+ * @brief GraphHandleModel::remove removes the row of the handle
+ * During a batch the row is only marked and removed when the batch ends
+ * @param id element handle
+ * @return false if the model does not contain the handle, always true during a batch
+ */
+bool GraphHandleModel::remove(int id)
+{
+    if (m_pendingIds.removeOne(id))
+        return true;
+    if (m_batchDepth > 0) {
+        m_removedIds.insert(id);
+        return true;
+    }
+    const int row = rowOf(id);
+    if (row < 0)
+        return false;
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_ids.remove(row);
+    m_rows[id] = -1;
+    updateRows(row);
+    endRemoveRows();
+    emit countChanged(m_ids.size());
+    return true;
+}
+
+/**
+ * @brief GraphHandleModel::clear removes all rows
+ */
+void GraphHandleModel::clear()
+{
+    m_pendingIds.clear();
+    m_removedIds.clear();
+    if (m_ids.isEmpty())
+        return;
+
+    beginResetModel();
+    m_ids.clear();
+    m_rows.clear();
+    endResetModel();
+    emit countChanged(0);
+}
+
+/**
+ * @brief GraphHandleModel::beginBatch starts collecting appended and removed rows instead of applying them one by one
+ * Batches can be nested, rows are removed and inserted when the outermost batch ends
+ */
+void GraphHandleModel::beginBatch()
+{
+    ++m_batchDepth;
+}
+
+/**
+ * @brief GraphHandleModel::endBatch applies the rows removed and appended during the batch
+ * Both are applied in one pass with a single notification each
+ */
+void GraphHandleModel::endBatch()
+{
+    Q_ASSERT(m_batchDepth > 0);
+    if (--m_batchDepth > 0)
+        return;
+
+    // the handle of a removed row may already be reused by a pending one, so only committed rows are erased
+    if (!m_removedIds.isEmpty()) {
+        const QSet<int> removedIds = m_removedIds;
+        m_removedIds.clear();
+        eraseIds(removedIds);
+    }
+    if (m_pendingIds.isEmpty())
+        return;
+
+    const int first = m_ids.size();
+    beginInsertRows(QModelIndex(), first, first + m_pendingIds.size() - 1);
+    m_ids += m_pendingIds;
+    m_pendingIds.clear();
+    updateRows(first);
+    endInsertRows();
+    emit countChanged(m_ids.size());
+}
+
+void GraphHandleModel::setRow(int id, int row)
+{
+    if (id >= m_rows.size())
+        m_rows.resize(qMax(id + 1, 2 * m_rows.size()), -1);
+    m_rows[id] = row;
+}
+
+/**
+ * @brief GraphHandleModel::updateRows records the rows of the handles from a row to the end after they moved
+ */
+void GraphHandleModel::updateRows(int first)
+{
+    for (int row = first; row < m_ids.size(); ++row)
+        setRow(m_ids.at(row), row);
+}
+
+/**
+ * @brief GraphHandleModel::eraseIds removes the rows of the handles
+ * Every run of adjacent rows is removed with one notification, from the last run to the
+ * first so the rows of the remaining runs stay valid. The model is only reset if most of
+ * its rows go, when notifying every run would cost more than recreating the delegates.
+ */
+void GraphHandleModel::eraseIds(const QSet<int> &ids)
+{
+    QVector<int> rows;
+    rows.reserve(ids.size());
+    for (int id : ids) {
+        const int row = rowOf(id);
+        if (row >= 0)
+            rows.append(row);
+    }
+    if (rows.isEmpty())
+        return;
+
+    if (2 * rows.size() > m_ids.size()) {
+        beginResetModel();
+        m_ids.erase(std::remove_if(m_ids.begin(), m_ids.end(), [&ids](int id) {
+            return ids.contains(id);
+        }), m_ids.end());
+        m_rows.fill(-1);
+        updateRows(0);
+        endResetModel();
+        emit countChanged(m_ids.size());
+        return;
+    }
+
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    for (int i = 0; i < rows.size(); ) {
+        const int last = rows.at(i);
+        int first = last;
+        while (++i < rows.size() && rows.at(i) == first - 1)
+            --first;
+        beginRemoveRows(QModelIndex(), first, last);
+        for (int row = first; row <= last; ++row)
+            m_rows[m_ids.at(row)] = -1;
+        m_ids.remove(first, last - first + 1);
+        endRemoveRows();
+    }
+    // the runs are removed from the back, so the rows before the last removed one did not move
+    updateRows(rows.last());
+    emit countChanged(m_ids.size());
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QSet>
+#include <QVector>
+
+#include <functional>
+
+class GraphHandleModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    typedef std::function<QObject *(int)> Resolver;
+
+    explicit GraphHandleModel(const Resolver &resolver, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    inline int count() const { return m_ids.size(); }
+    inline const QVector<int> &ids() const { return m_ids; }
+    Q_INVOKABLE QObject *objectAt(int row) const;
+
+    void append(int id);
+    bool remove(int id);
+    void clear();
+
+    void beginBatch();
+    void endBatch();
+
+signals:
+    void countChanged(int count);
+
+private:
+    inline int rowOf(int id) const { return id >= 0 && id < m_rows.size() ? m_rows.at(id) : -1; }
+    void setRow(int id, int row);
+    void updateRows(int first);
+    void eraseIds(const QSet<int> &ids);
+
+    Resolver m_resolver;
+    QVector<int> m_ids;
+    // row of every handle, -1 for handles without a row, handles are dense so they index a vector
+    QVector<int> m_rows;
+    int m_batchDepth = 0;
+    QVector<int> m_pendingIds;
+    QSet<int> m_removedIds;
+};
@@ -0,0 +1,415 @@
+#include "graphjournal.h"
+#include "graphstore.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QtEndian>
+
+#include <cstring>
+
+/**
+ * @brief The GraphJournal class appends the mutations of a graph to a binary file next to its source file
+ *
+ * The file starts with a header of the magic "GVJF" and the format version as a little
+ * endian 32 bit number. Every record is the little endian 32 bit size of its payload followed
+ * by the payload written by QDataStream: the Operation and the fields it uses. Journals of
+ * older versions are still read, their operations are a subset of the current ones.
+ *
+ * Records are collected in memory and appended to the file by flush(), so writing the
+ * journal costs as much as the changes since the last flush. A record cut short by a crash
+ * is dropped when the journal is read back.
+ */
+
+namespace {
+
+const char Magic[4] = { 'G', 'V', 'J', 'F' };
+const qint64 HeaderSize = 8;
+const QDataStream::Version StreamVersion = QDataStream::Qt_5_12;
+
+} // namespace
+
+/**
+ * @brief GraphJournal::fileNameFor returns the name of the journal kept for a graph file
+ * @param sourceFileName graph file name
+ */
+QString GraphJournal::fileNameFor(const QString &sourceFileName)
+{
+    return sourceFileName + QLatin1String(".journal");
+}
+
+/**
+ * @brief GraphJournal::read reads all complete records of a journal file
+ * A missing file is an empty journal. Reading stops at the first incomplete or
+ * unreadable record, which is what a crash during a write leaves behind.
+ * @param fileName journal file name
+ * @param records receives the records in the order they were written
+ * @param validSize receives the size of the readable part of the file
+ * @param errorString receives a description of the error
+ * @return false if the file exists but is not a journal
+ */
+bool GraphJournal::read(const QString &fileName, QVector<Record> *records, qint64 *validSize, QString *errorString)
+{
+    records->clear();
+    *validSize = 0;
+    QFile file(fileName);
+    if (!file.exists())
+        return true;
+    if (!file.open(QFile::ReadOnly)) {
+        *errorString = tr("Unable to open journal '%1'").arg(fileName);
+        return false;
+    }
+
+    const QByteArray bytes = file.readAll();
+    if (bytes.size() < HeaderSize)
+        return true;
+    if (std::memcmp(bytes.constData(), Magic, sizeof(Magic)) != 0
+            || qFromLittleEndian<quint32>(bytes.constData() + 4) == 0
+            || qFromLittleEndian<quint32>(bytes.constData() + 4) > Version) {
+        *errorString = tr("'%1' is not a journal of a supported version").arg(fileName);
+        return false;
+    }
+
+    qint64 pos = HeaderSize;
+    *validSize = pos;
+    while (bytes.size() - pos >= 4) {
+        const quint32 size = qFromLittleEndian<quint32>(bytes.constData() + pos);
+        if (quint64(bytes.size() - pos - 4) < size)
+            break;
+
+        const QByteArray payload = QByteArray::fromRawData(bytes.constData() + pos + 4, int(size));
+        QDataStream stream(payload);
+        stream.setVersion(StreamVersion);
+        Record record;
+        quint8 operation;
+        qint32 portType;
+        stream >> operation;
+        record.operation = Operation(operation);
+        switch (record.operation) {
+        case AddNode:
+        case MoveNode:
+            stream >> record.nodeName >> record.coord;
+            break;
+        case RemoveNode:
+            stream >> record.nodeName;
+            break;
+        case AddPort:
+        case SetPortValue:
+            stream >> record.nodeName >> portType >> record.portName >> record.value;
+            record.portType = portType;
+            if (!GraphStore::isPortType(portType))
+                stream.setStatus(QDataStream::ReadCorruptData);
+            break;
+        case RemovePort:
+            stream >> record.nodeName >> portType >> record.portName;
+            record.portType = portType;
+            if (!GraphStore::isPortType(portType))
+                stream.setStatus(QDataStream::ReadCorruptData);
+            break;
+        case AddConnection:
+        case RemoveConnection:
+            stream >> record.nodeName >> record.portName >> record.targetNodeName >> record.targetPortName;
+            break;
+        case SetZoomFactor:
+            stream >> record.zoomFactor;
+            break;
+        case ClearGraph:
+            break;
+        default:
+            stream.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+        if (stream.status() != QDataStream::Ok)
+            break;
+
+        records->append(record);
+        pos += 4 + size;
+        *validSize = pos;
+    }
+    return true;
+}
+
+GraphJournal::~GraphJournal()
+{
+    close();
+}
+
+/**
+ * @brief GraphJournal::open opens a journal file for appending
+ * @param fileName journal file name
+ * @param validSize the part of an existing file to keep as returned by read(),
+ * the file is started anew if it holds no complete header
+ * @param errorString receives a description of the error
+ */
+bool GraphJournal::open(const QString &fileName, qint64 validSize, QString *errorString)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QFile::ReadWrite)) {
+        *errorString = tr("Unable to open journal '%1': %2").arg(fileName, m_file.errorString());
+        return false;
+    }
+
+    if (validSize < HeaderSize) {
+        char header[HeaderSize];
+        std::memcpy(header, Magic, sizeof(Magic));
+        qToLittleEndian<quint32>(Version, header + 4);
+        if (!m_file.resize(0) || m_file.write(header, HeaderSize) != HeaderSize) {
+            *errorString = tr("Unable to write journal '%1': %2").arg(fileName, m_file.errorString());
+            m_file.close();
+            return false;
+        }
+    } else if (!m_file.resize(validSize)) {
+        *errorString = tr("Unable to write journal '%1': %2").arg(fileName, m_file.errorString());
+        m_file.close();
+        return false;
+    }
+    m_file.seek(m_file.size());
+    return true;
+}
+
+/**
+ * @brief GraphJournal::close writes the pending records and closes the file
+ */
+void GraphJournal::close()
+{
+    if (!isOpen())
+        return;
+
+    QString errorString;
+    if (!flush(&errorString))
+        qWarning() << errorString;
+    m_file.close();
+}
+
+/**
+ * @brief GraphJournal::discard drops the pending records and removes the journal file
+ */
+void GraphJournal::discard()
+{
+    m_pending.clear();
+    if (!isOpen())
+        return;
+
+    m_file.close();
+    m_file.remove();
+}
+
+/**
+ * @brief GraphJournal::flush appends the records collected since the last flush to the file
+ * @param errorString receives a description of the error
+ */
+bool GraphJournal::flush(QString *errorString)
+{
+    if (!isOpen() || m_pending.isEmpty())
+        return true;
+
+    if (m_file.write(m_pending) != m_pending.size() || !m_file.flush()) {
+        *errorString = tr("Unable to write journal '%1': %2").arg(m_file.fileName(), m_file.errorString());
+        return false;
+    }
+    m_pending.clear();
+    return true;
+}
+
+/**
+ * @brief GraphJournal::mark flushes the journal and returns its size
+ * Everything before the mark is covered by a snapshot taken now, see compact()
+ * @param errorString receives a description of the error
+ * @return size of the file or -1 on error
+ */
+qint64 GraphJournal::mark(QString *errorString)
+{
+    if (!isOpen() || !flush(errorString))
+        return -1;
+    return m_file.size();
+}
+
+/**
+ * @brief GraphJournal::compact drops the records before a mark once the graph file contains them
+ * @param from position returned by mark()
+ * @param errorString receives a description of the error
+ */
+bool GraphJournal::compact(qint64 from, QString *errorString)
+{
+    if (!isOpen() || from < HeaderSize || !flush(errorString))
+        return false;
+
+    m_file.seek(from);
+    const QByteArray tail = m_file.readAll();
+    if (!m_file.resize(HeaderSize) || !m_file.seek(HeaderSize)
+            || m_file.write(tail) != tail.size() || !m_file.flush()) {
+        *errorString = tr("Unable to write journal '%1': %2").arg(m_file.fileName(), m_file.errorString());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief GraphJournal::nodeAdded records a new node
+ * Like all recorders it does nothing while the journal is closed, e.g. while a graph is loaded or replayed
+ */
+void GraphJournal::nodeAdded(const QString &name, const QPointF &coord)
+{
+    if (!isOpen())
+        return;
+
+    Record record;
+    record.operation = AddNode;
+    record.nodeName = name;
+    record.coord = coord;
+    append(record);
+}
+
+void GraphJournal::nodeRemoved(const QString &name)
+{
+    if (!isOpen())
+        return;
+
+    Record record;
+    record.operation = RemoveNode;
+    record.nodeName = name;
+    append(record);
+}
+
+void GraphJournal::nodeMoved(const QString &name, const QPointF &coord)
+{
+    if (!isOpen())
+        return;
+
+    Record record;
+    record.operation = MoveNode;
+    record.nodeName = name;
+    record.coord = coord;
+    append(record);
+}
+
+void GraphJournal::portAdded(const QString &nodeName, int portType, const QString &name, const QVariant &value)
+{
+    if (!isOpen())
+        return;
+
+    Record record;
+    record.operation = AddPort;
+    record.nodeName = nodeName;
+    record.portType = portType;
+    record.portName = name;
+    record.value = value;
+    append(record);
+}
+
+void GraphJournal::portRemoved(const QString &nodeName, int portType, const QString &name)
+{
+    if (!isOpen())
+        return;
+
+    Record record;
+    record.operation = RemovePort;
+    record.nodeName = nodeName;
+    record.portType = portType;
+    record.portName = name;
+    append(record);
+}
+
+void GraphJournal::portValueChanged(const QString &nodeName, int portType, const QString &name, const QVariant &value)
+{
+    if (!isOpen())
+        return;
+
+    Record record;
+    record.operation = SetPortValue;
+    record.nodeName = nodeName;
+    record.portType = portType;
+    record.portName = name;
+    record.value = value;
+    append(record);
+}
+
+void GraphJournal::connectionAdded(const QString &src, const QString &out, const QString &dest, const QString &in)
+{
+    if (!isOpen())
+        return;
+
+    Record record;
+    record.operation = AddConnection;
+    record.nodeName = src;
+    record.portName = out;
+    record.targetNodeName = dest;
+    record.targetPortName = in;
+    append(record);
+}
+
+void GraphJournal::connectionRemoved(const QString &src, const QString &out, const QString &dest, const QString &in)
+{
+    if (!isOpen())
+        return;
+
+    Record record;
+    record.operation = RemoveConnection;
+    record.nodeName = src;
+    record.portName = out;
+    record.targetNodeName = dest;
+    record.targetPortName = in;
+    append(record);
+}
+
+void GraphJournal::zoomFactorChanged(double zoomFactor)
+{
+    if (!isOpen())
+        return;
+
+    Record record;
+    record.operation = SetZoomFactor;
+    record.zoomFactor = zoomFactor;
+    append(record);
+}
+
+void GraphJournal::graphCleared()
+{
+    if (!isOpen())
+        return;
+
+    Record record;
+    record.operation = ClearGraph;
+    append(record);
+}
+
+/**
+ * @brief GraphJournal::append serializes a record into the pending records
+ */
+void GraphJournal::append(const Record &record)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(StreamVersion);
+    stream << quint8(record.operation);
+    switch (record.operation) {
+    case AddNode:
+    case MoveNode:
+        stream << record.nodeName << record.coord;
+        break;
+    case RemoveNode:
+        stream << record.nodeName;
+        break;
+    case AddPort:
+    case SetPortValue:
+        stream << record.nodeName << qint32(record.portType) << record.portName << record.value;
+        break;
+    case RemovePort:
+        stream << record.nodeName << qint32(record.portType) << record.portName;
+        break;
+    case AddConnection:
+    case RemoveConnection:
+        stream << record.nodeName << record.portName << record.targetNodeName << record.targetPortName;
+        break;
+    case SetZoomFactor:
+        stream << record.zoomFactor;
+        break;
+    default:
+        break;
+    }
+
+    char size[4];
+    qToLittleEndian<quint32>(quint32(payload.size()), size);
+    m_pending.append(size, sizeof(size));
+    m_pending.append(payload);
+}
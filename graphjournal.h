@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QFile>
+#include <QPointF>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+class GraphJournal
+{
+    Q_DECLARE_TR_FUNCTIONS(GraphJournal)
+
+public:
+    static const quint32 Version = 2;
+
+    enum Operation : quint8 {
+        InvalidOperation = 0,
+        AddNode, RemoveNode, MoveNode,
+        AddPort, RemovePort,
+        AddConnection, RemoveConnection,
+        SetZoomFactor,
+        ClearGraph,
+        SetPortValue    // since version 2
+    };
+
+    // one mutation, elements are referred to by name since handles do not survive a reload
+    struct Record
+    {
+        Operation operation = InvalidOperation;
+        QString nodeName;           // source node of a connection
+        QString portName;           // output port of a connection
+        QString targetNodeName;
+        QString targetPortName;     // input port of a connection
+        int portType = 0;
+        QVariant value;
+        QPointF coord;
+        double zoomFactor = 1.0;
+    };
+
+    static QString fileNameFor(const QString &sourceFileName);
+    static bool read(const QString &fileName, QVector<Record> *records, qint64 *validSize, QString *errorString);
+
+    ~GraphJournal();
+
+    bool open(const QString &fileName, qint64 validSize, QString *errorString);
+    void close();
+    void discard();
+    inline bool isOpen() const { return m_file.isOpen(); }
+    inline QString fileName() const { return m_file.fileName(); }
+    inline bool hasPendingRecords() const { return !m_pending.isEmpty(); }
+
+    bool flush(QString *errorString);
+    qint64 mark(QString *errorString);
+    bool compact(qint64 from, QString *errorString);
+
+    void nodeAdded(const QString &name, const QPointF &coord);
+    void nodeRemoved(const QString &name);
+    void nodeMoved(const QString &name, const QPointF &coord);
+    void portAdded(const QString &nodeName, int portType, const QString &name, const QVariant &value);
+    void portRemoved(const QString &nodeName, int portType, const QString &name);
+    void portValueChanged(const QString &nodeName, int portType, const QString &name, const QVariant &value);
+    void connectionAdded(const QString &src, const QString &out, const QString &dest, const QString &in);
+    void connectionRemoved(const QString &src, const QString &out, const QString &dest, const QString &in);
+    void zoomFactorChanged(double zoomFactor);
+    void graphCleared();
+
+private:
+    void append(const Record &record);
+
+    QFile m_file;
+    QByteArray m_pending;
+};
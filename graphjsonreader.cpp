@@ -0,0 +1,706 @@
+#include "graphjsonreader.h"
+
+#include "graphcore.h"
+#include "graphnodeport.h"
+
+#include <QDebug>
+#include <QIODevice>
+
+/**
+ * @brief The GraphJsonReader class reads a graph from a JSON file without building a document
+ * The file is read in chunks of raw bytes and tokenised incrementally, every node, port and
+ * connection record goes straight into GraphData as soon as it has been parsed.
+ * Reading reports its progress and stops at the next record once the cancel flag is set.
+ */
+
+namespace {
+
+const int ChunkSize = 256 * 1024;
+const int MaxDepth = 512;
+
+inline bool isWhitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline bool isNumberChar(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+void appendUtf8(QByteArray *utf8, uint codePoint)
+{
+    if (codePoint < 0x80) {
+        utf8->append(char(codePoint));
+    } else if (codePoint < 0x800) {
+        utf8->append(char(0xC0 | (codePoint >> 6)));
+        utf8->append(char(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+        utf8->append(char(0xE0 | (codePoint >> 12)));
+        utf8->append(char(0x80 | ((codePoint >> 6) & 0x3F)));
+        utf8->append(char(0x80 | (codePoint & 0x3F)));
+    } else {
+        utf8->append(char(0xF0 | (codePoint >> 18)));
+        utf8->append(char(0x80 | ((codePoint >> 12) & 0x3F)));
+        utf8->append(char(0x80 | ((codePoint >> 6) & 0x3F)));
+        utf8->append(char(0x80 | (codePoint & 0x3F)));
+    }
+}
+
+} // namespace
+
+/**
+ * @brief GraphJsonReader::GraphJsonReader ctor
+ * @param device opened device to read from
+ */
+GraphJsonReader::GraphJsonReader(QIODevice *device)
+    : m_device(device)
+{
+    for (int i = 0; i < GraphCore::END_ID; ++i)
+        m_keys.insert(GraphCore::getKey(static_cast<GraphCore::JsonKeyID>(i)).toUtf8(), i);
+}
+
+/**
+ * @brief GraphJsonReader::setProgressHandler sets a function called after every chunk read from the device
+ */
+void GraphJsonReader::setProgressHandler(const ProgressHandler &handler)
+{
+    m_progressHandler = handler;
+}
+
+/**
+ * @brief GraphJsonReader::setCancelFlag sets a flag which stops reading once it becomes non-zero
+ * The flag may be set from any thread
+ */
+void GraphJsonReader::setCancelFlag(const QAtomicInt *cancelFlag)
+{
+    m_cancelFlag = cancelFlag;
+}
+
+/**
+ * @brief GraphJsonReader::read reads the whole graph
+ * @param data receives the graph, it is only complete if reading succeeds
+ * @return false on a parse error or cancellation, see errorString() and isCancelled()
+ */
+bool GraphJsonReader::read(GraphData *data)
+{
+    m_buffer.clear();
+    m_pos = 0;
+    m_bytesRead = 0;
+    m_bytesTotal = m_device->isSequential() ? 0 : m_device->size();
+    m_eof = false;
+    m_cancelled = false;
+    m_errorString.clear();
+
+    *data = GraphData();
+    if (!readScene(data))
+        return false;
+
+    char c;
+    if (nextChar(&c))
+        return setError(tr("Unexpected data after the end of the document"));
+    return m_errorString.isEmpty();
+}
+
+bool GraphJsonReader::fill()
+{
+    if (m_eof || !checkCancel())
+        return false;
+
+    m_buffer.resize(ChunkSize);
+    const qint64 bytes = m_device->read(m_buffer.data(), ChunkSize);
+    if (bytes <= 0) {
+        if (bytes < 0)
+            setError(m_device->errorString());
+        m_eof = true;
+        m_buffer.clear();
+        m_pos = 0;
+        return false;
+    }
+    m_buffer.resize(int(bytes));
+    m_pos = 0;
+    m_bytesRead += bytes;
+    if (m_progressHandler)
+        m_progressHandler(m_bytesRead, m_bytesTotal);
+    return true;
+}
+
+/**
+ * @brief GraphJsonReader::nextChar skips whitespace and peeks the next character
+ * @return false at the end of the data
+ */
+bool GraphJsonReader::nextChar(char *c)
+{
+    for (;;) {
+        if (m_pos >= m_buffer.size() && !fill())
+            return false;
+        const char *data = m_buffer.constData();
+        const int size = m_buffer.size();
+        while (m_pos < size && isWhitespace(data[m_pos]))
+            ++m_pos;
+        if (m_pos < size) {
+            *c = data[m_pos];
+            return true;
+        }
+    }
+}
+
+bool GraphJsonReader::getChar(char *c)
+{
+    if (m_pos >= m_buffer.size() && !fill())
+        return false;
+    *c = m_buffer.at(m_pos++);
+    return true;
+}
+
+bool GraphJsonReader::expect(char c)
+{
+    char next;
+    if (!nextChar(&next))
+        return setError(tr("Unexpected end of data, '%1' expected").arg(QLatin1Char(c)));
+    if (next != c)
+        return setError(tr("'%1' expected").arg(QLatin1Char(c)));
+    ++m_pos;
+    return true;
+}
+
+bool GraphJsonReader::checkCancel()
+{
+    if (m_cancelled)
+        return false;
+    if (m_cancelFlag && m_cancelFlag->loadAcquire()) {
+        m_cancelled = true;
+        m_errorString = tr("Loading was cancelled");
+        return false;
+    }
+    return true;
+}
+
+bool GraphJsonReader::setError(const QString &error)
+{
+    if (m_errorString.isEmpty()) {
+        const qint64 offset = m_bytesRead - (m_buffer.size() - m_pos);
+        m_errorString = tr("JSON parse error at offset %1: %2").arg(offset).arg(error);
+    }
+    return false;
+}
+
+/**
+ * @brief GraphJsonReader::nextMember moves to the next member of an object and reads its key
+ * @param first true before the first member, updated by the call
+ * @param key receives the GraphCore::JsonKeyID of the member name
+ */
+GraphJsonReader::Next GraphJsonReader::nextMember(bool *first, int *key)
+{
+    char c;
+    if (!nextChar(&c)) {
+        setError(tr("Unexpected end of data in an object"));
+        return ParseError;
+    }
+    if (c == '}') {
+        ++m_pos;
+        return EndOfContainer;
+    }
+    if (!*first) {
+        if (c != ',') {
+            setError(tr("',' or '}' expected"));
+            return ParseError;
+        }
+        ++m_pos;
+    }
+    *first = false;
+    if (!readRawString(&m_scratch) || !expect(':'))
+        return ParseError;
+    *key = m_keys.value(m_scratch, GraphCore::Undefined);
+    return NextItem;
+}
+
+/**
+ * @brief GraphJsonReader::nextElement moves to the next element of an array
+ * @param first true before the first element, updated by the call
+ */
+GraphJsonReader::Next GraphJsonReader::nextElement(bool *first)
+{
+    char c;
+    if (!nextChar(&c)) {
+        setError(tr("Unexpected end of data in an array"));
+        return ParseError;
+    }
+    if (c == ']') {
+        ++m_pos;
+        return EndOfContainer;
+    }
+    if (!*first) {
+        if (c != ',') {
+            setError(tr("',' or ']' expected"));
+            return ParseError;
+        }
+        ++m_pos;
+    }
+    *first = false;
+    return NextItem;
+}
+
+/**
+ * @brief GraphJsonReader::readRawString reads a string and decodes its escapes to UTF-8
+ * Unescaped runs are copied from the read buffer in one piece
+ */
+bool GraphJsonReader::readRawString(QByteArray *utf8)
+{
+    if (!expect('"'))
+        return false;
+
+    utf8->resize(0);
+    for (;;) {
+        if (m_pos >= m_buffer.size() && !fill())
+            return setError(tr("Unterminated string"));
+
+        const char *data = m_buffer.constData();
+        const int size = m_buffer.size();
+        const int start = m_pos;
+        while (m_pos < size && data[m_pos] != '"' && data[m_pos] != '\\')
+            ++m_pos;
+        utf8->append(data + start, m_pos - start);
+        if (m_pos >= size)
+            continue;
+        if (data[m_pos++] == '"')
+            return true;
+
+        char escape;
+        if (!getChar(&escape))
+            return setError(tr("Unterminated string"));
+        switch (escape) {
+        case '"':
+        case '\\':
+        case '/':
+            utf8->append(escape);
+            break;
+        case 'b':
+            utf8->append('\b');
+            break;
+        case 'f':
+            utf8->append('\f');
+            break;
+        case 'n':
+            utf8->append('\n');
+            break;
+        case 'r':
+            utf8->append('\r');
+            break;
+        case 't':
+            utf8->append('\t');
+            break;
+        case 'u': {
+            uint codePoint;
+            if (!readHex(&codePoint))
+                return false;
+            if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                uint low = 0;
+                char backslash, u;
+                if (!getChar(&backslash) || !getChar(&u) || backslash != '\\' || u != 'u' || !readHex(&low)
+                        || low < 0xDC00 || low >= 0xE000)
+                    return setError(tr("Invalid surrogate pair"));
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+            } else if (codePoint >= 0xDC00 && codePoint < 0xE000) {
+                codePoint = 0xFFFD;
+            }
+            appendUtf8(utf8, codePoint);
+            break;
+        }
+        default:
+            return setError(tr("Invalid escape sequence"));
+        }
+    }
+}
+
+bool GraphJsonReader::readHex(uint *codeUnit)
+{
+    *codeUnit = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c;
+        if (!getChar(&c))
+            return setError(tr("Unterminated string"));
+        *codeUnit <<= 4;
+        if (c >= '0' && c <= '9')
+            *codeUnit |= uint(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            *codeUnit |= uint(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            *codeUnit |= uint(c - 'A' + 10);
+        else
+            return setError(tr("Invalid unicode escape"));
+    }
+    return true;
+}
+
+/**
+ * @brief GraphJsonReader::readString reads a string
+ * @param intern reuse one QString for all equal strings, used for node and port names
+ */
+bool GraphJsonReader::readString(QString *str, bool intern)
+{
+    if (!readRawString(&m_scratch))
+        return false;
+    if (!intern) {
+        *str = QString::fromUtf8(m_scratch);
+        return true;
+    }
+    auto it = m_strings.constFind(m_scratch);
+    if (it == m_strings.constEnd())
+        it = m_strings.insert(m_scratch, QString::fromUtf8(m_scratch));
+    *str = it.value();
+    return true;
+}
+
+/**
+ * @brief GraphJsonReader::readName reads a node or port name, values of other types are skipped
+ */
+bool GraphJsonReader::readName(QString *name)
+{
+    char c;
+    if (nextChar(&c) && c == '"')
+        return readString(name, true);
+    name->clear();
+    return skipValue();
+}
+
+bool GraphJsonReader::readNumber(double *number)
+{
+    char c;
+    if (!nextChar(&c))
+        return setError(tr("Unexpected end of data, number expected"));
+
+    m_scratch.resize(0);
+    while (m_pos < m_buffer.size() || fill()) {
+        c = m_buffer.at(m_pos);
+        if (!isNumberChar(c))
+            break;
+        m_scratch.append(c);
+        ++m_pos;
+    }
+    bool ok = false;
+    *number = m_scratch.toDouble(&ok);
+    if (!ok)
+        return setError(tr("Invalid number"));
+    return true;
+}
+
+bool GraphJsonReader::readLiteral(const char *literal)
+{
+    for (const char *l = literal; *l; ++l) {
+        char c;
+        if (!getChar(&c) || c != *l)
+            return setError(tr("Invalid literal, '%1' expected").arg(QLatin1String(literal)));
+    }
+    return true;
+}
+
+/**
+ * @brief GraphJsonReader::readScalar reads a value the same way the JSON loader always did:
+ * numbers are doubles, strings holding an integer are integers
+ * Objects and arrays are skipped and give an invalid value
+ */
+bool GraphJsonReader::readScalar(QVariant *value)
+{
+    char c;
+    if (!nextChar(&c))
+        return setError(tr("Unexpected end of data, value expected"));
+
+    switch (c) {
+    case '"': {
+        QString str;
+        if (!readString(&str, false))
+            return false;
+        bool ok = false;
+        const int intValue = str.toInt(&ok);
+        if (ok)
+            *value = intValue;
+        else
+            *value = str;
+        return true;
+    }
+    case 't':
+        *value = true;
+        return readLiteral("true");
+    case 'f':
+        *value = false;
+        return readLiteral("false");
+    case 'n':
+        *value = QVariant();
+        return readLiteral("null");
+    case '{':
+    case '[':
+        *value = QVariant();
+        return skipValue();
+    default: {
+        double number;
+        if (!readNumber(&number))
+            return false;
+        *value = number;
+        return true;
+    }
+    }
+}
+
+bool GraphJsonReader::skipValue(int depth)
+{
+    if (depth > MaxDepth)
+        return setError(tr("Document is nested too deeply"));
+
+    char c;
+    if (!nextChar(&c))
+        return setError(tr("Unexpected end of data, value expected"));
+
+    bool first = true;
+    switch (c) {
+    case '{': {
+        ++m_pos;
+        int key;
+        for (;;) {
+            const Next next = nextMember(&first, &key);
+            if (next == EndOfContainer)
+                return true;
+            if (next == ParseError || !skipValue(depth + 1))
+                return false;
+        }
+    }
+    case '[': {
+        ++m_pos;
+        for (;;) {
+            const Next next = nextElement(&first);
+            if (next == EndOfContainer)
+                return true;
+            if (next == ParseError || !skipValue(depth + 1))
+                return false;
+        }
+    }
+    case '"':
+        return readRawString(&m_scratch);
+    case 't':
+        return readLiteral("true");
+    case 'f':
+        return readLiteral("false");
+    case 'n':
+        return readLiteral("null");
+    default: {
+        double number;
+        return readNumber(&number);
+    }
+    }
+}
+
+bool GraphJsonReader::readScene(GraphData *data)
+{
+    if (!expect('{'))
+        return false;
+
+    bool first = true;
+    int key;
+    for (;;) {
+        const Next next = nextMember(&first, &key);
+        if (next == EndOfContainer)
+            return true;
+        if (next == ParseError)
+            return false;
+
+        switch (key) {
+        case GraphCore::ZoomFactor: {
+            QVariant zoomFactor;
+            if (!readScalar(&zoomFactor))
+                return false;
+            data->zoomFactor = zoomFactor.isValid() ? zoomFactor.toDouble() : 1.0;
+            break;
+        }
+        case GraphCore::Nodes:
+        case GraphCore::Connections: {
+            char c;
+            if (nextChar(&c) && c != '[') {
+                if (!skipValue())
+                    return false;
+                break;
+            }
+            if (!expect('['))
+                return false;
+            bool firstElement = true;
+            for (;;) {
+                const Next element = nextElement(&firstElement);
+                if (element == EndOfContainer)
+                    break;
+                if (element == ParseError)
+                    return false;
+                if (!nextChar(&c))
+                    return setError(tr("Unexpected end of data in an array"));
+                if (c != '{') {
+                    qWarning() << (key == GraphCore::Nodes ? "Node is not a JSON object" : "Connection is not a JSON object");
+                    if (!skipValue())
+                        return false;
+                    continue;
+                }
+                if (key == GraphCore::Nodes) {
+                    data->nodes.append(GraphNodeData());
+                    if (!readNode(&data->nodes.last()))
+                        return false;
+                } else {
+                    data->connections.append(GraphConnectionData());
+                    if (!readConnection(&data->connections.last()))
+                        return false;
+                }
+                if (!checkCancel())
+                    return false;
+            }
+            break;
+        }
+        default:
+            if (!skipValue())
+                return false;
+            break;
+        }
+    }
+}
+
+bool GraphJsonReader::readNode(GraphNodeData *node)
+{
+    if (!expect('{'))
+        return false;
+
+    bool first = true;
+    int key;
+    for (;;) {
+        const Next next = nextMember(&first, &key);
+        if (next == EndOfContainer)
+            return true;
+        if (next == ParseError)
+            return false;
+
+        QVariant value;
+        switch (key) {
+        case GraphCore::Name:
+            if (!readName(&node->name))
+                return false;
+            break;
+        case GraphCore::XCoord:
+            if (!readScalar(&value))
+                return false;
+            node->coord.setX(value.toDouble());
+            break;
+        case GraphCore::YCoord:
+            if (!readScalar(&value))
+                return false;
+            node->coord.setY(value.toDouble());
+            break;
+        case GraphCore::Ports: {
+            char c;
+            if (nextChar(&c) && c != '[') {
+                if (!skipValue())
+                    return false;
+                break;
+            }
+            if (!expect('['))
+                return false;
+            bool firstElement = true;
+            for (;;) {
+                const Next element = nextElement(&firstElement);
+                if (element == EndOfContainer)
+                    break;
+                if (element == ParseError)
+                    return false;
+                if (!nextChar(&c))
+                    return setError(tr("Unexpected end of data in an array"));
+                if (c != '{') {
+                    if (!skipValue())
+                        return false;
+                    continue;
+                }
+                node->ports.append(GraphPortData());
+                if (!readPort(&node->ports.last()))
+                    return false;
+            }
+            break;
+        }
+        default:
+            if (!skipValue())
+                return false;
+            break;
+        }
+    }
+}
+
+bool GraphJsonReader::readPort(GraphPortData *port)
+{
+    if (!expect('{'))
+        return false;
+
+    port->portType = GraphNodePort::OutputPort;
+    bool first = true;
+    int key;
+    for (;;) {
+        const Next next = nextMember(&first, &key);
+        if (next == EndOfContainer) {
+            // kept as read, GraphCore::setGraphData() loads unknown types as inputs
+            if (!GraphStore::isPortType(port->portType))
+                qWarning() << "Port" << port->name << "has the unknown type" << port->portType;
+            return true;
+        }
+        if (next == ParseError)
+            return false;
+
+        switch (key) {
+        case GraphCore::Name:
+            if (!readName(&port->name))
+                return false;
+            break;
+        case GraphCore::Type: {
+            QVariant type;
+            if (!readScalar(&type))
+                return false;
+            port->portType = type.toInt();
+            break;
+        }
+        case GraphCore::Value:
+            if (!readScalar(&port->value))
+                return false;
+            break;
+        default:
+            if (!skipValue())
+                return false;
+            break;
+        }
+    }
+}
+
+bool GraphJsonReader::readConnection(GraphConnectionData *conn)
+{
+    if (!expect('{'))
+        return false;
+
+    bool first = true;
+    int key;
+    for (;;) {
+        const Next next = nextMember(&first, &key);
+        if (next == EndOfContainer)
+            return true;
+        if (next == ParseError)
+            return false;
+
+        bool ok = true;
+        switch (key) {
+        case GraphCore::Source:
+            ok = readName(&conn->sourceNode);
+            break;
+        case GraphCore::Output:
+            ok = readName(&conn->outputPort);
+            break;
+        case GraphCore::Target:
+            ok = readName(&conn->targetNode);
+            break;
+        case GraphCore::Input:
+            ok = readName(&conn->inputPort);
+            break;
+        default:
+            ok = skipValue();
+            break;
+        }
+        if (!ok)
+            return false;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "graphdata.h"
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QHash>
+
+#include <functional>
+
+class QIODevice;
+
+class GraphJsonReader
+{
+    Q_DECLARE_TR_FUNCTIONS(GraphJsonReader)
+
+public:
+    typedef std::function<void(qint64 bytesRead, qint64 bytesTotal)> ProgressHandler;
+
+    explicit GraphJsonReader(QIODevice *device);
+
+    void setProgressHandler(const ProgressHandler &handler);
+    void setCancelFlag(const QAtomicInt *cancelFlag);
+
+    bool read(GraphData *data);
+    inline bool isCancelled() const { return m_cancelled; }
+    inline QString errorString() const { return m_errorString; }
+
+private:
+    enum Next { NextItem, EndOfContainer, ParseError };
+
+    bool fill();
+    bool nextChar(char *c);
+    bool getChar(char *c);
+    bool expect(char c);
+    bool checkCancel();
+    bool setError(const QString &error);
+
+    Next nextMember(bool *first, int *key);
+    Next nextElement(bool *first);
+
+    bool readRawString(QByteArray *utf8);
+    bool readHex(uint *codeUnit);
+    bool readString(QString *str, bool intern);
+    bool readName(QString *name);
+    bool readNumber(double *number);
+    bool readLiteral(const char *literal);
+    bool readScalar(QVariant *value);
+    bool skipValue(int depth = 0);
+
+    bool readScene(GraphData *data);
+    bool readNode(GraphNodeData *node);
+    bool readPort(GraphPortData *port);
+    bool readConnection(GraphConnectionData *conn);
+
+    QIODevice *m_device;
+    ProgressHandler m_progressHandler;
+    const QAtomicInt *m_cancelFlag = nullptr;
+    QByteArray m_buffer;
+    int m_pos = 0;
+    qint64 m_bytesRead = 0;
+    qint64 m_bytesTotal = 0;
+    bool m_eof = false;
+    bool m_cancelled = false;
+    QString m_errorString;
+    QByteArray m_scratch;
+    QHash<QByteArray, int> m_keys;
+    // decoded names, so that repeated node and port names share one QString
+    QHash<QByteArray, QString> m_strings;
+};
@@ -0,0 +1,593 @@
+#include "graphlayout.h"
+#include "graphprofiler.h"
+
+#include <QPair>
+#include <QVarLengthArray>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief The GraphLayout class computes positions for all nodes of a graph
+ *
+ * The layouts work on a snapshot of the graph and return the new top-left corners of the
+ * nodes in the order of the snapshot, so they can run on a worker thread while the graph
+ * stays interactive. Both use the global thread pool for the work that is independent
+ * per node, and both check the cancel flag between their passes.
+ *
+ * layered() arranges the nodes in columns following the connections, Sugiyama style:
+ * cycles are broken by reversing the back edges of a depth-first search, nodes are put in
+ * the column after their furthest predecessor and the columns are sorted by the barycenter
+ * of their neighbours in a few sweeps, which removes most crossings. Edges spanning several
+ * columns are not split into dummy nodes, the barycenters take their far ends as they are.
+ * Connected components are laid out as horizontal bands, largest first.
+ *
+ * forceDirected() moves the nodes under repulsion between all of them and attraction
+ * along the connections, Fruchterman-Reingold style with a cooling step width. The
+ * repulsion is approximated with a Barnes-Hut quadtree, so a step costs O(n log n).
+ */
+
+namespace {
+
+// golden angle, spreads points evenly on a spiral
+const double GoldenAngle = 2.39996322972865332;
+
+// compressed rows of the edges leaving every node, entries are edge indices
+struct Adjacency
+{
+    QVector<int> offsets;
+    QVector<int> edges;
+};
+
+Adjacency buildAdjacency(int nodeCount, const QVector<int> &edgeSources)
+{
+    Adjacency adjacency;
+    adjacency.offsets.fill(0, nodeCount + 1);
+    for (int node : edgeSources)
+        ++adjacency.offsets[node + 1];
+    for (int node = 0; node < nodeCount; ++node)
+        adjacency.offsets[node + 1] += adjacency.offsets.at(node);
+    adjacency.edges.resize(edgeSources.size());
+    QVector<int> cursors = adjacency.offsets;
+    for (int edge = 0; edge < edgeSources.size(); ++edge)
+        adjacency.edges[cursors[edgeSources.at(edge)]++] = edge;
+    return adjacency;
+}
+
+inline bool isCancelled(const QAtomicInt *cancelFlag)
+{
+    return cancelFlag && cancelFlag->loadAcquire();
+}
+
+// calls function(begin, end) for ranges of grain items on the global thread pool
+template <typename Function>
+void forEachRange(int count, int grain, const Function &function)
+{
+    if (count <= grain) {
+        if (count > 0)
+            function(0, count);
+        return;
+    }
+    QVector<int> begins;
+    for (int begin = 0; begin < count; begin += grain)
+        begins.append(begin);
+    QtConcurrent::blockingMap(begins, [&function, count, grain](int begin) {
+        function(begin, qMin(count, begin + grain));
+    });
+}
+
+int findRoot(QVector<int> &parents, int node)
+{
+    while (parents.at(node) != node) {
+        parents[node] = parents.at(parents.at(node));
+        node = parents.at(node);
+    }
+    return node;
+}
+
+void moveToOrigin(QVector<QPointF> *coords)
+{
+    if (coords->isEmpty())
+        return;
+    QPointF topLeft = coords->at(0);
+    for (const QPointF &coord : qAsConst(*coords)) {
+        topLeft.setX(qMin(topLeft.x(), coord.x()));
+        topLeft.setY(qMin(topLeft.y(), coord.y()));
+    }
+    for (QPointF &coord : *coords)
+        coord -= topLeft;
+}
+
+struct QuadCell
+{
+    double x0;
+    double y0;
+    double size;
+    double mass;
+    double cx;
+    double cy;
+    int firstChild;     // the four children are stored one after the other, -1 for leaves
+    int firstBody;      // bodies of a leaf chained through nextBody, -1 for empty leaves
+};
+
+// Barnes-Hut quadtree over points, rebuilt for every step of the force-directed layout
+class BarnesHutTree
+{
+public:
+    // points closer than this share a leaf instead of splitting further
+    static const int MaxDepth = 40;
+
+    void build(const double *xs, const double *ys, int count)
+    {
+        m_cells.clear();
+        m_nextBody.fill(-1, count);
+        double left = xs[0], top = ys[0], right = xs[0], bottom = ys[0];
+        for (int i = 1; i < count; ++i) {
+            left = qMin(left, xs[i]);
+            right = qMax(right, xs[i]);
+            top = qMin(top, ys[i]);
+            bottom = qMax(bottom, ys[i]);
+        }
+        appendCell(left, top, qMax(right - left, bottom - top) + 1.0);
+
+        for (int body = 0; body < count; ++body) {
+            int cell = 0;
+            for (int depth = 0; ; ++depth) {
+                if (m_cells.at(cell).firstChild >= 0) {
+                    cell = m_cells.at(cell).firstChild + quadrant(m_cells.at(cell), xs[body], ys[body]);
+                    continue;
+                }
+                if (m_cells.at(cell).firstBody < 0 || depth >= MaxDepth) {
+                    m_nextBody[body] = m_cells.at(cell).firstBody;
+                    m_cells[cell].firstBody = body;
+                    break;
+                }
+                // a leaf above the maximum depth holds one body, it moves into a child
+                const int resident = m_cells.at(cell).firstBody;
+                split(cell);
+                const int child = m_cells.at(cell).firstChild + quadrant(m_cells.at(cell), xs[resident], ys[resident]);
+                m_cells[child].firstBody = resident;
+            }
+        }
+
+        // children are created after their parents, so a backward pass sees them first
+        for (int cell = m_cells.size() - 1; cell >= 0; --cell) {
+            QuadCell &quadCell = m_cells[cell];
+            double mass = 0.0, cx = 0.0, cy = 0.0;
+            if (quadCell.firstChild < 0) {
+                for (int body = quadCell.firstBody; body >= 0; body = m_nextBody.at(body)) {
+                    mass += 1.0;
+                    cx += xs[body];
+                    cy += ys[body];
+                }
+            } else {
+                for (int q = 0; q < 4; ++q) {
+                    const QuadCell &child = m_cells.at(quadCell.firstChild + q);
+                    mass += child.mass;
+                    cx += child.cx * child.mass;
+                    cy += child.cy * child.mass;
+                }
+            }
+            quadCell.mass = mass;
+            quadCell.cx = mass > 0.0 ? cx / mass : 0.0;
+            quadCell.cy = mass > 0.0 ? cy / mass : 0.0;
+        }
+    }
+
+    // adds the repulsion of all other points on a point, strength k2 / distance
+    void repulsion(int body, const double *xs, const double *ys, double k2, double theta2, double *fx, double *fy) const
+    {
+        QVarLengthArray<int, 128> stack;
+        stack.append(0);
+        while (!stack.isEmpty()) {
+            const QuadCell &cell = m_cells.at(stack.last());
+            stack.removeLast();
+            if (cell.mass == 0.0)
+                continue;
+            if (cell.firstChild < 0) {
+                for (int other = cell.firstBody; other >= 0; other = m_nextBody.at(other)) {
+                    if (other != body)
+                        push(body, xs[body] - xs[other], ys[body] - ys[other], 1.0, k2, fx, fy);
+                }
+                continue;
+            }
+            const double dx = xs[body] - cell.cx;
+            const double dy = ys[body] - cell.cy;
+            const double d2 = dx * dx + dy * dy;
+            if (cell.size * cell.size < theta2 * d2) {
+                push(body, dx, dy, cell.mass, k2, fx, fy);
+                continue;
+            }
+            for (int q = 0; q < 4; ++q)
+                stack.append(cell.firstChild + q);
+        }
+    }
+
+private:
+    static inline int quadrant(const QuadCell &cell, double x, double y)
+    {
+        const double half = cell.size / 2;
+        return (x >= cell.x0 + half ? 1 : 0) | (y >= cell.y0 + half ? 2 : 0);
+    }
+
+    static inline void push(int body, double dx, double dy, double mass, double k2, double *fx, double *fy)
+    {
+        double d2 = dx * dx + dy * dy;
+        if (d2 < 1.0) {
+            // coinciding points get pushed apart in a direction of their own
+            dx = std::cos(body * GoldenAngle);
+            dy = std::sin(body * GoldenAngle);
+            d2 = 1.0;
+        }
+        const double force = k2 * mass / d2;
+        *fx += dx * force;
+        *fy += dy * force;
+    }
+
+    void appendCell(double x0, double y0, double size)
+    {
+        QuadCell cell;
+        cell.x0 = x0;
+        cell.y0 = y0;
+        cell.size = size;
+        cell.mass = 0.0;
+        cell.cx = 0.0;
+        cell.cy = 0.0;
+        cell.firstChild = -1;
+        cell.firstBody = -1;
+        m_cells.append(cell);
+    }
+
+    void split(int cell)
+    {
+        const double x0 = m_cells.at(cell).x0;
+        const double y0 = m_cells.at(cell).y0;
+        const double half = m_cells.at(cell).size / 2;
+        m_cells[cell].firstChild = m_cells.size();
+        m_cells[cell].firstBody = -1;
+        for (int q = 0; q < 4; ++q)
+            appendCell(x0 + (q & 1) * half, y0 + (q >> 1) * half, half);
+    }
+
+    QVector<QuadCell> m_cells;
+    QVector<int> m_nextBody;
+};
+
+} // namespace
+
+/**
+ * @brief GraphLayout::snapshot copies the nodes and connections a layout needs
+ * @param store the graph
+ */
+GraphLayout::Input GraphLayout::snapshot(const GraphStore &store)
+{
+    Input input;
+    input.nodeIds.reserve(store.nodeCount());
+    input.nodeNameIds.reserve(store.nodeCount());
+    input.coords.reserve(store.nodeCount());
+    QVector<int> indices(store.nodeCapacity(), -1);
+    for (int nodeId = 0; nodeId < store.nodeCapacity(); ++nodeId) {
+        if (!store.isNode(nodeId))
+            continue;
+        indices[nodeId] = input.nodeIds.size();
+        input.nodeIds.append(nodeId);
+        input.nodeNameIds.append(store.nodeNameId(nodeId));
+        input.coords.append(store.nodeCoord(nodeId));
+    }
+
+    input.edgeSources.reserve(store.connectionCount());
+    input.edgeTargets.reserve(store.connectionCount());
+    for (int connectionId = 0; connectionId < store.connectionCapacity(); ++connectionId) {
+        if (!store.isConnection(connectionId))
+            continue;
+        input.edgeSources.append(indices.at(store.portNode(store.connectionOutput(connectionId))));
+        input.edgeTargets.append(indices.at(store.portNode(store.connectionInput(connectionId))));
+    }
+    return input;
+}
+
+/**
+ * @brief GraphLayout::run computes a layout with the given algorithm
+ * @param algorithm layout algorithm
+ * @param input snapshot of the graph
+ * @param cancelFlag stops the layout when set, may be null
+ * @param frameHandler receives intermediate positions, may be empty
+ * @return the positions in the order of the snapshot, empty if cancelled
+ */
+QVector<QPointF> GraphLayout::run(Algorithm algorithm, const Input &input, const QAtomicInt *cancelFlag,
+                                  const FrameHandler &frameHandler)
+{
+    switch (algorithm) {
+    case LayeredLayout:
+        return layered(input, cancelFlag);
+    case ForceDirectedLayout:
+        return forceDirected(input, cancelFlag, frameHandler);
+    }
+    return QVector<QPointF>();
+}
+
+/**
+ * @brief GraphLayout::layered arranges the nodes in columns following the connections
+ * @param input snapshot of the graph
+ * @param cancelFlag stops the layout when set, may be null
+ * @return the positions in the order of the snapshot, empty if cancelled
+ */
+QVector<QPointF> GraphLayout::layered(const Input &input, const QAtomicInt *cancelFlag)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphLayout::layered");
+    static const int Sweeps = 4;
+    static const int Grain = 4096;
+    const int nodeCount = input.nodeIds.size();
+    const int edgeCount = input.edgeSources.size();
+
+    // reverse the edges leading back onto the stack of a depth-first search, which leaves a DAG
+    const Adjacency outgoing = buildAdjacency(nodeCount, input.edgeSources);
+    QVector<bool> reversed(edgeCount, false);
+    QVector<char> states(nodeCount, 0);     // 0 unvisited, 1 on the stack, 2 done
+    QVector<QPair<int, int>> stack;         // node and its next outgoing edge
+    for (int root = 0; root < nodeCount; ++root) {
+        if (states.at(root) != 0)
+            continue;
+        states[root] = 1;
+        stack.append(qMakePair(root, outgoing.offsets.at(root)));
+        while (!stack.isEmpty()) {
+            const int node = stack.last().first;
+            const int cursor = stack.last().second;
+            if (cursor == outgoing.offsets.at(node + 1)) {
+                states[node] = 2;
+                stack.removeLast();
+                continue;
+            }
+            ++stack.last().second;
+            const int edge = outgoing.edges.at(cursor);
+            const int target = input.edgeTargets.at(edge);
+            if (states.at(target) == 1) {
+                reversed[edge] = true;
+            } else if (states.at(target) == 0) {
+                states[target] = 1;
+                stack.append(qMakePair(target, outgoing.offsets.at(target)));
+            }
+        }
+    }
+    if (isCancelled(cancelFlag))
+        return QVector<QPointF>();
+
+    QVector<int> from(edgeCount);
+    QVector<int> to(edgeCount);
+    for (int edge = 0; edge < edgeCount; ++edge) {
+        from[edge] = reversed.at(edge) ? input.edgeTargets.at(edge) : input.edgeSources.at(edge);
+        to[edge] = reversed.at(edge) ? input.edgeSources.at(edge) : input.edgeTargets.at(edge);
+    }
+    const Adjacency successors = buildAdjacency(nodeCount, from);
+    const Adjacency predecessors = buildAdjacency(nodeCount, to);
+
+    // longest path layering
+    QVector<int> inDegree(nodeCount, 0);
+    for (int node : qAsConst(to))
+        ++inDegree[node];
+    QVector<int> layers(nodeCount, 0);
+    QVector<int> queue;
+    queue.reserve(nodeCount);
+    for (int node = 0; node < nodeCount; ++node) {
+        if (inDegree.at(node) == 0)
+            queue.append(node);
+    }
+    int layerCount = nodeCount > 0 ? 1 : 0;
+    for (int i = 0; i < queue.size(); ++i) {
+        const int node = queue.at(i);
+        for (int e = successors.offsets.at(node); e < successors.offsets.at(node + 1); ++e) {
+            const int target = to.at(successors.edges.at(e));
+            layers[target] = qMax(layers.at(target), layers.at(node) + 1);
+            layerCount = qMax(layerCount, layers.at(target) + 1);
+            if (--inDegree[target] == 0)
+                queue.append(target);
+        }
+    }
+
+    // connected components, numbered by decreasing size
+    QVector<int> parents(nodeCount);
+    for (int node = 0; node < nodeCount; ++node)
+        parents[node] = node;
+    for (int edge = 0; edge < edgeCount; ++edge) {
+        const int a = findRoot(parents, from.at(edge));
+        const int b = findRoot(parents, to.at(edge));
+        if (a != b)
+            parents[qMax(a, b)] = qMin(a, b);
+    }
+    QVector<int> componentSizes(nodeCount, 0);
+    for (int node = 0; node < nodeCount; ++node)
+        ++componentSizes[findRoot(parents, node)];
+    QVector<int> roots;
+    for (int node = 0; node < nodeCount; ++node) {
+        if (componentSizes.at(node) > 0)
+            roots.append(node);
+    }
+    std::stable_sort(roots.begin(), roots.end(), [&componentSizes](int a, int b) {
+        return componentSizes.at(a) > componentSizes.at(b);
+    });
+    QVector<int> rootComponents(nodeCount, 0);
+    for (int i = 0; i < roots.size(); ++i)
+        rootComponents[roots.at(i)] = i;
+    QVector<int> components(nodeCount);
+    for (int node = 0; node < nodeCount; ++node)
+        components[node] = rootComponents.at(findRoot(parents, node));
+
+    // columns grouped by component, positions count within the group
+    QVector<QVector<int>> layerNodes(layerCount);
+    for (int node = 0; node < nodeCount; ++node)
+        layerNodes[layers.at(node)].append(node);
+    QVector<double> positions(nodeCount, 0.0);
+    QVector<double> barycenters(nodeCount, 0.0);
+    const auto sortLayer = [&](QVector<int> &nodes) {
+        std::stable_sort(nodes.begin(), nodes.end(), [&](int a, int b) {
+            if (components.at(a) != components.at(b))
+                return components.at(a) < components.at(b);
+            return barycenters.at(a) < barycenters.at(b);
+        });
+        for (int i = 0, position = 0; i < nodes.size(); ++i, ++position) {
+            if (i > 0 && components.at(nodes.at(i)) != components.at(nodes.at(i - 1)))
+                position = 0;
+            positions[nodes.at(i)] = position;
+        }
+    };
+    for (QVector<int> &nodes : layerNodes) {
+        for (int node : qAsConst(nodes))
+            barycenters[node] = node;
+        sortLayer(nodes);
+    }
+
+    // barycenter sweeps, downwards over the predecessors and upwards over the successors
+    const auto sweepLayer = [&](QVector<int> &nodes, const Adjacency &adjacency, const QVector<int> &ends) {
+        const int *layer = nodes.constData();
+        const double *position = positions.constData();
+        double *barycenter = barycenters.data();
+        forEachRange(nodes.size(), Grain, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                const int node = layer[i];
+                const int first = adjacency.offsets.at(node);
+                const int last = adjacency.offsets.at(node + 1);
+                if (first == last) {
+                    barycenter[node] = position[node];
+                    continue;
+                }
+                double sum = 0.0;
+                for (int e = first; e < last; ++e)
+                    sum += position[ends.at(adjacency.edges.at(e))];
+                barycenter[node] = sum / (last - first);
+            }
+        });
+        sortLayer(nodes);
+    };
+    for (int sweep = 0; sweep < Sweeps; ++sweep) {
+        if (isCancelled(cancelFlag))
+            return QVector<QPointF>();
+        for (int layer = 1; layer < layerCount; ++layer)
+            sweepLayer(layerNodes[layer], predecessors, from);
+        for (int layer = layerCount - 2; layer >= 0; --layer)
+            sweepLayer(layerNodes[layer], successors, to);
+    }
+
+    // every component gets a band as high as its tallest column, groups are centered in their band
+    QVector<int> groupSizes(nodeCount, 0);
+    QVector<int> bandSizes(roots.size(), 0);
+    for (const QVector<int> &nodes : qAsConst(layerNodes)) {
+        for (int begin = 0, end = 0; begin < nodes.size(); begin = end) {
+            const int component = components.at(nodes.at(begin));
+            for (end = begin; end < nodes.size() && components.at(nodes.at(end)) == component; ++end) {}
+            for (int i = begin; i < end; ++i)
+                groupSizes[nodes.at(i)] = end - begin;
+            bandSizes[component] = qMax(bandSizes.at(component), end - begin);
+        }
+    }
+    const double rowHeight = GraphStore::NodeHeight + NodeSpacing;
+    QVector<double> bandTops(roots.size(), 0.0);
+    for (int component = 1; component < roots.size(); ++component)
+        bandTops[component] = bandTops.at(component - 1) + bandSizes.at(component - 1) * rowHeight + ComponentSpacing;
+
+    QVector<QPointF> coords(nodeCount);
+    for (int node = 0; node < nodeCount; ++node) {
+        const int component = components.at(node);
+        const double row = positions.at(node) + (bandSizes.at(component) - groupSizes.at(node)) / 2.0;
+        coords[node] = QPointF(layers.at(node) * double(GraphStore::NodeWidth + LayerSpacing),
+                               bandTops.at(component) + row * rowHeight);
+    }
+    return coords;
+}
+
+/**
+ * @brief GraphLayout::forceDirected spreads the nodes by simulated forces
+ * Overlapping start positions, e.g. of an imported graph without coordinates, are replaced
+ * by a spiral. Large graphs take fewer steps, so that a layout of 100000 nodes finishes in
+ * seconds; the step count is between MinSteps and MaxSteps
+ * @param input snapshot of the graph
+ * @param cancelFlag stops the layout when set, may be null
+ * @param frameHandler receives the positions every FrameInterval steps, may be empty
+ * @return the positions in the order of the snapshot, empty if cancelled
+ */
+QVector<QPointF> GraphLayout::forceDirected(const Input &input, const QAtomicInt *cancelFlag,
+                                            const FrameHandler &frameHandler)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphLayout::forceDirected");
+    static const int Grain = 1024;
+    static const double Theta = 0.8;
+    const int nodeCount = input.nodeIds.size();
+    if (nodeCount == 0)
+        return QVector<QPointF>();
+
+    const double k = 2.0 * GraphStore::NodeHeight;
+    QVector<double> xs(nodeCount);
+    QVector<double> ys(nodeCount);
+    QRectF bounds(input.coords.at(0), QSizeF(0, 0));
+    for (const QPointF &coord : input.coords)
+        bounds |= QRectF(coord, QSizeF(1, 1));
+    const bool overlapping = bounds.width() * bounds.height() < double(nodeCount) * GraphStore::NodeWidth * GraphStore::NodeHeight;
+    for (int node = 0; node < nodeCount; ++node) {
+        if (overlapping) {
+            const double radius = k * 0.5 * std::sqrt(node + 0.5);
+            xs[node] = radius * std::cos(node * GoldenAngle);
+            ys[node] = radius * std::sin(node * GoldenAngle);
+        } else {
+            xs[node] = input.coords.at(node).x();
+            ys[node] = input.coords.at(node).y();
+        }
+    }
+
+    // both directions of every edge, an entry below edgeCount leads to its target
+    const int edgeCount = input.edgeSources.size();
+    const Adjacency neighbours = buildAdjacency(nodeCount, input.edgeSources + input.edgeTargets);
+    const int *edgeSources = input.edgeSources.constData();
+    const int *edgeTargets = input.edgeTargets.constData();
+
+    const int stepCount = qBound(int(MinSteps), 5000000 / nodeCount, int(MaxSteps));
+    const double startTemperature = qMax(k, k * std::sqrt(double(nodeCount)) / 8);
+    QVector<double> nextXs(nodeCount);
+    QVector<double> nextYs(nodeCount);
+    BarnesHutTree tree;
+    for (int step = 0; step < stepCount; ++step) {
+        if (isCancelled(cancelFlag))
+            return QVector<QPointF>();
+
+        const double *x = xs.constData();
+        const double *y = ys.constData();
+        double *nextX = nextXs.data();
+        double *nextY = nextYs.data();
+        const double temperature = startTemperature * (1.0 - double(step) / stepCount) + k * 0.05;
+        tree.build(x, y, nodeCount);
+        forEachRange(nodeCount, Grain, [&](int begin, int end) {
+            for (int node = begin; node < end; ++node) {
+                double fx = 0.0, fy = 0.0;
+                tree.repulsion(node, x, y, k * k, Theta * Theta, &fx, &fy);
+                for (int e = neighbours.offsets.at(node); e < neighbours.offsets.at(node + 1); ++e) {
+                    const int edge = neighbours.edges.at(e);
+                    const int other = edge < edgeCount ? edgeTargets[edge] : edgeSources[edge - edgeCount];
+                    const double dx = x[other] - x[node];
+                    const double dy = y[other] - y[node];
+                    const double distance = std::sqrt(dx * dx + dy * dy);
+                    fx += dx * distance / k;
+                    fy += dy * distance / k;
+                }
+                const double length = std::sqrt(fx * fx + fy * fy);
+                const double scale = length > 0.0 ? qMin(length, temperature) / length : 0.0;
+                nextX[node] = x[node] + fx * scale;
+                nextY[node] = y[node] + fy * scale;
+            }
+        });
+        xs.swap(nextXs);
+        ys.swap(nextYs);
+
+        if (frameHandler && (step + 1) % FrameInterval == 0 && step + 1 < stepCount) {
+            QVector<QPointF> coords(nodeCount);
+            for (int node = 0; node < nodeCount; ++node)
+                coords[node] = QPointF(xs.at(node), ys.at(node));
+            moveToOrigin(&coords);
+            frameHandler(coords, step + 1, stepCount);
+        }
+    }
+
+    QVector<QPointF> coords(nodeCount);
+    for (int node = 0; node < nodeCount; ++node)
+        coords[node] = QPointF(xs.at(node), ys.at(node));
+    moveToOrigin(&coords);
+    return coords;
+}
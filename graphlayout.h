@@ -0,0 +1,48 @@
+#pragma once
+
+#include "graphstore.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QPointF>
+#include <QVector>
+
+#include <functional>
+
+class GraphLayout
+{
+    Q_DECLARE_TR_FUNCTIONS(GraphLayout)
+
+public:
+    enum Algorithm { LayeredLayout, ForceDirectedLayout };
+
+    // gaps between the node rectangles of the layered layout
+    static const int LayerSpacing = 150;
+    static const int NodeSpacing = 50;
+    static const int ComponentSpacing = 300;
+    // the force-directed layout stops early for large graphs, see forceDirected()
+    static const int MinSteps = 50;
+    static const int MaxSteps = 300;
+    static const int FrameInterval = 10;
+
+    // copy of the graph taken on the GUI thread, so that a layout can run without touching the store
+    struct Input
+    {
+        QVector<int> nodeIds;
+        QVector<int> nodeNameIds;   // recognises nodes replaced while the layout was running
+        QVector<QPointF> coords;
+        // node indices of the ends of every connection
+        QVector<int> edgeSources;
+        QVector<int> edgeTargets;
+    };
+
+    // receives the positions of all nodes every few steps, called on the thread running the layout
+    typedef std::function<void(const QVector<QPointF> &coords, int step, int stepCount)> FrameHandler;
+
+    static Input snapshot(const GraphStore &store);
+    static QVector<QPointF> run(Algorithm algorithm, const Input &input, const QAtomicInt *cancelFlag,
+                                const FrameHandler &frameHandler);
+    static QVector<QPointF> layered(const Input &input, const QAtomicInt *cancelFlag);
+    static QVector<QPointF> forceDirected(const Input &input, const QAtomicInt *cancelFlag,
+                                          const FrameHandler &frameHandler);
+};
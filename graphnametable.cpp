@@ -0,0 +1,32 @@
+#include "graphnametable.h"
+
+/**
+ * @brief The GraphNameTable class interns the names of nodes and ports
+ * Every distinct name is stored once and gets a stable integer id, so the store
+ * compares and indexes names as integers. Ids are never reused until clear().
+ */
+
+/**
+ * @brief GraphNameTable::intern returns the id of a name, adding the name if it is new
+ * @param name a name
+ */
+int GraphNameTable::intern(const QString &name)
+{
+    const auto it = m_ids.constFind(name);
+    if (it != m_ids.constEnd())
+        return *it;
+
+    const int nameId = m_names.size();
+    m_names.append(name);
+    m_ids.insert(name, nameId);
+    return nameId;
+}
+
+/**
+ * @brief GraphNameTable::clear forgets all names, ids start from zero again
+ */
+void GraphNameTable::clear()
+{
+    m_names.clear();
+    m_ids.clear();
+}
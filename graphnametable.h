@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+class GraphNameTable
+{
+public:
+    static const int InvalidId = -1;
+
+    inline int count() const { return m_names.size(); }
+    inline const QString &name(int nameId) const { return m_names.at(nameId); }
+    inline int find(const QString &name) const { return m_ids.value(name, InvalidId); }
+
+    int intern(const QString &name);
+    void clear();
+
+private:
+    QVector<QString> m_names;
+    QHash<QString, int> m_ids;
+};
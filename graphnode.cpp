@@ -2,75 +2,176 @@
 
 #include "graphcore.h"
 #include "graphnodeport.h"
+#include "graphportmodel.h"
 
-GraphNode::GraphNode(const QPointF &coord, const QString &name, GraphCore *graphCore)
-    : GraphGenericObject(name, graphCore), m_coord(coord)
+/**
+ * @brief The GraphNode class is the QObject facade of a node of the GraphStore
+ * Its port models are filled when the facade is created and follow the ports of the node
+ */
+
+/**
+ * @brief GraphNode::GraphNode ctor, facades are created by GraphCore::nodeObject()
+ * @param nodeId node handle
+ * @param graphCore the graph
+ */
+GraphNode::GraphNode(int nodeId, GraphCore *graphCore)
+    : GraphGenericObject(nodeId, graphCore)
+    , m_outputPortModel(new GraphPortModel(this))
+    , m_inputPortModel(new GraphPortModel(this))
+{
+    loadPortObjects();
+}
+
+QString GraphNode::name() const
+{
+    return isValid() ? store().nodeName(m_id) : QString();
+}
+
+QColor GraphNode::color() const
+{
+    return QColor();
+}
+
+/**
+ * @brief GraphNode::attach binds a recycled facade to another node
+ * @param nodeId node handle
+ */
+void GraphNode::attach(int nodeId)
+{
+    GraphGenericObject::attach(nodeId);
+    loadPortObjects();
+    emit coordChanged();
+}
+
+/**
+ * @brief GraphNode::detach unbinds the facade and empties its port models,
+ * the port facades are recycled together with the node
+ */
+void GraphNode::detach()
 {
+    GraphGenericObject::detach();
+    m_outputPortModel->clearPorts();
+    m_inputPortModel->clearPorts();
+    emit outputPortsChanged();
+    emit inputPortsChanged();
 }
 
-GraphCore *GraphNode::graphCore() const
+QPointF GraphNode::coord() const
 {
-    return static_cast<GraphCore *>(parent());
+    return isValid() ? store().nodeCoord(m_id) : QPointF();
+}
+
+QObjectList GraphNode::outputPorts() const
+{
+    return ports(GraphStore::OutputPort);
+}
+
+QObjectList GraphNode::inputPorts() const
+{
+    return ports(GraphStore::InputPort);
+}
+
+void GraphNode::setXCoord(double xCoord)
+{
+    if (isValid())
+        m_graphCore->setNodeCoord(m_id, QPointF(xCoord, yCoord()));
+}
+
+void GraphNode::setYCoord(double yCoord)
+{
+    if (isValid())
+        m_graphCore->setNodeCoord(m_id, QPointF(xCoord(), yCoord));
 }
 
 GraphNodePort *GraphNode::outputPort(const QString &portName) const
 {
-    return qobject_cast<GraphNodePort *>(m_outputPorts.value(portName));
+    return port(GraphStore::OutputPort, portName);
 }
 
 bool GraphNode::addOutputPort(const QString &portName, const QVariant &value)
 {
-    if (m_outputPorts.contains(portName)) {
-        emit errorOccurred(tr("Output port '%1' already exists").arg(portName));
-        return false;
-    }
-    GraphNodePort *port = new GraphNodePort(GraphNodePort::OutputPort, value, portName, this);
-    m_outputPorts[portName] = port;
-    emit outputPortsChanged();
-    return true;
+    return isValid() && m_graphCore->addPort(m_id, GraphStore::OutputPort, portName, value) != GraphStore::InvalidId;
 }
 
 bool GraphNode::removeOutputPort(const QString &portName)
 {
-    auto it = m_outputPorts.find(portName);
-    if (it == m_outputPorts.end()) {
-        emit errorOccurred(tr("Output port '%1' does not exist").arg(portName));
-        return false;
-    }
-    QObject *obj = it.value();
-    m_outputPorts.erase(it);
-    emit outputPortsChanged();
-    obj->deleteLater();
-    return true;
+    return isValid() && m_graphCore->removePort(m_id, GraphStore::OutputPort, portName);
 }
 
 GraphNodePort *GraphNode::inputPort(const QString &portName) const
 {
-    return qobject_cast<GraphNodePort *>(m_inputPorts.value(portName));
+    return port(GraphStore::InputPort, portName);
 }
 
 bool GraphNode::addInputPort(const QString &portName, const QVariant &value)
 {
-    if (m_inputPorts.contains(portName)) {
-        emit errorOccurred(tr("Input port '%1' already exists").arg(portName));
-        return false;
-    }
-    GraphNodePort *port = new GraphNodePort(GraphNodePort::InputPort, value, portName, this);
-    m_inputPorts[portName] = port;
-    emit inputPortsChanged();
-    return true;
+    return isValid() && m_graphCore->addPort(m_id, GraphStore::InputPort, portName, value) != GraphStore::InvalidId;
 }
 
 bool GraphNode::removeInputPort(const QString &portName)
 {
-    auto it = m_inputPorts.find(portName);
-    if (it == m_inputPorts.end()) {
-        emit errorOccurred(tr("Input port '%1' does not exist").arg(portName));
-        return false;
+    return isValid() && m_graphCore->removePort(m_id, GraphStore::InputPort, portName);
+}
+
+/**
+ * @brief GraphNode::ports returns the facades of the ports of one direction, ordered by index
+ */
+QObjectList GraphNode::ports(GraphStore::PortType portType) const
+{
+    QObjectList result;
+    if (!isValid())
+        return result;
+
+    for (int portId : store().nodePorts(m_id, portType))
+        result.append(m_graphCore->portObject(portId));
+    return result;
+}
+
+GraphNodePort *GraphNode::port(GraphStore::PortType portType, const QString &portName) const
+{
+    if (!isValid())
+        return nullptr;
+
+    const int portId = store().findPort(m_id, portType, portName);
+    return portId != GraphStore::InvalidId ? m_graphCore->portObject(portId) : nullptr;
+}
+
+/**
+ * @brief GraphNode::appendPortObject adds a port of this node to the port model of its direction
+ * @param port port facade
+ */
+void GraphNode::appendPortObject(GraphNodePort *port)
+{
+    if (port->portType() == GraphNodePort::OutputPort) {
+        m_outputPortModel->appendPort(port);
+        emit outputPortsChanged();
+    } else {
+        m_inputPortModel->appendPort(port);
+        emit inputPortsChanged();
     }
-    QObject *obj = it.value();
-    m_inputPorts.erase(it);
-    emit inputPortsChanged();
-    obj->deleteLater();
-    return true;
+}
+
+/**
+ * @brief GraphNode::removePortObject removes a port of this node from its port model
+ * @param port port facade
+ */
+void GraphNode::removePortObject(GraphNodePort *port)
+{
+    if (m_outputPortModel->removePort(port))
+        emit outputPortsChanged();
+    else if (m_inputPortModel->removePort(port))
+        emit inputPortsChanged();
+}
+
+/**
+ * @brief GraphNode::loadPortObjects fills the port models with the current ports of the node
+ */
+void GraphNode::loadPortObjects()
+{
+    m_outputPortModel->beginBatch();
+    m_inputPortModel->beginBatch();
+    for (int portId : store().nodePorts(m_id))
+        appendPortObject(m_graphCore->portObject(portId));
+    m_outputPortModel->endBatch();
+    m_inputPortModel->endBatch();
 }
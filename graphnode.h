@@ -1,9 +1,11 @@
 #pragma once
 
 #include "graphgenericobject.h"
+#include "graphportmodel.h"
+#include "graphstore.h"
 
-#include <QHash>
 #include <QPointF>
+#include <QRectF>
 
 class GraphCore;
 class GraphNodePort;
@@ -11,26 +13,47 @@ class GraphNodePort;
 class GraphNode : public GraphGenericObject
 {
     Q_OBJECT
-    Q_PROPERTY(qreal xCoord READ xCoord WRITE setXCoord)
-    Q_PROPERTY(qreal yCoord READ yCoord WRITE setYCoord)
+    Q_PROPERTY(qreal xCoord READ xCoord WRITE setXCoord NOTIFY coordChanged)
+    Q_PROPERTY(qreal yCoord READ yCoord WRITE setYCoord NOTIFY coordChanged)
+    Q_PROPERTY(qreal width READ width CONSTANT)
+    Q_PROPERTY(qreal height READ height CONSTANT)
+    Q_PROPERTY(int margin READ margin CONSTANT)
+    Q_PROPERTY(int headerHeight READ headerHeight CONSTANT)
+    Q_PROPERTY(int portHeight READ portHeight CONSTANT)
+    Q_PROPERTY(int portSpacing READ portSpacing CONSTANT)
     Q_PROPERTY(QObjectList outputPorts READ outputPorts NOTIFY outputPortsChanged)
     Q_PROPERTY(QObjectList inputPorts READ inputPorts NOTIFY inputPortsChanged)
+    Q_PROPERTY(GraphPortModel *outputPortModel READ outputPortModel CONSTANT)
+    Q_PROPERTY(GraphPortModel *inputPortModel READ inputPortModel CONSTANT)
 
 public:
-    explicit GraphNode(const QPointF &coord, const QString &name, GraphCore *graphCore);
+    explicit GraphNode(int nodeId, GraphCore *graphCore);
 
-    GraphCore *graphCore() const;
+    QString name() const override;
+    QColor color() const override;
 
-    inline QPointF coord() const { return m_coord; }
-    inline qreal xCoord() const { return m_coord.x(); }
-    inline qreal yCoord() const { return m_coord.y(); }
+    void attach(int nodeId) override;
+    void detach() override;
 
-    inline QObjectList outputPorts() const { return m_outputPorts.values(); }
-    inline QObjectList inputPorts() const { return m_inputPorts.values(); }
+    QPointF coord() const;
+    inline qreal xCoord() const { return coord().x(); }
+    inline qreal yCoord() const { return coord().y(); }
+    inline qreal width() const { return GraphStore::NodeWidth; }
+    inline qreal height() const { return GraphStore::NodeHeight; }
+    inline QRectF boundingRect() const { return QRectF(coord(), QSizeF(width(), height())); }
+    inline int margin() const { return GraphStore::NodeMargin; }
+    inline int headerHeight() const { return GraphStore::NodeHeaderHeight; }
+    inline int portHeight() const { return GraphStore::PortHeight; }
+    inline int portSpacing() const { return GraphStore::PortSpacing; }
+
+    QObjectList outputPorts() const;
+    QObjectList inputPorts() const;
+    inline GraphPortModel *outputPortModel() const { return m_outputPortModel; }
+    inline GraphPortModel *inputPortModel() const { return m_inputPortModel; }
 
 public slots:
-    inline void setXCoord(double xCoord) { m_coord.setX(xCoord); }
-    inline void setYCoord(double yCoord) { m_coord.setY(yCoord); }
+    void setXCoord(double xCoord);
+    void setYCoord(double yCoord);
 
     GraphNodePort *outputPort(const QString &portName) const;
     bool addOutputPort(const QString &portName, const QVariant &value);
@@ -41,12 +64,19 @@ public slots:
     bool removeInputPort(const QString &portName);
 
 signals:
+    void coordChanged();
     void outputPortsChanged();
     void inputPortsChanged();
 
 private:
-    QPointF m_coord;
-    QHash<QString, QObject *> m_outputPorts;
-    QHash<QString, QObject *> m_inputPorts;
-};
+    friend class GraphCore;
 
+    QObjectList ports(GraphStore::PortType portType) const;
+    GraphNodePort *port(GraphStore::PortType portType, const QString &portName) const;
+    void appendPortObject(GraphNodePort *port);
+    void removePortObject(GraphNodePort *port);
+    void loadPortObjects();
+
+    GraphPortModel *m_outputPortModel;
+    GraphPortModel *m_inputPortModel;
+};
@@ -0,0 +1,389 @@
+#include "graphnodeitem.h"
+#include "graphprofiler.h"
+
+#include <QSGGeometryNode>
+#include <QSGVertexColorMaterial>
+
+#include <cstring>
+
+/**
+ * @brief The GraphNodeItem class draws the boxes and port dots of all nodes of a graph
+ * Nodes are two quads each, border and body, batched into a single geometry node with
+ * per-vertex colours. Port dots are a second batch that only exists from portZoom on.
+ * Every node and port owns a fixed slot in its batch, so only the elements of a node
+ * that moved or changed its ports are rewritten and uploaded.
+ * Text is left to QML: detailLevel tells the view when it is zoomed in far enough for
+ * labels, and the view creates full delegates only for the nodes being edited.
+ * Like GraphConnectionItem, the item lives in scene coordinates: panning and zooming
+ * only change its transform and never touch the vertex data.
+ */
+
+/**
+ * @brief GraphNodeItem::GraphNodeItem ctor
+ * @param parent parent item
+ */
+GraphNodeItem::GraphNodeItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+}
+
+/**
+ * @brief GraphNodeItem::setGraph sets the graph whose nodes are drawn
+ * The item follows node and port additions and removals of the graph from then on
+ * @param graphCore graph
+ */
+void GraphNodeItem::setGraph(GraphCore *graphCore)
+{
+    if (m_graphCore == graphCore)
+        return;
+
+    if (m_graphCore)
+        disconnect(m_graphCore, nullptr, this, nullptr);
+    m_graphCore = graphCore;
+    if (m_graphCore) {
+        connect(m_graphCore, &GraphCore::nodeAdded, this, &GraphNodeItem::addNode);
+        connect(m_graphCore, &GraphCore::nodeRemoved, this, &GraphNodeItem::removeNode);
+        connect(m_graphCore, &GraphCore::nodeMoved, this, &GraphNodeItem::markNodeDirty);
+        connect(m_graphCore, &GraphCore::portAdded, this, &GraphNodeItem::addPort);
+        connect(m_graphCore, &GraphCore::portRemoved, this, &GraphNodeItem::removePort);
+    }
+    rebuild();
+    emit graphChanged(m_graphCore);
+}
+
+void GraphNodeItem::setZoomFactor(qreal zoomFactor)
+{
+    if (qFuzzyCompare(m_zoomFactor, zoomFactor))
+        return;
+
+    m_zoomFactor = zoomFactor;
+    updateDetailLevel();
+    emit zoomFactorChanged(m_zoomFactor);
+}
+
+void GraphNodeItem::setPortZoom(qreal portZoom)
+{
+    if (qFuzzyCompare(m_portZoom, portZoom))
+        return;
+
+    m_portZoom = portZoom;
+    updateDetailLevel();
+    emit portZoomChanged(m_portZoom);
+}
+
+void GraphNodeItem::setLabelZoom(qreal labelZoom)
+{
+    if (qFuzzyCompare(m_labelZoom, labelZoom))
+        return;
+
+    m_labelZoom = labelZoom;
+    updateDetailLevel();
+    emit labelZoomChanged(m_labelZoom);
+}
+
+/**
+ * @brief GraphNodeItem::updateDetailLevel derives the detail level from the zoom factor
+ * The port batch is built when the ports become visible and dropped when they disappear
+ */
+void GraphNodeItem::updateDetailLevel()
+{
+    DetailLevel detailLevel = BoxDetail;
+    if (m_zoomFactor >= m_labelZoom)
+        detailLevel = LabelDetail;
+    else if (m_zoomFactor >= m_portZoom)
+        detailLevel = PortDetail;
+    if (detailLevel == m_detailLevel)
+        return;
+
+    const bool portsWereShown = portsShown();
+    m_detailLevel = detailLevel;
+    if (portsShown() != portsWereShown)
+        rebuildPorts();
+    emit detailLevelChanged(m_detailLevel);
+}
+
+/**
+ * @brief GraphNodeItem::addNode appends the quads of a node to the node batch
+ * @param nodeId node handle
+ */
+void GraphNodeItem::addNode(int nodeId)
+{
+    addSlot(m_nodeBatch, nodeId, VerticesPerNode);
+    m_dirtyNodes.insert(nodeId);
+    update();
+}
+
+/**
+ * @brief GraphNodeItem::removeNode removes the quads of a node and of its ports
+ * The node still exists in the store, removals are reported before they happen
+ * @param nodeId node handle
+ */
+void GraphNodeItem::removeNode(int nodeId)
+{
+    const GraphStore &store = m_graphCore->store();
+    for (int portId = store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = store.nextPort(portId))
+        removeSlot(m_portBatch, portId, VerticesPerPort);
+    removeSlot(m_nodeBatch, nodeId, VerticesPerNode);
+    m_dirtyNodes.remove(nodeId);
+    update();
+}
+
+/**
+ * @brief GraphNodeItem::addPort appends the dot of a port to the port batch, if ports are shown
+ * @param portId port handle
+ */
+void GraphNodeItem::addPort(int portId)
+{
+    if (portsShown())
+        addSlot(m_portBatch, portId, VerticesPerPort);
+    markNodeDirty(m_graphCore->store().portNode(portId));
+}
+
+/**
+ * @brief GraphNodeItem::removePort removes the dot of a port, the other ports of its node move up
+ * @param portId port handle
+ */
+void GraphNodeItem::removePort(int portId)
+{
+    removeSlot(m_portBatch, portId, VerticesPerPort);
+    markNodeDirty(m_graphCore->store().portNode(portId));
+}
+
+/**
+ * @brief GraphNodeItem::markNodeDirty schedules a node and its ports for rewriting
+ * @param nodeId node handle
+ */
+void GraphNodeItem::markNodeDirty(int nodeId)
+{
+    m_dirtyNodes.insert(nodeId);
+    update();
+}
+
+/**
+ * @brief GraphNodeItem::rebuild recreates both batches from the current graph
+ */
+void GraphNodeItem::rebuild()
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphNodeItem::rebuild");
+    m_nodeBatch = Batch();
+    m_dirtyNodes.clear();
+    if (m_graphCore) {
+        for (int nodeId : m_graphCore->nodeIds())
+            addNode(nodeId);
+    }
+    rebuildPorts();
+}
+
+/**
+ * @brief GraphNodeItem::rebuildPorts recreates the port batch, it stays empty while ports are hidden
+ */
+void GraphNodeItem::rebuildPorts()
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphNodeItem::rebuildPorts");
+    m_portBatch = Batch();
+    if (m_graphCore && portsShown()) {
+        const GraphStore &store = m_graphCore->store();
+        for (int nodeId = 0; nodeId < store.nodeCapacity(); ++nodeId) {
+            if (!store.isNode(nodeId))
+                continue;
+            for (int portId = store.firstPort(nodeId); portId != GraphStore::InvalidId; portId = store.nextPort(portId))
+                addSlot(m_portBatch, portId, VerticesPerPort);
+            m_dirtyNodes.insert(nodeId);
+        }
+    }
+    update();
+}
+
+/**
+ * @brief GraphNodeItem::addSlot appends a slot for an element to a batch
+ * @param id node or port handle
+ */
+void GraphNodeItem::addSlot(Batch &batch, int id, int verticesPerSlot)
+{
+    if (batch.slotIndices.size() <= id)
+        batch.slotIndices.resize(id + 1);
+    if (batch.slotIndices.at(id) > 0)
+        return;
+
+    batch.elements.append(id);
+    // slot indices are stored one-based, so the zeroes of a resize mean "no slot"
+    batch.slotIndices[id] = batch.elements.size();
+    batch.vertices.resize(batch.elements.size() * verticesPerSlot);
+    batch.resized = true;
+}
+
+/**
+ * @brief GraphNodeItem::removeSlot removes the slot of an element from a batch
+ * The last element of the batch is moved into the freed slot together with its
+ * vertices, so nothing has to be rewritten
+ * @param id node or port handle
+ */
+void GraphNodeItem::removeSlot(Batch &batch, int id, int verticesPerSlot)
+{
+    if (id >= batch.slotIndices.size() || batch.slotIndices.at(id) == 0)
+        return;
+
+    const int index = batch.slotIndices.at(id) - 1;
+    batch.slotIndices[id] = 0;
+    const int last = batch.elements.size() - 1;
+    if (index != last) {
+        const int moved = batch.elements.at(last);
+        batch.elements[index] = moved;
+        batch.slotIndices[moved] = index + 1;
+        std::memcpy(batch.vertices.data() + index * verticesPerSlot,
+                    batch.vertices.constData() + last * verticesPerSlot,
+                    verticesPerSlot * sizeof(QSGGeometry::ColoredPoint2D));
+    }
+    batch.elements.removeLast();
+    batch.vertices.resize(batch.elements.size() * verticesPerSlot);
+    batch.resized = true;
+}
+
+/**
+ * @brief GraphNodeItem::writeQuad writes the two triangles of a rectangle
+ * @param out VerticesPerQuad vertices
+ */
+void GraphNodeItem::writeQuad(QSGGeometry::ColoredPoint2D *out, const QRectF &rect, const QColor &color)
+{
+    const uchar r = uchar(color.red());
+    const uchar g = uchar(color.green());
+    const uchar b = uchar(color.blue());
+    const uchar a = uchar(color.alpha());
+    const float left = float(rect.left());
+    const float top = float(rect.top());
+    const float right = float(rect.right());
+    const float bottom = float(rect.bottom());
+    out[0].set(left, top, r, g, b, a);
+    out[1].set(right, top, r, g, b, a);
+    out[2].set(left, bottom, r, g, b, a);
+    out[3].set(right, top, r, g, b, a);
+    out[4].set(right, bottom, r, g, b, a);
+    out[5].set(left, bottom, r, g, b, a);
+}
+
+/**
+ * @brief GraphNodeItem::writeNode writes the border and the body quad of a node
+ * @param out VerticesPerNode vertices
+ */
+void GraphNodeItem::writeNode(int nodeId, QSGGeometry::ColoredPoint2D *out) const
+{
+    const QRectF rect = m_graphCore->store().nodeRect(nodeId);
+    writeQuad(out, rect, Qt::black);
+    writeQuad(out + VerticesPerQuad, rect.adjusted(BorderWidth, BorderWidth, -BorderWidth, -BorderWidth), Qt::lightGray);
+}
+
+/**
+ * @brief GraphNodeItem::writePort writes the dot of a port at its connection anchor
+ * Ports that do not fit into the node are clipped like in the node delegate, their
+ * quad collapses to a point
+ * @param out VerticesPerPort vertices
+ */
+void GraphNodeItem::writePort(int portId, QSGGeometry::ColoredPoint2D *out) const
+{
+    const GraphStore &store = m_graphCore->store();
+    const QPointF anchor = store.portAnchor(portId);
+    const qreal halfPort = GraphStore::PortHeight / 2.0;
+    const qreal bottom = store.nodeRect(store.portNode(portId)).bottom() - GraphStore::NodeMargin;
+    QRectF rect(anchor, QSizeF());
+    if (anchor.y() + halfPort <= bottom)
+        rect.adjust(-halfPort, -halfPort, halfPort, halfPort);
+    writeQuad(out, rect, store.portColor(portId));
+}
+
+/**
+ * @brief GraphNodeItem::updatePaintNode syncs the batches into the scene graph
+ * Resized batches are uploaded as a whole, otherwise only the slots of the
+ * rewritten nodes and ports are copied
+ */
+QSGNode *GraphNodeItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    GRAPHVIEW_PROFILE_SCOPE("GraphNodeItem::updatePaintNode");
+    QSGNode *root = oldNode;
+    if (!root) {
+        root = new QSGNode;
+        m_nodeBatchNode = nullptr;
+        m_portBatchNode = nullptr;
+    }
+
+    if (!m_graphCore)
+        m_dirtyNodes.clear();
+    const GraphStore *store = m_graphCore ? &m_graphCore->store() : nullptr;
+    for (int nodeId : qAsConst(m_dirtyNodes)) {
+        if (nodeId >= m_nodeBatch.slotIndices.size() || m_nodeBatch.slotIndices.at(nodeId) == 0)
+            continue;
+        const int index = m_nodeBatch.slotIndices.at(nodeId) - 1;
+        writeNode(nodeId, m_nodeBatch.vertices.data() + index * VerticesPerNode);
+        if (!m_nodeBatch.resized)
+            m_nodeBatch.dirtySlots.append(index);
+
+        for (int portId = store->firstPort(nodeId); portId != GraphStore::InvalidId; portId = store->nextPort(portId)) {
+            if (portId >= m_portBatch.slotIndices.size() || m_portBatch.slotIndices.at(portId) == 0)
+                continue;
+            const int portIndex = m_portBatch.slotIndices.at(portId) - 1;
+            writePort(portId, m_portBatch.vertices.data() + portIndex * VerticesPerPort);
+            if (!m_portBatch.resized)
+                m_portBatch.dirtySlots.append(portIndex);
+        }
+    }
+    m_dirtyNodes.clear();
+
+    // ports are drawn above the bodies
+    syncBatch(root, m_nodeBatchNode, m_nodeBatch, VerticesPerNode);
+    syncBatch(root, m_portBatchNode, m_portBatch, VerticesPerPort);
+    return root;
+}
+
+/**
+ * @brief GraphNodeItem::syncBatch uploads a batch into its geometry node
+ * The geometry node is created on demand and dropped once the batch is empty
+ */
+void GraphNodeItem::syncBatch(QSGNode *root, QSGGeometryNode *&node, Batch &batch, int verticesPerSlot)
+{
+    if (batch.elements.isEmpty()) {
+        if (node) {
+            root->removeChildNode(node);
+            delete node;
+            node = nullptr;
+        }
+        batch.dirtySlots.clear();
+        batch.resized = false;
+        return;
+    }
+    if (!batch.resized && batch.dirtySlots.isEmpty() && node)
+        return;
+
+    if (!node) {
+        node = new QSGGeometryNode;
+        QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0);
+        geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        geometry->setVertexDataPattern(QSGGeometry::DynamicPattern);
+        node->setGeometry(geometry);
+        node->setFlag(QSGNode::OwnsGeometry);
+        node->setMaterial(new QSGVertexColorMaterial);
+        node->setFlag(QSGNode::OwnsMaterial);
+        // there are no ports without nodes, so the port batch is always appended after the node batch
+        root->appendChildNode(node);
+        batch.resized = true;
+    }
+
+    QSGGeometry *geometry = node->geometry();
+    QSGGeometry::ColoredPoint2D *vertices;
+    if (batch.resized) {
+        geometry->allocate(batch.vertices.size());
+        vertices = geometry->vertexDataAsColoredPoint2D();
+        std::memcpy(vertices, batch.vertices.constData(),
+                    batch.vertices.size() * sizeof(QSGGeometry::ColoredPoint2D));
+        batch.resized = false;
+    } else {
+        vertices = geometry->vertexDataAsColoredPoint2D();
+        for (int index : qAsConst(batch.dirtySlots)) {
+            std::memcpy(vertices + index * verticesPerSlot,
+                        batch.vertices.constData() + index * verticesPerSlot,
+                        verticesPerSlot * sizeof(QSGGeometry::ColoredPoint2D));
+        }
+    }
+    batch.dirtySlots.clear();
+    geometry->markVertexDataDirty();
+    node->markDirty(QSGNode::DirtyGeometry);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QPointer>
+#include <QQuickItem>
+#include <QSGGeometry>
+#include <QSet>
+#include <QVector>
+
+#include "graphcore.h"
+
+class QSGGeometryNode;
+
+class GraphNodeItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(GraphCore *graph READ graph WRITE setGraph NOTIFY graphChanged)
+    Q_PROPERTY(qreal zoomFactor READ zoomFactor WRITE setZoomFactor NOTIFY zoomFactorChanged)
+    Q_PROPERTY(qreal portZoom READ portZoom WRITE setPortZoom NOTIFY portZoomChanged)
+    Q_PROPERTY(qreal labelZoom READ labelZoom WRITE setLabelZoom NOTIFY labelZoomChanged)
+    Q_PROPERTY(DetailLevel detailLevel READ detailLevel NOTIFY detailLevelChanged)
+
+public:
+    enum DetailLevel { BoxDetail, PortDetail, LabelDetail };
+    Q_ENUM(DetailLevel)
+
+    // a node is its border quad and its body quad, a port one quad, two triangles each,
+    // so every element owns a fixed slot of vertices in its batch
+    static const int VerticesPerQuad = 6;
+    static const int VerticesPerNode = 2 * VerticesPerQuad;
+    static const int VerticesPerPort = VerticesPerQuad;
+    static const int BorderWidth = 5;
+
+    explicit GraphNodeItem(QQuickItem *parent = nullptr);
+
+    inline GraphCore *graph() const { return m_graphCore; }
+    inline qreal zoomFactor() const { return m_zoomFactor; }
+    inline qreal portZoom() const { return m_portZoom; }
+    inline qreal labelZoom() const { return m_labelZoom; }
+    inline DetailLevel detailLevel() const { return m_detailLevel; }
+
+public slots:
+    void setGraph(GraphCore *graphCore);
+    void setZoomFactor(qreal zoomFactor);
+    void setPortZoom(qreal portZoom);
+    void setLabelZoom(qreal labelZoom);
+
+signals:
+    void graphChanged(GraphCore *graphCore);
+    void zoomFactorChanged(qreal zoomFactor);
+    void portZoomChanged(qreal portZoom);
+    void labelZoomChanged(qreal labelZoom);
+    void detailLevelChanged(DetailLevel detailLevel);
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *) override;
+
+private:
+    struct Batch
+    {
+        QVector<int> elements;
+        QVector<QSGGeometry::ColoredPoint2D> vertices;
+        // one-based slot index by element handle, 0 for elements outside the batch
+        QVector<int> slotIndices;
+        QVector<int> dirtySlots;
+        bool resized = true;
+    };
+
+    void addNode(int nodeId);
+    void removeNode(int nodeId);
+    void addPort(int portId);
+    void removePort(int portId);
+    void markNodeDirty(int nodeId);
+    void rebuild();
+    void rebuildPorts();
+    void updateDetailLevel();
+    inline bool portsShown() const { return m_detailLevel >= PortDetail; }
+
+    static void addSlot(Batch &batch, int id, int verticesPerSlot);
+    static void removeSlot(Batch &batch, int id, int verticesPerSlot);
+    static void writeQuad(QSGGeometry::ColoredPoint2D *out, const QRectF &rect, const QColor &color);
+    void writeNode(int nodeId, QSGGeometry::ColoredPoint2D *out) const;
+    void writePort(int portId, QSGGeometry::ColoredPoint2D *out) const;
+    static void syncBatch(QSGNode *root, QSGGeometryNode *&node, Batch &batch, int verticesPerSlot);
+
+    QPointer<GraphCore> m_graphCore;
+    qreal m_zoomFactor = 1;
+    qreal m_portZoom = 0.5;
+    qreal m_labelZoom = 0.8;
+    DetailLevel m_detailLevel = LabelDetail;
+    Batch m_nodeBatch;
+    Batch m_portBatch;
+    QSet<int> m_dirtyNodes;
+    // render side, only touched from updatePaintNode()
+    QSGGeometryNode *m_nodeBatchNode = nullptr;
+    QSGGeometryNode *m_portBatchNode = nullptr;
+};
@@ -3,38 +3,94 @@
 #include "graphnodeport.h"
 #include "graphcore.h"
 
-GraphNodePort::GraphNodePort(PortType portType, const QVariant &value, const QString &name, GraphNode *parent)
-    : GraphGenericObject(name, parent)
-    , m_portType(portType)
-    , m_value(value)
-{
-    switch (m_value.type()) {
-    case QVariant::Int:
-        m_color = Qt::red;
-        break;
-    case QVariant::Double:
-        m_color = Qt::green;
-        break;
-    case QVariant::String:
-        m_color = Qt::blue;
-        break;
-    default:
-        m_color = Qt::gray;
-        break;
-    }
+/**
+ * @brief The GraphNodePort class is the QObject facade of a port of the GraphStore
+ */
+
+/**
+ * @brief GraphNodePort::GraphNodePort ctor, facades are created by GraphCore::portObject()
+ * @param portId port handle
+ * @param graphCore the graph
+ */
+GraphNodePort::GraphNodePort(int portId, GraphCore *graphCore)
+    : GraphGenericObject(portId, graphCore)
+{
+}
+
+/**
+ * @brief GraphNodePort::attach binds a recycled facade to another port
+ * @param portId port handle
+ */
+void GraphNodePort::attach(int portId)
+{
+    GraphGenericObject::attach(portId);
+    emit valueChanged();
+    emit isConnectedChanged();
+    emit resultChanged();
+}
+
+QString GraphNodePort::name() const
+{
+    return isValid() ? store().portName(m_id) : QString();
+}
+
+QColor GraphNodePort::color() const
+{
+    return isValid() ? store().portColor(m_id) : QColor(Qt::gray);
+}
+
+GraphNodePort::PortType GraphNodePort::portType() const
+{
+    return isValid() ? PortType(store().portType(m_id)) : OutputPort;
+}
+
+QVariant GraphNodePort::value() const
+{
+    return isValid() ? store().portValue(m_id) : QVariant();
+}
+
+/**
+ * @brief GraphNodePort::setValue changes the value of the port, see GraphCore::setPortValue()
+ */
+void GraphNodePort::setValue(const QVariant &value)
+{
+    if (isValid())
+        m_graphCore->setPortValue(m_id, value);
+}
+
+/**
+ * @brief GraphNodePort::result returns the value computed for the port, computing it first if it is dirty
+ */
+QVariant GraphNodePort::result() const
+{
+    return isValid() ? m_graphCore->portResult(m_id) : QVariant();
+}
+
+int GraphNodePort::index() const
+{
+    return isValid() ? store().portIndex(m_id) : -1;
 }
 
 GraphNode *GraphNodePort::node() const
 {
-    return static_cast<GraphNode *>(parent());
+    return isValid() ? m_graphCore->nodeObject(store().portNode(m_id)) : nullptr;
 }
 
 QString GraphNodePort::nodeName() const
 {
-    return node()->name();
+    return isValid() ? store().nodeName(store().portNode(m_id)) : QString();
 }
 
 bool GraphNodePort::isConnected() const
 {
-    return node()->graphCore()->hasConnection(this);
+    return isValid() && store().portDegree(m_id) > 0;
+}
+
+/**
+ * @brief GraphNodePort::anchor returns where the connections of the port attach
+ * @return anchor in scene coordinates
+ */
+QPointF GraphNodePort::anchor() const
+{
+    return isValid() ? store().portAnchor(m_id) : QPointF();
 }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "graphgenericobject.h"
+#include "graphstore.h"
 
+#include <QPointF>
 #include <QVariant>
 
 class GraphNode;
@@ -9,25 +11,36 @@ class GraphNode;
 class GraphNodePort : public GraphGenericObject
 {
     Q_OBJECT
-    Q_PROPERTY(PortType portType READ portType CONSTANT)
-    Q_PROPERTY(QVariant value READ value CONSTANT)
-    Q_PROPERTY(QString nodeName READ nodeName CONSTANT)
-    Q_PROPERTY(bool isConnected READ isConnected CONSTANT)
+    Q_PROPERTY(PortType portType READ portType NOTIFY elementChanged)
+    Q_PROPERTY(QVariant value READ value WRITE setValue NOTIFY valueChanged)
+    Q_PROPERTY(QString nodeName READ nodeName NOTIFY elementChanged)
+    Q_PROPERTY(bool isConnected READ isConnected NOTIFY isConnectedChanged)
+    Q_PROPERTY(QVariant result READ result NOTIFY resultChanged)
 
 public:
-    enum PortType { OutputPort, InputPort };
+    enum PortType { OutputPort = GraphStore::OutputPort, InputPort = GraphStore::InputPort };
     Q_ENUM(PortType)
 
-    explicit GraphNodePort(PortType portType, const QVariant &value, const QString &name, GraphNode *parentNode);
+    explicit GraphNodePort(int portId, GraphCore *graphCore);
 
-    inline PortType portType() const { return m_portType; }
-    inline QVariant value() const { return m_value; }
+    QString name() const override;
+    QColor color() const override;
+
+    void attach(int portId) override;
+
+    PortType portType() const;
+    QVariant value() const;
+    void setValue(const QVariant &value);
+    QVariant result() const;
+    int index() const;
 
     GraphNode *node() const;
     QString nodeName() const;
     bool isConnected() const;
+    QPointF anchor() const;
 
-private:
-    const PortType m_portType;
-    QVariant m_value;
+signals:
+    void valueChanged();
+    void isConnectedChanged();
+    void resultChanged();
 };
@@ -0,0 +1,231 @@
+#include "graphobjectmodel.h"
+
+#include "graphgenericobject.h"
+
+#include <algorithm>
+
+/**
+ * @brief The GraphObjectModel class exposes a list of graph objects to QML views
+ * Rows are inserted and removed one by one, so a view creates or destroys
+ * only the delegates of the affected objects
+ */
+
+/**
+ * @brief GraphObjectModel::GraphObjectModel ctor
+ * @param parent
+ */
+GraphObjectModel::GraphObjectModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int GraphObjectModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return m_objects.size();
+}
+
+QVariant GraphObjectModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_objects.size())
+        return QVariant();
+
+    GraphGenericObject *object = static_cast<GraphGenericObject *>(m_objects.at(index.row()));
+    switch (role) {
+    case ObjectRole:
+        return QVariant::fromValue<QObject *>(object);
+    case Qt::DisplayRole:
+    case NameRole:
+        return object->name();
+    case ColorRole:
+        return object->color();
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> GraphObjectModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[ObjectRole] = QByteArrayLiteral("object");
+    roles[NameRole] = QByteArrayLiteral("name");
+    roles[ColorRole] = QByteArrayLiteral("color");
+    return roles;
+}
+
+QObject *GraphObjectModel::objectAt(int row) const
+{
+    return m_objects.value(row);
+}
+
+int GraphObjectModel::indexOf(const QObject *object) const
+{
+    return m_objects.indexOf(const_cast<QObject *>(object));
+}
+
+/**
+ * @brief GraphObjectModel::append adds a new row at the end of the model
+ * @param object graph object
+ */
+void GraphObjectModel::append(QObject *object)
+{
+    if (m_batchDepth > 0) {
+        m_pendingObjects.append(object);
+        return;
+    }
+    const int row = m_objects.size();
+    beginInsertRows(QModelIndex(), row, row);
+    m_objects.append(object);
+    endInsertRows();
+    emit countChanged(m_objects.size());
+}
+
+/**
+ * @brief GraphObjectModel::remove removes the row of the object
+ * During a batch the row is only marked and removed when the batch ends
+ * @param object graph object
+ * @return false if the model does not contain the object, always true during a batch
+ */
+bool GraphObjectModel::remove(QObject *object)
+{
+    if (m_pendingObjects.removeOne(object))
+        return true;
+    if (m_batchDepth > 0) {
+        m_removedObjects.insert(object);
+        return true;
+    }
+    const int row = indexOf(object);
+    if (row < 0)
+        return false;
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_objects.remove(row);
+    endRemoveRows();
+    emit countChanged(m_objects.size());
+    return true;
+}
+
+/**
+ * @brief GraphObjectModel::removeAll removes the rows of all given objects in one pass
+ * Adjacent rows are removed with a single notification
+ * @param objects graph objects
+ */
+void GraphObjectModel::removeAll(const QSet<const QObject *> &objects)
+{
+    if (objects.isEmpty())
+        return;
+
+    m_pendingObjects.erase(std::remove_if(m_pendingObjects.begin(), m_pendingObjects.end(), [&objects](QObject *object) {
+        return objects.contains(object);
+    }), m_pendingObjects.end());
+    eraseObjects(objects);
+}
+
+/**
+ * @brief GraphObjectModel::eraseObjects removes the rows of the objects, adjacent rows with a single notification
+ * The model is only reset if most of its rows go
+ */
+void GraphObjectModel::eraseObjects(const QSet<const QObject *> &objects)
+{
+    const int oldCount = m_objects.size();
+    if (2 * objects.size() > oldCount) {
+        const int removedCount = int(std::count_if(m_objects.constBegin(), m_objects.constEnd(), [&objects](QObject *object) {
+            return objects.contains(object);
+        }));
+        if (2 * removedCount > oldCount) {
+            beginResetModel();
+            m_objects.erase(std::remove_if(m_objects.begin(), m_objects.end(), [&objects](QObject *object) {
+                return objects.contains(object);
+            }), m_objects.end());
+            endResetModel();
+            emit countChanged(m_objects.size());
+            return;
+        }
+    }
+
+    int row = m_objects.size() - 1;
+    while (row >= 0) {
+        if (!objects.contains(m_objects.at(row))) {
+            --row;
+            continue;
+        }
+        const int last = row;
+        while (row > 0 && objects.contains(m_objects.at(row - 1)))
+            --row;
+        beginRemoveRows(QModelIndex(), row, last);
+        m_objects.remove(row, last - row + 1);
+        endRemoveRows();
+        --row;
+    }
+    if (m_objects.size() != oldCount)
+        emit countChanged(m_objects.size());
+}
+
+/**
+ * @brief GraphObjectModel::clear removes all rows
+ */
+void GraphObjectModel::clear()
+{
+    m_pendingObjects.clear();
+    m_removedObjects.clear();
+    if (m_objects.isEmpty())
+        return;
+
+    beginResetModel();
+    m_objects.clear();
+    endResetModel();
+    emit countChanged(0);
+}
+
+/**
+ * @brief GraphObjectModel::refresh notifies views that some data of the object has changed
+ * @param object graph object
+ * @param roles changed roles, all roles if empty
+ */
+void GraphObjectModel::refresh(QObject *object, const QVector<int> &roles)
+{
+    const int row = indexOf(object);
+    if (row < 0)
+        return;
+
+    const QModelIndex idx = index(row);
+    emit dataChanged(idx, idx, roles);
+}
+
+/**
+ * @brief GraphObjectModel::beginBatch starts collecting appended and removed rows instead of applying them one by one
+ * Batches can be nested, rows are removed and inserted when the outermost batch ends
+ */
+void GraphObjectModel::beginBatch()
+{
+    ++m_batchDepth;
+}
+
+/**
+ * @brief GraphObjectModel::endBatch applies the rows removed and appended during the batch
+ * The appended rows are inserted with a single notification
+ */
+void GraphObjectModel::endBatch()
+{
+    Q_ASSERT(m_batchDepth > 0);
+    if (--m_batchDepth > 0)
+        return;
+
+    // a removed object may already be appended again, so only committed rows are erased
+    if (!m_removedObjects.isEmpty()) {
+        const QSet<const QObject *> removedObjects = m_removedObjects;
+        m_removedObjects.clear();
+        eraseObjects(removedObjects);
+    }
+    if (m_pendingObjects.isEmpty())
+        return;
+
+    const int first = m_objects.size();
+    beginInsertRows(QModelIndex(), first, first + m_pendingObjects.size() - 1);
+    m_objects += m_pendingObjects;
+    m_pendingObjects.clear();
+    endInsertRows();
+    emit countChanged(m_objects.size());
+}
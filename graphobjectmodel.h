@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QSet>
+#include <QVector>
+
+class GraphObjectModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    enum Roles {
+        ObjectRole = Qt::UserRole + 1,
+        NameRole,
+        ColorRole,
+        LastRole
+    };
+    Q_ENUM(Roles)
+
+    explicit GraphObjectModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    inline int count() const { return m_objects.size(); }
+    inline const QVector<QObject *> &objects() const { return m_objects; }
+    Q_INVOKABLE QObject *objectAt(int row) const;
+    int indexOf(const QObject *object) const;
+
+    void append(QObject *object);
+    bool remove(QObject *object);
+    void removeAll(const QSet<const QObject *> &objects);
+    void clear();
+    void refresh(QObject *object, const QVector<int> &roles = QVector<int>());
+
+    void beginBatch();
+    void endBatch();
+
+signals:
+    void countChanged(int count);
+
+protected:
+    QVector<QObject *> m_objects;
+
+private:
+    void eraseObjects(const QSet<const QObject *> &objects);
+
+    int m_batchDepth = 0;
+    QVector<QObject *> m_pendingObjects;
+    QSet<const QObject *> m_removedObjects;
+};
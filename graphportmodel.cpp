@@ -0,0 +1,90 @@
+#include "graphportmodel.h"
+
+#include "graphnodeport.h"
+
+/**
+ * @brief The GraphPortModel class lists the ports of one direction of a node
+ * In addition to the generic roles it exposes the value and the connection state,
+ * and refreshes a row when the connection state of its port changes
+ */
+
+/**
+ * @brief GraphPortModel::GraphPortModel ctor
+ * @param parent
+ */
+GraphPortModel::GraphPortModel(QObject *parent)
+    : GraphObjectModel(parent)
+{
+}
+
+QVariant GraphPortModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_objects.size())
+        return QVariant();
+
+    GraphNodePort *port = static_cast<GraphNodePort *>(m_objects.at(index.row()));
+    switch (role) {
+    case ValueRole:
+        return port->value();
+    case PortTypeRole:
+        return port->portType();
+    case IsConnectedRole:
+        return port->isConnected();
+    default:
+        break;
+    }
+    return GraphObjectModel::data(index, role);
+}
+
+QHash<int, QByteArray> GraphPortModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = GraphObjectModel::roleNames();
+    roles[ValueRole] = QByteArrayLiteral("value");
+    roles[PortTypeRole] = QByteArrayLiteral("portType");
+    roles[IsConnectedRole] = QByteArrayLiteral("isConnected");
+    return roles;
+}
+
+/**
+ * @brief GraphPortModel::appendPort adds a port row and tracks its connection state
+ * Port facades are recycled across nodes, so the model connects to a port at most once
+ * and disconnects when the row goes
+ * @param port a new port
+ */
+void GraphPortModel::appendPort(GraphNodePort *port)
+{
+    append(port);
+    connect(port, &GraphNodePort::isConnectedChanged, this, &GraphPortModel::refreshConnected, Qt::UniqueConnection);
+    connect(port, &GraphNodePort::elementChanged, this, &GraphPortModel::refreshElement, Qt::UniqueConnection);
+}
+
+/**
+ * @brief GraphPortModel::removePort removes the row of a port and stops tracking it
+ * @param port port facade
+ * @return false if the model does not contain the port
+ */
+bool GraphPortModel::removePort(GraphNodePort *port)
+{
+    disconnect(port, nullptr, this, nullptr);
+    return remove(port);
+}
+
+/**
+ * @brief GraphPortModel::clearPorts removes all rows and stops tracking their ports
+ */
+void GraphPortModel::clearPorts()
+{
+    for (QObject *port : objects())
+        disconnect(port, nullptr, this, nullptr);
+    clear();
+}
+
+void GraphPortModel::refreshConnected()
+{
+    refresh(sender(), { IsConnectedRole });
+}
+
+void GraphPortModel::refreshElement()
+{
+    refresh(sender(), { NameRole, ColorRole, PortTypeRole });
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "graphobjectmodel.h"
+
+class GraphNodePort;
+
+class GraphPortModel : public GraphObjectModel
+{
+    Q_OBJECT
+
+public:
+    enum PortRoles {
+        ValueRole = GraphObjectModel::LastRole,
+        PortTypeRole,
+        IsConnectedRole
+    };
+    Q_ENUM(PortRoles)
+
+    explicit GraphPortModel(QObject *parent = nullptr);
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    void appendPort(GraphNodePort *port);
+    bool removePort(GraphNodePort *port);
+    void clearPorts();
+
+private slots:
+    void refreshConnected();
+    void refreshElement();
+};
@@ -0,0 +1,170 @@
+#include "graphprofiler.h"
+
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThread>
+
+/**
+ * @brief The GraphProfiler class collects timings and counters of the hot paths
+ * The GRAPHVIEW_PROFILE_SCOPE and GRAPHVIEW_PROFILE_COUNT macros feed it. They are compiled
+ * in by CONFIG+=profiling only, otherwise they expand to nothing and the profiler stays empty.
+ *
+ * Scopes are recorded as events with their thread, for the trace, and summed up per name,
+ * for statistics(). Counters are plain atomics owned by the profiler, every call site looks
+ * its counter up once, so counting costs one atomic add.
+ *
+ * writeTrace() exports the events in the Chrome trace event format, which chrome://tracing
+ * and the Perfetto UI open.
+ */
+
+/**
+ * @brief GraphProfiler::instance returns the profiler of the process
+ */
+GraphProfiler *GraphProfiler::instance()
+{
+    static GraphProfiler profiler;
+    return &profiler;
+}
+
+GraphProfiler::GraphProfiler()
+    : m_enabled(isCompiledIn() ? 1 : 0)
+{
+    m_clock.start();
+}
+
+/**
+ * @brief GraphProfiler::counter returns the counter of a name, creating it on first use
+ * @param name string literal
+ */
+GraphProfiler::Counter *GraphProfiler::counter(const char *name)
+{
+    QMutexLocker locker(&m_mutex);
+    const QByteArray key(name);
+    Counter *counter = m_counterIndex.value(key);
+    if (!counter) {
+        m_counters.emplace_back();
+        counter = &m_counters.back();
+        counter->name = name;
+        m_counterIndex.insert(key, counter);
+    }
+    return counter;
+}
+
+/**
+ * @brief GraphProfiler::addEvent records a finished scope
+ * @param name string literal
+ * @param start start in nanoseconds since the profiler was created
+ * @param duration duration in nanoseconds
+ */
+void GraphProfiler::addEvent(const char *name, qint64 start, qint64 duration)
+{
+    const quintptr threadId = quintptr(QThread::currentThreadId());
+    QMutexLocker locker(&m_mutex);
+    if (m_events.size() < MaxEvents) {
+        Event event;
+        event.name = name;
+        event.start = start;
+        event.duration = duration;
+        event.threadId = threadId;
+        m_events.append(event);
+    } else {
+        ++m_droppedEvents;
+    }
+    Summary &summary = m_summaries[QByteArray::fromRawData(name, int(qstrlen(name)))];
+    ++summary.count;
+    summary.total += duration;
+    summary.maximum = qMax(summary.maximum, duration);
+}
+
+/**
+ * @brief GraphProfiler::statistics returns the summed up scopes and the counters
+ * scopes maps every scope name to its count and its total and maximum time in milliseconds,
+ * counters maps every counter name to its value
+ */
+QVariantMap GraphProfiler::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVariantMap scopes;
+    for (auto it = m_summaries.cbegin(); it != m_summaries.cend(); ++it) {
+        QVariantMap scope;
+        scope.insert(QStringLiteral("count"), it.value().count);
+        scope.insert(QStringLiteral("totalMs"), it.value().total / 1e6);
+        scope.insert(QStringLiteral("maxMs"), it.value().maximum / 1e6);
+        scopes.insert(QString::fromLatin1(it.key()), scope);
+    }
+    QVariantMap counters;
+    for (const Counter &counter : m_counters)
+        counters.insert(QString::fromLatin1(counter.name), counter.value.loadAcquire());
+
+    QVariantMap statistics;
+    statistics.insert(QStringLiteral("compiledIn"), isCompiledIn());
+    statistics.insert(QStringLiteral("scopes"), scopes);
+    statistics.insert(QStringLiteral("counters"), counters);
+    statistics.insert(QStringLiteral("events"), m_events.size());
+    statistics.insert(QStringLiteral("droppedEvents"), m_droppedEvents);
+    return statistics;
+}
+
+/**
+ * @brief GraphProfiler::writeTrace writes the recorded events as a Chrome trace
+ * Scopes become complete events on the thread that ran them, counters become counter events
+ * at the time of the export
+ * @param fileName trace file, usually with the suffix json
+ * @param errorString receives a description of the error
+ * @return false if the file could not be written
+ */
+bool GraphProfiler::writeTrace(const QString &fileName, QString *errorString) const
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *errorString = tr("Unable to write trace '%1'").arg(fileName);
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    const qint64 exportTime = now();
+    QTextStream out(&file);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    // the thread handles are replaced by small numbers in the order the threads appear
+    QHash<quintptr, int> threadNumbers;
+    bool first = true;
+    for (const Event &event : m_events) {
+        const int threadNumber = threadNumbers.value(event.threadId, threadNumbers.size());
+        threadNumbers.insert(event.threadId, threadNumber);
+        out << (first ? "" : ",\n")
+            << "{\"name\":\"" << event.name << "\",\"cat\":\"graphview\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadNumber
+            << ",\"ts\":" << QString::number(event.start / 1000.0, 'f', 3)
+            << ",\"dur\":" << QString::number(event.duration / 1000.0, 'f', 3) << "}";
+        first = false;
+    }
+    for (const Counter &counter : m_counters) {
+        out << (first ? "" : ",\n")
+            << "{\"name\":\"" << counter.name << "\",\"cat\":\"graphview\",\"ph\":\"C\",\"pid\":1,\"tid\":0"
+            << ",\"ts\":" << QString::number(exportTime / 1000.0, 'f', 3)
+            << ",\"args\":{\"value\":" << counter.value.loadAcquire() << "}}";
+        first = false;
+    }
+    out << "\n]}\n";
+    out.flush();
+    locker.unlock();
+
+    if (out.status() != QTextStream::Ok || !file.commit()) {
+        *errorString = tr("Unable to write trace '%1'").arg(fileName);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief GraphProfiler::reset drops the recorded events and sets all counters to zero
+ */
+void GraphProfiler::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_events.clear();
+    m_droppedEvents = 0;
+    m_summaries.clear();
+    for (Counter &counter : m_counters)
+        counter.value.storeRelease(0);
+}
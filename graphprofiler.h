@@ -0,0 +1,120 @@
+#pragma once
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+#include <deque>
+
+class GraphProfiler
+{
+    Q_DECLARE_TR_FUNCTIONS(GraphProfiler)
+
+public:
+    // events past this many are only summed up, the trace keeps the first ones
+    static const int MaxEvents = 1 << 20;
+
+    struct Counter
+    {
+        const char *name;
+        QAtomicInteger<qint64> value;
+    };
+
+    static GraphProfiler *instance();
+    static inline bool isCompiledIn() {
+#ifdef GRAPHVIEW_PROFILING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    inline bool isEnabled() const { return m_enabled.loadAcquire(); }
+    inline void setEnabled(bool enabled) { m_enabled.storeRelease(enabled ? 1 : 0); }
+    inline qint64 now() const { return m_clock.nsecsElapsed(); }
+
+    Counter *counter(const char *name);
+    void addEvent(const char *name, qint64 start, qint64 duration);
+
+    QVariantMap statistics() const;
+    bool writeTrace(const QString &fileName, QString *errorString) const;
+    void reset();
+
+private:
+    GraphProfiler();
+
+    struct Event
+    {
+        const char *name;
+        qint64 start;
+        qint64 duration;
+        quintptr threadId;
+    };
+
+    struct Summary
+    {
+        qint64 count = 0;
+        qint64 total = 0;
+        qint64 maximum = 0;
+    };
+
+    QAtomicInt m_enabled;
+    QElapsedTimer m_clock;
+    mutable QMutex m_mutex;
+    QVector<Event> m_events;
+    qint64 m_droppedEvents = 0;
+    QHash<QByteArray, Summary> m_summaries;
+    // counters live as long as the process, call sites keep pointers to them
+    std::deque<Counter> m_counters;
+    QHash<QByteArray, Counter *> m_counterIndex;
+};
+
+/**
+ * Measures the time until the end of the enclosing scope, see GRAPHVIEW_PROFILE_SCOPE
+ */
+class GraphProfileScope
+{
+public:
+    explicit inline GraphProfileScope(const char *name)
+        : m_name(name), m_start(GraphProfiler::instance()->isEnabled() ? GraphProfiler::instance()->now() : -1)
+    {
+    }
+
+    inline ~GraphProfileScope()
+    {
+        if (m_start >= 0) {
+            GraphProfiler *profiler = GraphProfiler::instance();
+            profiler->addEvent(m_name, m_start, profiler->now() - m_start);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(GraphProfileScope)
+
+    const char *m_name;
+    qint64 m_start;
+};
+
+// Instrumentation of the hot paths, built with CONFIG+=profiling. Otherwise the macros expand to nothing.
+#ifdef GRAPHVIEW_PROFILING
+#define GRAPHVIEW_PROFILE_CONCAT_(a, b) a##b
+#define GRAPHVIEW_PROFILE_CONCAT(a, b) GRAPHVIEW_PROFILE_CONCAT_(a, b)
+// times the rest of the scope, name must be a string literal
+#define GRAPHVIEW_PROFILE_SCOPE(name) \
+    const GraphProfileScope GRAPHVIEW_PROFILE_CONCAT(graphProfileScope_, __LINE__)(name)
+// adds delta to the counter, name must be a string literal
+#define GRAPHVIEW_PROFILE_COUNT(name, delta) \
+    do { \
+        static GraphProfiler::Counter *const graphProfileCounter_ = GraphProfiler::instance()->counter(name); \
+        graphProfileCounter_->value.fetchAndAddRelaxed(delta); \
+    } while (false)
+#else
+#define GRAPHVIEW_PROFILE_SCOPE(name) do {} while (false)
+#define GRAPHVIEW_PROFILE_COUNT(name, delta) do {} while (false)
+#endif
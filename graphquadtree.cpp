@@ -0,0 +1,252 @@
+#include "graphquadtree.h"
+
+/**
+ * @brief The GraphQuadTree class is a spatial index over the bounding boxes of graph elements
+ * Every box is stored in the smallest cell that fully contains it, a leaf is split into
+ * four children once it holds more than MaxCellEntries boxes. The root grows on demand,
+ * so the index covers an unbounded scene. Insert, update and remove take O(log n),
+ * a region query visits only the cells overlapping the region.
+ */
+
+namespace {
+
+const int MaxCellEntries = 16;
+
+} // namespace
+
+/**
+ * @brief GraphQuadTree::GraphQuadTree ctor
+ * @param minCellSize cells of this size are not split any more
+ */
+GraphQuadTree::GraphQuadTree(qreal minCellSize)
+    : m_minCellSize(minCellSize)
+{
+}
+
+QRectF GraphQuadTree::rect(int item) const
+{
+    const int entryIndex = m_entryIndex.value(item, -1);
+    return entryIndex < 0 ? QRectF() : m_entries.at(entryIndex).rect;
+}
+
+/**
+ * @brief GraphQuadTree::insert adds a box to the index, an item already in the index is moved
+ * @param item element handle
+ * @param rect bounding box in scene coordinates
+ */
+void GraphQuadTree::insert(int item, const QRectF &rect)
+{
+    if (m_entryIndex.contains(item)) {
+        update(item, rect);
+        return;
+    }
+
+    int entryIndex;
+    if (!m_freeEntries.isEmpty()) {
+        entryIndex = m_freeEntries.takeLast();
+    } else {
+        entryIndex = m_entries.size();
+        m_entries.append(Entry());
+    }
+    Entry &entry = m_entries[entryIndex];
+    entry.item = item;
+    entry.rect = rect;
+    m_entryIndex.insert(item, entryIndex);
+
+    ensureRootContains(rect);
+    insertEntry(m_root, entryIndex);
+}
+
+/**
+ * @brief GraphQuadTree::update changes the box of an item
+ * A box that stays inside its leaf cell is updated in place
+ * @param item element handle
+ * @param rect new bounding box in scene coordinates
+ */
+void GraphQuadTree::update(int item, const QRectF &rect)
+{
+    const int entryIndex = m_entryIndex.value(item, -1);
+    if (entryIndex < 0) {
+        insert(item, rect);
+        return;
+    }
+
+    Entry &entry = m_entries[entryIndex];
+    const Cell &cell = m_cells.at(entry.cell);
+    if (cell.isLeaf() && cell.bounds.contains(rect)) {
+        entry.rect = rect;
+        return;
+    }
+
+    m_cells[entry.cell].entries.removeOne(entryIndex);
+    entry.rect = rect;
+    ensureRootContains(rect);
+    insertEntry(m_root, entryIndex);
+}
+
+/**
+ * @brief GraphQuadTree::remove removes an item from the index
+ * @return false if the item is not in the index
+ */
+bool GraphQuadTree::remove(int item)
+{
+    auto it = m_entryIndex.find(item);
+    if (it == m_entryIndex.end())
+        return false;
+
+    const int entryIndex = it.value();
+    m_entryIndex.erase(it);
+    Entry &entry = m_entries[entryIndex];
+    m_cells[entry.cell].entries.removeOne(entryIndex);
+    entry = Entry();
+    m_freeEntries.append(entryIndex);
+
+    if (m_entryIndex.isEmpty())
+        clear();
+    return true;
+}
+
+void GraphQuadTree::clear()
+{
+    m_root = -1;
+    m_cells.clear();
+    m_entries.clear();
+    m_freeEntries.clear();
+    m_entryIndex.clear();
+}
+
+/**
+ * @brief GraphQuadTree::query returns all items whose boxes intersect the region
+ * @param rect region in scene coordinates
+ */
+QVector<int> GraphQuadTree::query(const QRectF &rect) const
+{
+    QVector<int> result;
+    if (m_root < 0)
+        return result;
+
+    QVector<int> stack;
+    stack.append(m_root);
+    while (!stack.isEmpty()) {
+        const Cell &cell = m_cells.at(stack.takeLast());
+        if (!cell.bounds.intersects(rect))
+            continue;
+        for (const int entryIndex : cell.entries) {
+            const Entry &entry = m_entries.at(entryIndex);
+            if (entry.rect.intersects(rect))
+                result.append(entry.item);
+        }
+        if (!cell.isLeaf()) {
+            for (const int child : cell.children)
+                stack.append(child);
+        }
+    }
+    return result;
+}
+
+int GraphQuadTree::createCell(const QRectF &bounds, int parent)
+{
+    Cell cell;
+    cell.bounds = bounds;
+    cell.parent = parent;
+    m_cells.append(cell);
+    return m_cells.size() - 1;
+}
+
+/**
+ * @brief GraphQuadTree::ensureRootContains doubles the root cell towards the box until it fits
+ */
+void GraphQuadTree::ensureRootContains(const QRectF &rect)
+{
+    if (m_root < 0) {
+        const qreal side = qMax(m_minCellSize * 4, qMax(rect.width(), rect.height()) * 2);
+        m_root = createCell(QRectF(rect.center() - QPointF(side / 2, side / 2), QSizeF(side, side)), -1);
+    }
+
+    while (!m_cells.at(m_root).bounds.contains(rect)) {
+        const QRectF old = m_cells.at(m_root).bounds;
+        const bool growLeft = rect.left() < old.left();
+        const bool growUp = rect.top() < old.top();
+        const QRectF bounds(growLeft ? old.left() - old.width() : old.left(),
+                            growUp ? old.top() - old.height() : old.top(),
+                            old.width() * 2, old.height() * 2);
+        const int oldRoot = m_root;
+        const int oldPosition = (growLeft ? 1 : 0) | (growUp ? 2 : 0);
+        m_root = createCell(bounds, -1);
+        for (int child = 0; child < 4; ++child) {
+            const int cellIndex = child == oldPosition ? oldRoot : createCell(childBounds(bounds, child), m_root);
+            m_cells[m_root].children[child] = cellIndex;
+        }
+        m_cells[oldRoot].parent = m_root;
+    }
+}
+
+void GraphQuadTree::insertEntry(int cellIndex, int entryIndex)
+{
+    const QRectF rect = m_entries.at(entryIndex).rect;
+    for (;;) {
+        const Cell &cell = m_cells.at(cellIndex);
+        if (cell.isLeaf())
+            break;
+        const int child = childFor(cell.bounds, rect);
+        if (child < 0)
+            break;
+        cellIndex = cell.children[child];
+    }
+
+    m_cells[cellIndex].entries.append(entryIndex);
+    m_entries[entryIndex].cell = cellIndex;
+
+    const Cell &cell = m_cells.at(cellIndex);
+    if (cell.isLeaf() && cell.entries.size() > MaxCellEntries && cell.bounds.width() > m_minCellSize)
+        split(cellIndex);
+}
+
+/**
+ * @brief GraphQuadTree::split creates the children of a leaf and moves down the boxes that fit into them
+ */
+void GraphQuadTree::split(int cellIndex)
+{
+    const QRectF bounds = m_cells.at(cellIndex).bounds;
+    for (int child = 0; child < 4; ++child) {
+        const int childIndex = createCell(childBounds(bounds, child), cellIndex);
+        m_cells[cellIndex].children[child] = childIndex;
+    }
+
+    const QVector<int> entries = m_cells.at(cellIndex).entries;
+    QVector<int> kept;
+    for (const int entryIndex : entries) {
+        const int child = childFor(bounds, m_entries.at(entryIndex).rect);
+        if (child < 0) {
+            kept.append(entryIndex);
+            continue;
+        }
+        const int childIndex = m_cells.at(cellIndex).children[child];
+        m_cells[childIndex].entries.append(entryIndex);
+        m_entries[entryIndex].cell = childIndex;
+    }
+    m_cells[cellIndex].entries = kept;
+}
+
+/**
+ * @brief GraphQuadTree::childFor returns the quadrant of the cell fully containing the box, -1 if none does
+ */
+int GraphQuadTree::childFor(const QRectF &bounds, const QRectF &rect)
+{
+    const QPointF center = bounds.center();
+    const bool left = rect.right() <= center.x();
+    const bool right = rect.left() >= center.x();
+    const bool top = rect.bottom() <= center.y();
+    const bool bottom = rect.top() >= center.y();
+    if (!(left || right) || !(top || bottom))
+        return -1;
+    return (right ? 1 : 0) | (bottom ? 2 : 0);
+}
+
+QRectF GraphQuadTree::childBounds(const QRectF &bounds, int child)
+{
+    const QSizeF half = bounds.size() / 2;
+    return QRectF(bounds.left() + ((child & 1) ? half.width() : 0),
+                  bounds.top() + ((child & 2) ? half.height() : 0),
+                  half.width(), half.height());
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QHash>
+#include <QRectF>
+#include <QVector>
+
+class GraphQuadTree
+{
+public:
+    explicit GraphQuadTree(qreal minCellSize = 256);
+
+    inline int size() const { return m_entryIndex.size(); }
+    inline bool contains(int item) const { return m_entryIndex.contains(item); }
+    QRectF rect(int item) const;
+
+    void insert(int item, const QRectF &rect);
+    void update(int item, const QRectF &rect);
+    bool remove(int item);
+    void clear();
+
+    QVector<int> query(const QRectF &rect) const;
+
+private:
+    struct Cell
+    {
+        QRectF bounds;
+        int parent = -1;
+        int children[4] = { -1, -1, -1, -1 };
+        QVector<int> entries;
+        inline bool isLeaf() const { return children[0] < 0; }
+    };
+
+    struct Entry
+    {
+        int item = -1;
+        QRectF rect;
+        int cell = -1;
+    };
+
+    int createCell(const QRectF &bounds, int parent);
+    void ensureRootContains(const QRectF &rect);
+    void insertEntry(int cellIndex, int entryIndex);
+    void split(int cellIndex);
+    static int childFor(const QRectF &bounds, const QRectF &rect);
+    static QRectF childBounds(const QRectF &bounds, int child);
+
+    qreal m_minCellSize;
+    int m_root = -1;
+    QVector<Cell> m_cells;
+    QVector<Entry> m_entries;
+    QVector<int> m_freeEntries;
+    QHash<int, int> m_entryIndex;
+};
@@ -0,0 +1,538 @@
+#include "graphstore.h"
+
+/**
+ * @brief The GraphStore class keeps nodes, ports and connections in struct-of-arrays tables
+ * Elements are addressed by integer handles which index the tables. Slots of removed
+ * elements are recycled, so handles stay dense. Ports are chained per node in the order
+ * they were added, connections are doubly chained per output port and per input port, so
+ * every incidence query walks only the elements it returns and removals cost O(degree).
+ * Node and port names are interned, so lookups compare integers and a connection
+ * is found by the pair of its port handles.
+ * The store keeps its tables consistent on its own: removing a port removes its
+ * connections, removing a node removes its ports. It emits nothing; GraphCore wraps it
+ * with change notifications and QObject facades.
+ */
+
+/**
+ * @brief GraphStore::findNode looks a node up by the id of its name
+ * @return node handle or InvalidId
+ */
+int GraphStore::findNode(int nameId) const
+{
+    return nameId >= 0 && nameId < m_nodeIds.size() ? m_nodeIds.at(nameId) : InvalidId;
+}
+
+/**
+ * @brief GraphStore::nodePorts returns all ports of the node, in the order they were added
+ * @param nodeId node handle
+ */
+QVector<int> GraphStore::nodePorts(int nodeId) const
+{
+    QVector<int> ports;
+    ports.reserve(m_nodePortCounts[OutputPort].at(nodeId) + m_nodePortCounts[InputPort].at(nodeId));
+    for (int portId = m_nodeFirstPort.at(nodeId); portId != InvalidId; portId = m_portNext.at(portId))
+        ports.append(portId);
+    return ports;
+}
+
+/**
+ * @brief GraphStore::nodePorts returns the ports of one direction, ordered by their index
+ * @param nodeId node handle
+ * @param portType direction
+ */
+QVector<int> GraphStore::nodePorts(int nodeId, PortType portType) const
+{
+    QVector<int> ports;
+    ports.reserve(m_nodePortCounts[portType].at(nodeId));
+    for (int portId = m_nodeFirstPort.at(nodeId); portId != InvalidId; portId = m_portNext.at(portId)) {
+        if (m_portTypes.at(portId) == portType)
+            ports.append(portId);
+    }
+    return ports;
+}
+
+/**
+ * @brief GraphStore::nodeConnections returns the connections attached to any port of the node
+ * @param nodeId node handle
+ */
+QVector<int> GraphStore::nodeConnections(int nodeId) const
+{
+    QVector<int> connections;
+    connections.reserve(nodeDegree(nodeId));
+    for (int portId = m_nodeFirstPort.at(nodeId); portId != InvalidId; portId = m_portNext.at(portId)) {
+        for (int connectionId = m_portFirstConnection.at(portId); connectionId != InvalidId;
+             connectionId = nextConnection(connectionId, portId)) {
+            connections.append(connectionId);
+        }
+    }
+    return connections;
+}
+
+/**
+ * @brief GraphStore::nodeDegree returns the number of connections attached to any port of the node
+ * @param nodeId node handle
+ */
+int GraphStore::nodeDegree(int nodeId) const
+{
+    int degree = 0;
+    for (int portId = m_nodeFirstPort.at(nodeId); portId != InvalidId; portId = m_portNext.at(portId))
+        degree += m_portDegrees.at(portId);
+    return degree;
+}
+
+/**
+ * @brief GraphStore::addNode creates a node without ports
+ * @param nameId id of a unique node name, see intern()
+ * @param coord position in scene coordinates
+ * @return handle of the new node or InvalidId if the name is taken
+ */
+int GraphStore::addNode(int nameId, const QPointF &coord)
+{
+    Q_ASSERT(nameId >= 0 && nameId < m_names.count());
+    if (findNode(nameId) != InvalidId)
+        return InvalidId;
+
+    int nodeId;
+    if (m_freeNodes.isEmpty()) {
+        nodeId = m_nodeAlive.size();
+        m_nodeAlive.append(true);
+        m_nodeNames.append(nameId);
+        m_nodeCoords.append(coord);
+        m_nodeFirstPort.append(InvalidId);
+        m_nodeLastPort.append(InvalidId);
+        m_nodePortCounts[OutputPort].append(0);
+        m_nodePortCounts[InputPort].append(0);
+        m_nodeRevisions.append(1);
+    } else {
+        nodeId = m_freeNodes.takeLast();
+        m_nodeAlive[nodeId] = true;
+        m_nodeNames[nodeId] = nameId;
+        m_nodeCoords[nodeId] = coord;
+        m_nodeFirstPort[nodeId] = InvalidId;
+        m_nodeLastPort[nodeId] = InvalidId;
+        m_nodePortCounts[OutputPort][nodeId] = 0;
+        m_nodePortCounts[InputPort][nodeId] = 0;
+        ++m_nodeRevisions[nodeId];
+    }
+    while (m_nodeIds.size() < m_names.count())
+        m_nodeIds.append(InvalidId);
+    m_nodeIds[nameId] = nodeId;
+    ++m_nodeCount;
+    return nodeId;
+}
+
+/**
+ * @brief GraphStore::removeNode removes a node together with its ports and their connections
+ * The ports are released without renumbering their siblings, so the removal costs
+ * O(ports + degree) of the node
+ * @param nodeId node handle
+ */
+void GraphStore::removeNode(int nodeId)
+{
+    Q_ASSERT(isNode(nodeId));
+    for (int portId = m_nodeFirstPort.at(nodeId); portId != InvalidId; ) {
+        while (m_portFirstConnection.at(portId) != InvalidId)
+            removeConnection(m_portFirstConnection.at(portId));
+        const int next = m_portNext.at(portId);
+        releasePort(portId);
+        portId = next;
+    }
+    m_nodeFirstPort[nodeId] = InvalidId;
+    m_nodeLastPort[nodeId] = InvalidId;
+    m_nodePortCounts[OutputPort][nodeId] = 0;
+    m_nodePortCounts[InputPort][nodeId] = 0;
+    ++m_nodeRevisions[nodeId];
+
+    m_nodeIds[m_nodeNames.at(nodeId)] = InvalidId;
+    m_nodeAlive[nodeId] = false;
+    m_nodeNames[nodeId] = InvalidId;
+    m_freeNodes.append(nodeId);
+    --m_nodeCount;
+}
+
+/**
+ * @brief GraphStore::setNodeCoord moves a node, the anchors of its ports are recomputed on demand
+ * @param nodeId node handle
+ * @param coord position in scene coordinates
+ */
+void GraphStore::setNodeCoord(int nodeId, const QPointF &coord)
+{
+    m_nodeCoords[nodeId] = coord;
+    ++m_nodeRevisions[nodeId];
+}
+
+/**
+ * @brief GraphStore::portColor returns the colour of a port, which depends on the type of its value
+ * @param portId port handle
+ */
+QColor GraphStore::portColor(int portId) const
+{
+    switch (m_portValues.at(portId).type()) {
+    case QVariant::Int:
+        return Qt::red;
+    case QVariant::Double:
+        return Qt::green;
+    case QVariant::String:
+        return Qt::blue;
+    default:
+        break;
+    }
+    return Qt::gray;
+}
+
+/**
+ * @brief GraphStore::portAnchor returns where the connections of a port attach
+ * Ports are stacked below the node header, inputs on the left edge and outputs on the
+ * right edge. The position is cached until the node moves or its ports change.
+ * @param portId port handle
+ * @return anchor in scene coordinates
+ */
+QPointF GraphStore::portAnchor(int portId) const
+{
+    const int nodeId = m_portNodes.at(portId);
+    const quint32 revision = m_nodeRevisions.at(nodeId);
+    if (m_portAnchorRevisions.at(portId) != revision) {
+        const qreal halfPort = PortHeight / 2.0;
+        const qreal x = m_portTypes.at(portId) == InputPort ? NodeMargin + halfPort
+                                                            : NodeWidth - NodeMargin - halfPort;
+        const qreal y = NodeMargin + NodeHeaderHeight + m_portIndices.at(portId) * (PortHeight + PortSpacing) + halfPort;
+        m_portAnchors[portId] = m_nodeCoords.at(nodeId) + QPointF(x, y);
+        m_portAnchorRevisions[portId] = revision;
+    }
+    return m_portAnchors.at(portId);
+}
+
+/**
+ * @brief GraphStore::connectionRect returns the bounding box of the curve of a connection
+ * The control points of the curve lie in the box spanned by the two anchors, so does the curve
+ * @param connectionId connection handle
+ */
+QRectF GraphStore::connectionRect(int connectionId) const
+{
+    return QRectF(portAnchor(m_connectionOutputs.at(connectionId)),
+                  portAnchor(m_connectionInputs.at(connectionId))).normalized();
+}
+
+/**
+ * @brief GraphStore::curvePoint returns a point on the curve drawn for a connection
+ * The curve is the pair of quadratic segments meeting halfway between the anchors,
+ * leaving and entering them horizontally.
+ * @param p0 anchor of the output port
+ * @param p2 anchor of the input port
+ * @param t curve parameter from 0 at p0 to 1 at p2
+ */
+QPointF GraphStore::curvePoint(const QPointF &p0, const QPointF &p2, qreal t)
+{
+    const QPointF center = (p0 + p2) / 2;
+    if (t <= 0.5) {
+        const qreal s = 2 * t;
+        const qreal u = 1 - s;
+        return u * u * p0 + 2 * u * s * QPointF(center.x(), p0.y()) + s * s * center;
+    }
+    const qreal s = 2 * t - 1;
+    const qreal u = 1 - s;
+    return u * u * center + 2 * u * s * QPointF(center.x(), p2.y()) + s * s * p2;
+}
+
+/**
+ * @brief GraphStore::findPort looks a port of the node up by direction and the id of its name
+ * @return port handle or InvalidId
+ */
+int GraphStore::findPort(int nodeId, PortType portType, int nameId) const
+{
+    if (nameId == InvalidId)
+        return InvalidId;
+    for (int portId = m_nodeFirstPort.at(nodeId); portId != InvalidId; portId = m_portNext.at(portId)) {
+        if (m_portTypes.at(portId) == portType && m_portNames.at(portId) == nameId)
+            return portId;
+    }
+    return InvalidId;
+}
+
+/**
+ * @brief GraphStore::portConnections returns the connections attached to the port, O(degree)
+ * @param portId port handle
+ */
+QVector<int> GraphStore::portConnections(int portId) const
+{
+    QVector<int> connections;
+    connections.reserve(m_portDegrees.at(portId));
+    for (int connectionId = m_portFirstConnection.at(portId); connectionId != InvalidId;
+         connectionId = nextConnection(connectionId, portId)) {
+        connections.append(connectionId);
+    }
+    return connections;
+}
+
+/**
+ * @brief GraphStore::addPort appends a port to the ports of one direction of a node
+ * @param nodeId node handle
+ * @param portType direction
+ * @param nameId id of the port name, unique per node and direction, see intern()
+ * @param value port value
+ * @return handle of the new port or InvalidId if the name is taken
+ */
+int GraphStore::addPort(int nodeId, PortType portType, int nameId, const QVariant &value)
+{
+    Q_ASSERT(isNode(nodeId));
+    Q_ASSERT(nameId >= 0 && nameId < m_names.count());
+    if (findPort(nodeId, portType, nameId) != InvalidId)
+        return InvalidId;
+
+    const int index = m_nodePortCounts[portType].at(nodeId);
+    int portId;
+    if (m_freePorts.isEmpty()) {
+        portId = m_portAlive.size();
+        m_portAlive.append(true);
+        m_portNodes.append(nodeId);
+        m_portTypes.append(quint8(portType));
+        m_portIndices.append(index);
+        m_portNext.append(InvalidId);
+        m_portNames.append(nameId);
+        m_portValues.append(value);
+        m_portFirstConnection.append(InvalidId);
+        m_portDegrees.append(0);
+        m_portAnchors.append(QPointF());
+        m_portAnchorRevisions.append(0);
+    } else {
+        portId = m_freePorts.takeLast();
+        m_portAlive[portId] = true;
+        m_portNodes[portId] = nodeId;
+        m_portTypes[portId] = quint8(portType);
+        m_portIndices[portId] = index;
+        m_portNext[portId] = InvalidId;
+        m_portNames[portId] = nameId;
+        m_portValues[portId] = value;
+        m_portFirstConnection[portId] = InvalidId;
+        m_portDegrees[portId] = 0;
+        m_portAnchorRevisions[portId] = 0;
+    }
+
+    const int lastPort = m_nodeLastPort.at(nodeId);
+    if (lastPort == InvalidId)
+        m_nodeFirstPort[nodeId] = portId;
+    else
+        m_portNext[lastPort] = portId;
+    m_nodeLastPort[nodeId] = portId;
+    ++m_nodePortCounts[portType][nodeId];
+    ++m_nodeRevisions[nodeId];
+    ++m_portCount;
+    return portId;
+}
+
+/**
+ * @brief GraphStore::removePort removes a port together with its connections
+ * The later ports of the same direction move up by one index, so the removal costs
+ * O(ports + degree) of the node
+ * @param portId port handle
+ */
+void GraphStore::removePort(int portId)
+{
+    Q_ASSERT(isPort(portId));
+    while (m_portFirstConnection.at(portId) != InvalidId)
+        removeConnection(m_portFirstConnection.at(portId));
+
+    const int nodeId = m_portNodes.at(portId);
+    const quint8 portType = m_portTypes.at(portId);
+    const int index = m_portIndices.at(portId);
+    int previous = InvalidId;
+    for (int p = m_nodeFirstPort.at(nodeId); p != InvalidId; p = m_portNext.at(p)) {
+        if (p == portId) {
+            if (previous == InvalidId)
+                m_nodeFirstPort[nodeId] = m_portNext.at(p);
+            else
+                m_portNext[previous] = m_portNext.at(p);
+            if (m_nodeLastPort.at(nodeId) == p)
+                m_nodeLastPort[nodeId] = previous;
+            continue;
+        }
+        if (m_portTypes.at(p) == portType && m_portIndices.at(p) > index)
+            --m_portIndices[p];
+        previous = p;
+    }
+    --m_nodePortCounts[portType][nodeId];
+    ++m_nodeRevisions[nodeId];
+    releasePort(portId);
+}
+
+/**
+ * @brief GraphStore::addConnection connects an output port to an input port
+ * @param outPortId output port handle
+ * @param inPortId input port handle
+ * @return handle of the new connection or InvalidId if the ports are already connected
+ */
+int GraphStore::addConnection(int outPortId, int inPortId)
+{
+    Q_ASSERT(isPort(outPortId) && portType(outPortId) == OutputPort);
+    Q_ASSERT(isPort(inPortId) && portType(inPortId) == InputPort);
+    if (findConnection(outPortId, inPortId) != InvalidId)
+        return InvalidId;
+
+    int connectionId;
+    if (m_freeConnections.isEmpty()) {
+        connectionId = m_connectionAlive.size();
+        m_connectionAlive.append(true);
+        m_connectionOutputs.append(outPortId);
+        m_connectionInputs.append(inPortId);
+        m_connectionNextOut.append(m_portFirstConnection.at(outPortId));
+        m_connectionNextIn.append(m_portFirstConnection.at(inPortId));
+        m_connectionPrevOut.append(InvalidId);
+        m_connectionPrevIn.append(InvalidId);
+    } else {
+        connectionId = m_freeConnections.takeLast();
+        m_connectionAlive[connectionId] = true;
+        m_connectionOutputs[connectionId] = outPortId;
+        m_connectionInputs[connectionId] = inPortId;
+        m_connectionNextOut[connectionId] = m_portFirstConnection.at(outPortId);
+        m_connectionNextIn[connectionId] = m_portFirstConnection.at(inPortId);
+        m_connectionPrevOut[connectionId] = InvalidId;
+        m_connectionPrevIn[connectionId] = InvalidId;
+    }
+    if (m_portFirstConnection.at(outPortId) != InvalidId)
+        m_connectionPrevOut[m_portFirstConnection.at(outPortId)] = connectionId;
+    if (m_portFirstConnection.at(inPortId) != InvalidId)
+        m_connectionPrevIn[m_portFirstConnection.at(inPortId)] = connectionId;
+    m_portFirstConnection[outPortId] = connectionId;
+    m_portFirstConnection[inPortId] = connectionId;
+    m_connectionKeys.insert(connectionKey(outPortId, inPortId), connectionId);
+    ++m_portDegrees[outPortId];
+    ++m_portDegrees[inPortId];
+    ++m_connectionCount;
+    return connectionId;
+}
+
+/**
+ * @brief GraphStore::removeConnection disconnects two ports
+ * @param connectionId connection handle
+ */
+void GraphStore::removeConnection(int connectionId)
+{
+    Q_ASSERT(isConnection(connectionId));
+    const int outPortId = m_connectionOutputs.at(connectionId);
+    const int inPortId = m_connectionInputs.at(connectionId);
+    unlinkConnection(outPortId, connectionId);
+    unlinkConnection(inPortId, connectionId);
+    --m_portDegrees[outPortId];
+    --m_portDegrees[inPortId];
+    m_connectionKeys.remove(connectionKey(outPortId, inPortId));
+
+    m_connectionAlive[connectionId] = false;
+    m_connectionOutputs[connectionId] = InvalidId;
+    m_connectionInputs[connectionId] = InvalidId;
+    m_freeConnections.append(connectionId);
+    --m_connectionCount;
+}
+
+/**
+ * @brief GraphStore::reserve preallocates the tables, e.g. before a graph of known size is loaded
+ */
+void GraphStore::reserve(int nodeCount, int portCount, int connectionCount)
+{
+    m_nodeAlive.reserve(nodeCount);
+    m_nodeNames.reserve(nodeCount);
+    m_nodeCoords.reserve(nodeCount);
+    m_nodeFirstPort.reserve(nodeCount);
+    m_nodeLastPort.reserve(nodeCount);
+    m_nodePortCounts[OutputPort].reserve(nodeCount);
+    m_nodePortCounts[InputPort].reserve(nodeCount);
+    m_nodeRevisions.reserve(nodeCount);
+    m_nodeIds.reserve(nodeCount);
+
+    m_portAlive.reserve(portCount);
+    m_portNodes.reserve(portCount);
+    m_portTypes.reserve(portCount);
+    m_portIndices.reserve(portCount);
+    m_portNext.reserve(portCount);
+    m_portNames.reserve(portCount);
+    m_portValues.reserve(portCount);
+    m_portFirstConnection.reserve(portCount);
+    m_portDegrees.reserve(portCount);
+    m_portAnchors.reserve(portCount);
+    m_portAnchorRevisions.reserve(portCount);
+
+    m_connectionAlive.reserve(connectionCount);
+    m_connectionOutputs.reserve(connectionCount);
+    m_connectionInputs.reserve(connectionCount);
+    m_connectionNextOut.reserve(connectionCount);
+    m_connectionNextIn.reserve(connectionCount);
+    m_connectionPrevOut.reserve(connectionCount);
+    m_connectionPrevIn.reserve(connectionCount);
+    m_connectionKeys.reserve(connectionCount);
+}
+
+/**
+ * @brief GraphStore::clear removes all elements in bulk, handles start from zero again
+ * The tables keep their capacity and serve as arenas for the next graph, only the
+ * strings and values owned by the elements are released
+ */
+void GraphStore::clear()
+{
+    m_names.clear();
+
+    m_nodeCount = 0;
+    m_nodeAlive.clear();
+    m_nodeNames.clear();
+    m_nodeCoords.clear();
+    m_nodeFirstPort.clear();
+    m_nodeLastPort.clear();
+    m_nodePortCounts[OutputPort].clear();
+    m_nodePortCounts[InputPort].clear();
+    m_nodeRevisions.clear();
+    m_freeNodes.clear();
+    m_nodeIds.clear();
+
+    m_portCount = 0;
+    m_portAlive.clear();
+    m_portNodes.clear();
+    m_portTypes.clear();
+    m_portIndices.clear();
+    m_portNext.clear();
+    m_portNames.clear();
+    m_portValues.clear();
+    m_portFirstConnection.clear();
+    m_portDegrees.clear();
+    m_portAnchors.clear();
+    m_portAnchorRevisions.clear();
+    m_freePorts.clear();
+
+    m_connectionCount = 0;
+    m_connectionAlive.clear();
+    m_connectionOutputs.clear();
+    m_connectionInputs.clear();
+    m_connectionNextOut.clear();
+    m_connectionNextIn.clear();
+    m_connectionPrevOut.clear();
+    m_connectionPrevIn.clear();
+    m_freeConnections.clear();
+    m_connectionKeys.clear();
+}
+
+/**
+ * @brief GraphStore::unlinkConnection removes a connection from the chain of one of its ports, O(1)
+ */
+void GraphStore::unlinkConnection(int portId, int connectionId)
+{
+    const bool output = m_portTypes.at(portId) == OutputPort;
+    QVector<int> &next = output ? m_connectionNextOut : m_connectionNextIn;
+    QVector<int> &previous = output ? m_connectionPrevOut : m_connectionPrevIn;
+    const int nextId = next.at(connectionId);
+    const int previousId = previous.at(connectionId);
+    if (previousId == InvalidId)
+        m_portFirstConnection[portId] = nextId;
+    else
+        next[previousId] = nextId;
+    if (nextId != InvalidId)
+        previous[nextId] = previousId;
+}
+
+/**
+ * @brief GraphStore::releasePort frees the slot of a port that is no longer chained to its node
+ */
+void GraphStore::releasePort(int portId)
+{
+    m_portAlive[portId] = false;
+    m_portNames[portId] = InvalidId;
+    m_portValues[portId] = QVariant();
+    m_freePorts.append(portId);
+    --m_portCount;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <QColor>
+#include <QHash>
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+#include "graphnametable.h"
+
+class GraphStore
+{
+public:
+    enum PortType { OutputPort, InputPort };
+    static inline bool isPortType(int portType) { return portType == OutputPort || portType == InputPort; }
+
+    static const int InvalidId = -1;
+
+    // node layout shared with the QML delegate, port anchors are derived from it
+    static const int NodeWidth = 250;
+    static const int NodeHeight = 300;
+    static const int NodeMargin = 6;
+    static const int NodeHeaderHeight = 30;
+    static const int PortHeight = 18;
+    static const int PortSpacing = 2;
+
+    inline int nodeCount() const { return m_nodeCount; }
+    inline int nodeCapacity() const { return m_nodeAlive.size(); }
+    inline bool isNode(int nodeId) const { return nodeId >= 0 && nodeId < m_nodeAlive.size() && m_nodeAlive.at(nodeId); }
+    inline const QString &nodeName(int nodeId) const { return m_names.name(m_nodeNames.at(nodeId)); }
+    inline int nodeNameId(int nodeId) const { return m_nodeNames.at(nodeId); }
+    inline QPointF nodeCoord(int nodeId) const { return m_nodeCoords.at(nodeId); }
+    inline QRectF nodeRect(int nodeId) const { return QRectF(m_nodeCoords.at(nodeId), QSizeF(NodeWidth, NodeHeight)); }
+    inline quint32 nodeRevision(int nodeId) const { return m_nodeRevisions.at(nodeId); }
+    inline int firstPort(int nodeId) const { return m_nodeFirstPort.at(nodeId); }
+    inline int portCount(int nodeId, PortType portType) const { return m_nodePortCounts[portType].at(nodeId); }
+    int findNode(int nameId) const;
+    inline int findNode(const QString &name) const { return findNode(m_names.find(name)); }
+    QVector<int> nodePorts(int nodeId) const;
+    QVector<int> nodePorts(int nodeId, PortType portType) const;
+    QVector<int> nodeConnections(int nodeId) const;
+    int nodeDegree(int nodeId) const;
+
+    int addNode(int nameId, const QPointF &coord);
+    inline int addNode(const QString &name, const QPointF &coord) { return addNode(m_names.intern(name), coord); }
+    void removeNode(int nodeId);
+    void setNodeCoord(int nodeId, const QPointF &coord);
+
+    inline int portCount() const { return m_portCount; }
+    inline int portCapacity() const { return m_portAlive.size(); }
+    inline bool isPort(int portId) const { return portId >= 0 && portId < m_portAlive.size() && m_portAlive.at(portId); }
+    inline int portNode(int portId) const { return m_portNodes.at(portId); }
+    inline PortType portType(int portId) const { return PortType(m_portTypes.at(portId)); }
+    inline int portIndex(int portId) const { return m_portIndices.at(portId); }
+    inline const QString &portName(int portId) const { return m_names.name(m_portNames.at(portId)); }
+    inline int portNameId(int portId) const { return m_portNames.at(portId); }
+    inline const QVariant &portValue(int portId) const { return m_portValues.at(portId); }
+    inline int nextPort(int portId) const { return m_portNext.at(portId); }
+    inline int portDegree(int portId) const { return m_portDegrees.at(portId); }
+    inline int firstConnection(int portId) const { return m_portFirstConnection.at(portId); }
+    QColor portColor(int portId) const;
+    QPointF portAnchor(int portId) const;
+    int findPort(int nodeId, PortType portType, int nameId) const;
+    inline int findPort(int nodeId, PortType portType, const QString &name) const {
+        return findPort(nodeId, portType, m_names.find(name));
+    }
+    QVector<int> portConnections(int portId) const;
+
+    int addPort(int nodeId, PortType portType, int nameId, const QVariant &value);
+    inline int addPort(int nodeId, PortType portType, const QString &name, const QVariant &value) {
+        return addPort(nodeId, portType, m_names.intern(name), value);
+    }
+    void removePort(int portId);
+    inline void setPortValue(int portId, const QVariant &value) { m_portValues[portId] = value; }
+
+    inline int connectionCount() const { return m_connectionCount; }
+    inline int connectionCapacity() const { return m_connectionAlive.size(); }
+    inline bool isConnection(int connectionId) const {
+        return connectionId >= 0 && connectionId < m_connectionAlive.size() && m_connectionAlive.at(connectionId);
+    }
+    inline int connectionOutput(int connectionId) const { return m_connectionOutputs.at(connectionId); }
+    inline int connectionInput(int connectionId) const { return m_connectionInputs.at(connectionId); }
+    inline int nextConnection(int connectionId, int portId) const {
+        return m_connectionOutputs.at(connectionId) == portId ? m_connectionNextOut.at(connectionId)
+                                                              : m_connectionNextIn.at(connectionId);
+    }
+    inline int findConnection(int outPortId, int inPortId) const {
+        return m_connectionKeys.value(connectionKey(outPortId, inPortId), InvalidId);
+    }
+
+    QRectF connectionRect(int connectionId) const;
+    static QPointF curvePoint(const QPointF &p0, const QPointF &p2, qreal t);
+
+    int addConnection(int outPortId, int inPortId);
+    void removeConnection(int connectionId);
+
+    inline const GraphNameTable &names() const { return m_names; }
+    inline int intern(const QString &name) { return m_names.intern(name); }
+
+    void reserve(int nodeCount, int portCount, int connectionCount);
+    void clear();
+
+private:
+    static inline quint64 connectionKey(int outPortId, int inPortId) {
+        return (quint64(quint32(outPortId)) << 32) | quint32(inPortId);
+    }
+
+    void unlinkConnection(int portId, int connectionId);
+    void releasePort(int portId);
+
+    // names of nodes and ports are stored as ids into this table
+    GraphNameTable m_names;
+
+    // nodes
+    int m_nodeCount = 0;
+    QVector<bool> m_nodeAlive;
+    QVector<int> m_nodeNames;
+    QVector<QPointF> m_nodeCoords;
+    QVector<int> m_nodeFirstPort;
+    QVector<int> m_nodeLastPort;
+    QVector<int> m_nodePortCounts[2];
+    // bumped whenever the node moves or its ports change, invalidating cached port anchors and expression bindings
+    QVector<quint32> m_nodeRevisions;
+    QVector<int> m_freeNodes;
+    // node handle by name id, InvalidId for names no node uses
+    QVector<int> m_nodeIds;
+
+    // ports, chained per node in the order they were added
+    int m_portCount = 0;
+    QVector<bool> m_portAlive;
+    QVector<int> m_portNodes;
+    QVector<quint8> m_portTypes;
+    QVector<int> m_portIndices;
+    QVector<int> m_portNext;
+    QVector<int> m_portNames;
+    QVector<QVariant> m_portValues;
+    QVector<int> m_portFirstConnection;
+    QVector<int> m_portDegrees;
+    mutable QVector<QPointF> m_portAnchors;
+    mutable QVector<quint32> m_portAnchorRevisions;
+    QVector<int> m_freePorts;
+
+    // connections, doubly chained per output port and per input port, so unlinking one is O(1)
+    int m_connectionCount = 0;
+    QVector<bool> m_connectionAlive;
+    QVector<int> m_connectionOutputs;
+    QVector<int> m_connectionInputs;
+    QVector<int> m_connectionNextOut;
+    QVector<int> m_connectionNextIn;
+    QVector<int> m_connectionPrevOut;
+    QVector<int> m_connectionPrevIn;
+    QVector<int> m_freeConnections;
+    QHash<quint64, int> m_connectionKeys;
+};
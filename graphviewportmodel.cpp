@@ -0,0 +1,122 @@
+#include "graphviewportmodel.h"
+
+#include "graphcore.h"
+#include "graphnode.h"
+
+/**
+ * @brief The GraphViewportModel class lists only the nodes intersecting the viewport
+ * The rows follow the viewport and the node positions incrementally: panning inserts
+ * the nodes that scroll in and removes the ones that scroll out, so the number of
+ * delegates depends on what is on screen and not on the size of the graph.
+ * Until a viewport is set the model lists all nodes.
+ */
+
+/**
+ * @brief GraphViewportModel::GraphViewportModel ctor
+ * @param graphCore the graph, also the parent of the model
+ */
+GraphViewportModel::GraphViewportModel(GraphCore *graphCore)
+    : GraphObjectModel(graphCore)
+    , m_graphCore(graphCore)
+{
+    connect(graphCore, &GraphCore::nodeAdded, this, &GraphViewportModel::updateNode);
+    connect(graphCore, &GraphCore::nodeMoved, this, &GraphViewportModel::updateNode);
+    connect(graphCore, &GraphCore::nodeRemoved, this, &GraphViewportModel::removeNode);
+}
+
+/**
+ * @brief GraphViewportModel::queryRect returns the viewport grown by the margin
+ * The margin lets delegates be created before they scroll into view
+ */
+QRectF GraphViewportModel::queryRect() const
+{
+    return m_viewport.adjusted(-m_margin, -m_margin, m_margin, m_margin);
+}
+
+/**
+ * @brief GraphViewportModel::setViewport sets the visible region in scene coordinates
+ * @param viewport visible region
+ */
+void GraphViewportModel::setViewport(const QRectF &viewport)
+{
+    if (m_viewport == viewport)
+        return;
+
+    m_viewport = viewport;
+    refill();
+    emit viewportChanged(m_viewport);
+}
+
+void GraphViewportModel::setMargin(qreal margin)
+{
+    if (qFuzzyCompare(m_margin, margin))
+        return;
+
+    m_margin = margin;
+    refill();
+    emit marginChanged(m_margin);
+}
+
+/**
+ * @brief GraphViewportModel::clearNodes removes all rows at once, used when the whole graph is cleared
+ */
+void GraphViewportModel::clearNodes()
+{
+    m_visibleNodes.clear();
+    clear();
+}
+
+bool GraphViewportModel::isVisible(int nodeId) const
+{
+    return m_viewport.isNull() || m_graphCore->store().nodeRect(nodeId).intersects(queryRect());
+}
+
+void GraphViewportModel::updateNode(int nodeId)
+{
+    const bool visible = isVisible(nodeId);
+    if (visible == m_visibleNodes.contains(nodeId))
+        return;
+
+    if (visible) {
+        m_visibleNodes.insert(nodeId);
+        append(m_graphCore->nodeObject(nodeId));
+    } else {
+        m_visibleNodes.remove(nodeId);
+        remove(m_graphCore->nodeObject(nodeId));
+    }
+}
+
+void GraphViewportModel::removeNode(int nodeId)
+{
+    if (m_visibleNodes.remove(nodeId))
+        remove(m_graphCore->nodeObject(nodeId));
+}
+
+/**
+ * @brief GraphViewportModel::refill queries the spatial index and applies the difference to the rows
+ * Facades are created only for the nodes entering the viewport
+ */
+void GraphViewportModel::refill()
+{
+    const QVector<int> nodes = m_viewport.isNull() ? m_graphCore->nodeIds()
+                                                   : m_graphCore->nodeIdsInRect(queryRect());
+    QSet<int> visibleNodes;
+    visibleNodes.reserve(nodes.size());
+    for (int nodeId : nodes)
+        visibleNodes.insert(nodeId);
+
+    QSet<const QObject *> hiddenNodes;
+    for (int nodeId : qAsConst(m_visibleNodes)) {
+        if (!visibleNodes.contains(nodeId))
+            hiddenNodes.insert(m_graphCore->nodeObject(nodeId));
+    }
+    removeAll(hiddenNodes);
+
+    beginBatch();
+    for (int nodeId : nodes) {
+        if (!m_visibleNodes.contains(nodeId))
+            append(m_graphCore->nodeObject(nodeId));
+    }
+    endBatch();
+    m_visibleNodes = visibleNodes;
+}
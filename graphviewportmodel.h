@@ -0,0 +1,43 @@
+#pragma once
+
+#include "graphobjectmodel.h"
+
+#include <QRectF>
+#include <QSet>
+
+class GraphCore;
+
+class GraphViewportModel : public GraphObjectModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QRectF viewport READ viewport WRITE setViewport NOTIFY viewportChanged)
+    Q_PROPERTY(qreal margin READ margin WRITE setMargin NOTIFY marginChanged)
+
+public:
+    explicit GraphViewportModel(GraphCore *graphCore);
+
+    inline QRectF viewport() const { return m_viewport; }
+    inline qreal margin() const { return m_margin; }
+    QRectF queryRect() const;
+
+    void clearNodes();
+
+public slots:
+    void setViewport(const QRectF &viewport);
+    void setMargin(qreal margin);
+
+signals:
+    void viewportChanged(const QRectF &viewport);
+    void marginChanged(qreal margin);
+
+private:
+    bool isVisible(int nodeId) const;
+    void updateNode(int nodeId);
+    void removeNode(int nodeId);
+    void refill();
+
+    GraphCore *m_graphCore;
+    QRectF m_viewport;
+    qreal m_margin = 0;
+    QSet<int> m_visibleNodes;
+};
@@ -1,15 +1,22 @@
+#include <QDebug>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QQmlEngine>
 
+#include "graphcommandline.h"
 #include "graphconnection.h"
+#include "graphconnectionitem.h"
 #include "graphcore.h"
 #include "graphnode.h"
+#include "graphnodeitem.h"
+#include "graphprofiler.h"
 
 void fillGraph(GraphCore &graphCore)
 {
     const QString nodeNameTemplate = QStringLiteral("Node_%1");
     const QStringList portNameTemplates = { QStringLiteral("Integer_%1"), QStringLiteral("Double_%1"), QStringLiteral("Expr_%1"), QStringLiteral("Bool_%1") };
+    graphCore.beginUpdate();
     for (int n = 1, x = 50, y = 50, p = 1; n <= 3; ++n, x += 330, y += 80) {
         const QString &nodeName = nodeNameTemplate.arg(n);
         Q_ASSERT(graphCore.addGraphNode(nodeName, x, y));
@@ -30,11 +37,26 @@ void fillGraph(GraphCore &graphCore)
     Q_ASSERT(graphCore.addGraphConnection(nodeNameTemplate.arg(2), portNameTemplates.at(2).arg(15), nodeNameTemplate.arg(3), portNameTemplates.at(2).arg(19)));
     Q_ASSERT(graphCore.addGraphConnection(nodeNameTemplate.arg(3), portNameTemplates.at(1).arg(22), nodeNameTemplate.arg(1), portNameTemplates.at(1).arg(2)));
     Q_ASSERT(graphCore.addGraphConnection(nodeNameTemplate.arg(1), portNameTemplates.at(3).arg(8), nodeNameTemplate.arg(3), portNameTemplates.at(3).arg(20)));
+    graphCore.endUpdate();
 }
 
 int main(int argc, char *argv[])
 {
+    // commands like "graphview convert in.json out.gvb" run without GUI, see GraphCommandLine
+    if (argc > 1 && GraphCommandLine::isCommand(argv[1])) {
+        QCoreApplication app(argc, argv);
+        const int exitCode = GraphCommandLine::run(app.arguments());
+        const QString traceFileName = qEnvironmentVariable("GRAPHVIEW_TRACE");
+        QString errorString;
+        if (!traceFileName.isEmpty() && !GraphProfiler::instance()->writeTrace(traceFileName, &errorString))
+            qWarning() << errorString;
+        return exitCode;
+    }
+
     qRegisterMetaType<QObjectList>("QObjectList");
+    qmlRegisterUncreatableType<GraphCore>("GraphView", 1, 0, "GraphCore", QStringLiteral("GraphCore is provided by the application"));
+    qmlRegisterType<GraphConnectionItem>("GraphView", 1, 0, "GraphConnectionItem");
+    qmlRegisterType<GraphNodeItem>("GraphView", 1, 0, "GraphNodeItem");
 
     QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 
@@ -59,5 +81,13 @@ int main(int argc, char *argv[])
     }, Qt::QueuedConnection);
     engine.load(url);
 
+    // GRAPHVIEW_TRACE=<file> exports the profiling events on exit, see GraphProfiler
+    const QString traceFileName = qEnvironmentVariable("GRAPHVIEW_TRACE");
+    if (!traceFileName.isEmpty()) {
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, &graphCore, [&graphCore, traceFileName]() {
+            graphCore.writeTrace(traceFileName);
+        });
+    }
+
     return app.exec();
 }
@@ -3,6 +3,7 @@ import QtQuick.Window 2.12
 import QtQuick.Controls 2.5
 import QtQuick.Layouts 1.12
 import QtQuick.Dialogs 1.3
+import GraphView 1.0
 
 Window {
     id: root
@@ -13,25 +14,41 @@ Window {
     title: graphCore.sourceFileName
     property int highestZ: 0
     property real zoomFactor: 1
-    property var portCoords: ({})
+    // names of the selected nodes, they are the ones being edited and get full delegates
     property var selectedNodes: ({})
 
     function select(node, exclusive) {
         if (exclusive) {
-            for (var nodeName in selectedNodes) {
-                if (nodeName !== node.name) {
-                    var n = selectedNodes[nodeName]
-                    n.border.color = "black"
-                }
+            for (var i = editedNodeModel.count - 1; i >= 0; --i) {
+                if (editedNodeModel.get(i).name !== node.name)
+                    removeEditedNode(i)
             }
-            selectedNodes = {}
         }
-        selectedNodes[node.name] = node
-        node.border.color = "red"
+        if (selectedNodes[node.name] === undefined) {
+            selectedNodes[node.name] = true
+            editedNodeModel.append({ "name": node.name })
+        }
     }
     function deselect(node) {
-        delete selectedNodes[node.name]
-        node.border.color = "black"
+        for (var i = 0; i < editedNodeModel.count; ++i) {
+            if (editedNodeModel.get(i).name === node.name) {
+                removeEditedNode(i)
+                return
+            }
+        }
+    }
+    function clearSelection() {
+        while (editedNodeModel.count > 0)
+            removeEditedNode(editedNodeModel.count - 1)
+    }
+    function removeEditedNode(index) {
+        delete selectedNodes[editedNodeModel.get(index).name]
+        editedNodeModel.remove(index)
+    }
+
+    // delegates are added and removed one by one, so a delegate survives changes of the selection
+    ListModel {
+        id: editedNodeModel
     }
 
     function saveAs() {
@@ -47,49 +64,99 @@ Window {
         id: fileDialog
         title: "Please choose a file"
         folder: shortcuts.home
-        nameFilters: [ "JSON files (*.JSON *.json)", "All files (*)"]
+        nameFilters: [ "JSON files (*.JSON *.json)", "Graph binary files (*.gvb)", "All files (*)"]
         onAccepted: {
             if (selectExisting)
-                graphCore.load(fileDialog.fileUrl)
+                graphCore.loadAsync(fileDialog.fileUrl)
             else
                 graphCore.saveAs(fileDialog.fileUrl)
         }
 //        Component.onCompleted: visible = true
     }
 
-    signal graphChanged()
+    onZoomFactorChanged: graphCore.zoomFactor = zoomFactor
 
-    function updateConnections() {
-        if (active) {
-            graphChanged()
-            canvas.requestPaint()
-        }
-        else {
-            portCoords = {}
+    Connections {
+        target: graphCore
+        // removed nodes lose their delegates
+        onGraphChanged: {
+            for (var i = editedNodeModel.count - 1; i >= 0; --i) {
+                if (!graphCore.findNode(editedNodeModel.get(i).name))
+                    removeEditedNode(i)
+            }
         }
     }
 
-    onActiveChanged: updateConnections()
-    onZoomFactorChanged: graphCore.zoomFactor = zoomFactor
-
     Component.onCompleted: zoomFactor = graphCore.zoomFactor
 
+    Shortcut {
+        sequence: StandardKey.Delete
+        onActivated: graphCore.removeGraphNodes(Object.keys(selectedNodes))
+    }
+
     Flickable {
         id: flick
         anchors.fill: parent
         contentWidth: width * zoomFactor
         contentHeight: height * zoomFactor
 
-        onContentXChanged: updateConnections()
-        onContentYChanged: updateConnections()
-
         MouseArea {
             id: mouseArea
             anchors.fill: parent
             acceptedButtons: Qt.LeftButton | Qt.RightButton
+            // nodes are drawn by nodeItem, so they are picked and dragged here until they
+            // are selected and get a delegate of their own
+            property var dragNode: null
+            property point dragOffset
+            onPressed: {
+                if (mouse.button !== Qt.LeftButton)
+                    return
+                var scenePos = Qt.point(mouse.x / scene.scale, mouse.y / scene.scale)
+                var hits = graphCore.nodesInRect(Qt.rect(scenePos.x, scenePos.y, 1, 1))
+                if (hits.length === 0) {
+                    if (!(mouse.modifiers & Qt.ControlModifier))
+                        clearSelection()
+                    return
+                }
+                var nodeData = hits[hits.length - 1]
+                if (mouse.modifiers & Qt.ControlModifier) {
+                    if (selectedNodes[nodeData.name] !== undefined)
+                        deselect(nodeData)
+                    else
+                        select(nodeData, false)
+                    return
+                }
+                select(nodeData, true)
+                dragNode = nodeData
+                dragOffset = Qt.point(scenePos.x - nodeData.xCoord, scenePos.y - nodeData.yCoord)
+                preventStealing = true
+            }
+            onPositionChanged: {
+                if (dragNode)
+                    graphCore.moveNodeTo(dragNode.name, mouse.x / scene.scale - dragOffset.x, mouse.y / scene.scale - dragOffset.y)
+            }
+            onReleased: {
+                dragNode = null
+                preventStealing = false
+            }
+            onCanceled: {
+                dragNode = null
+                preventStealing = false
+            }
             onClicked: {
-                if (mouse.button === Qt.RightButton)
-                    contextMenu.popup()
+                if (mouse.button !== Qt.RightButton)
+                    return
+                var scenePos = Qt.point(mouse.x / scene.scale, mouse.y / scene.scale)
+                if (graphCore.nodesInRect(Qt.rect(scenePos.x, scenePos.y, 1, 1)).length === 0) {
+                    // curves are thin, so they are picked within a few pixels at any zoom
+                    var connection = graphCore.connectionAt(scenePos, 6 / scene.scale)
+                    if (connection) {
+                        connectionMenu.connectionName = connection.name
+                        connectionMenu.popup()
+                        return
+                    }
+                }
+                contextMenu.popup()
             }
             onPressAndHold: {
                 if (mouse.source === Qt.MouseEventNotSynthesized)
@@ -104,15 +171,41 @@ Window {
                 }
             }
 
+            Menu {
+                id: connectionMenu
+                property string connectionName
+                MenuItem {
+                    text: qsTr("Remove Connection")
+                    onTriggered: graphCore.removeGraphConnection(connectionMenu.connectionName)
+                }
+            }
+
             Menu {
                 id: contextMenu
                 MenuItem {
                     text: qsTr("Add Node...")
                     onTriggered: {
                         var name = "Something"
-                        graphCore.addGraphNode(name, mouseArea.mouseX, mouseArea.mouseY)
+                        graphCore.addGraphNode(name, mouseArea.mouseX / scene.scale, mouseArea.mouseY / scene.scale)
                     }
                 }
+                MenuItem {
+                    text: qsTr("Delete Selected Nodes")
+                    enabled: editedNodeModel.count > 0
+                    onTriggered: graphCore.removeGraphNodes(Object.keys(selectedNodes))
+                }
+                MenuItem {
+                    text: qsTr("Evaluate")
+                    onTriggered: graphCore.evaluate()
+                }
+                MenuItem {
+                    text: qsTr("Layered Layout")
+                    onTriggered: graphCore.layoutAsync(GraphCore.LayeredLayout)
+                }
+                MenuItem {
+                    text: qsTr("Force-Directed Layout")
+                    onTriggered: graphCore.layoutAsync(GraphCore.ForceDirectedLayout)
+                }
                 MenuItem {
                     text: qsTr("Save")
                     onTriggered: {
@@ -133,103 +226,210 @@ Window {
             }
         }
 
-        Repeater {
-            model: graphCore.graphNodes
-            Rectangle {
-                id: graphNode
-                property string name: modelData.name
-                width: 250
-                height: 300
-                radius: 5
-                scale: zoomFactor
-                Behavior on scale { NumberAnimation { duration: 200 } }
-                color: "lightgray"
-                border.color: "black"
-                border.width: 5
-                smooth: true
-                antialiasing: true
+        Binding {
+            target: graphCore.visibleNodeModel
+            property: "viewport"
+            value: Qt.rect(flick.contentX / scene.scale, flick.contentY / scene.scale,
+                           flick.width / scene.scale, flick.height / scene.scale)
+        }
+        Binding {
+            target: graphCore.visibleNodeModel
+            property: "margin"
+            value: 300
+        }
+
+        // nodes live in scene coordinates, zooming scales the whole scene
+        Item {
+            id: scene
+            width: flick.contentWidth / zoomFactor
+            height: flick.contentHeight / zoomFactor
+            transformOrigin: Item.TopLeft
+            scale: zoomFactor
+            Behavior on scale { NumberAnimation { duration: 200 } }
+
+            GraphConnectionItem {
+                id: connectionItem
+                anchors.fill: parent
+                graph: graphCore
+                // curves outside of the visible part of the scene are only updated once scrolled into view
+                viewport: Qt.rect(flick.contentX / scene.scale, flick.contentY / scene.scale,
+                                  flick.width / scene.scale, flick.height / scene.scale)
+            }
+
+            GraphNodeItem {
+                id: nodeItem
+                anchors.fill: parent
+                graph: graphCore
+                zoomFactor: root.zoomFactor
+            }
 
-                Component.onCompleted: {
-                    x = modelData.xCoord
-                    y = modelData.yCoord
+            // names of the visible nodes and their ports, once they are readable
+            Repeater {
+                model: nodeItem.detailLevel === GraphNodeItem.LabelDetail ? graphCore.visibleNodeModel : null
+                Item {
+                    id: nodeLabels
+                    readonly property var nodeData: model.object
+                    x: nodeData.xCoord
+                    y: nodeData.yCoord
+                    width: nodeData.width
+                    height: nodeData.height
+
+                    Text {
+                        text: model.name
+                        font.bold: true
+                        font.pointSize: 12
+                        anchors.horizontalCenter: parent.horizontalCenter
+                        y: nodeData.margin
+                        height: nodeData.headerHeight
+                        verticalAlignment: Text.AlignVCenter
+                    }
+                    Column {
+                        id: inputLabelColumn
+                        x: nodeData.margin + nodeData.portHeight + 4
+                        y: nodeData.margin + nodeData.headerHeight
+                        width: (nodeLabels.width - 2 * nodeData.margin) / 2 - nodeData.portHeight - 4
+                        height: nodeLabels.height - y - nodeData.margin
+                        clip: true
+                        spacing: nodeData.portSpacing
+                        Repeater {
+                            model: nodeLabels.nodeData.inputPortModel
+                            Text {
+                                width: inputLabelColumn.width
+                                height: nodeLabels.nodeData.portHeight
+                                text: model.name
+                                elide: Text.ElideRight
+                                verticalAlignment: Text.AlignVCenter
+                            }
+                        }
+                    }
+                    Column {
+                        id: outputLabelColumn
+                        x: nodeLabels.width / 2
+                        y: inputLabelColumn.y
+                        width: inputLabelColumn.width
+                        height: inputLabelColumn.height
+                        clip: true
+                        spacing: nodeData.portSpacing
+                        Repeater {
+                            model: nodeLabels.nodeData.outputPortModel
+                            Text {
+                                width: outputLabelColumn.width
+                                height: nodeLabels.nodeData.portHeight
+                                text: model.name
+                                elide: Text.ElideRight
+                                horizontalAlignment: Qt.AlignRight
+                                verticalAlignment: Text.AlignVCenter
+                            }
+                        }
+                    }
                 }
-                onXChanged: { modelData.xCoord = x; updateConnections() }
-                onYChanged: { modelData.yCoord = y; updateConnections() }
-                onScaleChanged: updateConnections()
+            }
+
+            // full delegates for the nodes being edited
+            Repeater {
+                model: editedNodeModel
+                Rectangle {
+                    id: graphNode
+                    readonly property var nodeData: graphCore.findNode(model.name)
+                    property string name: model.name
+                    width: nodeData.width
+                    height: nodeData.height
+                    radius: 5
+                    color: "lightgray"
+                    border.color: "red"
+                    border.width: 5
+                    smooth: true
+                    antialiasing: true
 
-                GridLayout {
-                    anchors.fill: parent
-                    anchors.margins: 6
-                    columns: 2
-                    rows: 2
-                    columnSpacing: 0
+                    // position the graph was last seen at, dragging moves the whole selection by the difference
+                    property point lastPos
+                    property bool following: false
+
+                    Component.onCompleted: {
+                        followNode()
+                        z = ++root.highestZ
+                    }
+                    onXChanged: dragSelection()
+                    onYChanged: dragSelection()
+                    // moves are applied once per frame by the graph, which then moves the delegates
+                    Connections {
+                        target: graphNode.nodeData
+                        onCoordChanged: graphNode.followNode()
+                    }
+
+                    function followNode() {
+                        following = true
+                        x = nodeData.xCoord
+                        y = nodeData.yCoord
+                        following = false
+                        lastPos = Qt.point(x, y)
+                    }
+                    function dragSelection() {
+                        if (following || !dragArea.drag.active)
+                            return
+                        graphCore.moveNodesBy(Object.keys(selectedNodes), x - lastPos.x, y - lastPos.y)
+                        lastPos = Qt.point(x, y)
+                    }
+
+                    // port rows follow the layout constants of GraphNode, which computes
+                    // the connection anchors from them
                     Text {
                         text: graphNode.name
                         font.bold: true
                         font.pointSize: 12
-                        Layout.columnSpan: 2
-                        Layout.alignment: Qt.AlignHCenter | Qt.AlignTop
-                        Layout.topMargin: 4
+                        anchors.horizontalCenter: parent.horizontalCenter
+                        y: nodeData.margin
+                        height: nodeData.headerHeight
+                        verticalAlignment: Text.AlignVCenter
                     }
                     Column {
                         id: inputPortColumn
-                        Layout.preferredWidth: parent.width / 2
-                        Layout.fillHeight: true
-                        Layout.alignment: Qt.AlignLeft | Qt.AlignTop
+                        x: nodeData.margin
+                        y: nodeData.margin + nodeData.headerHeight
+                        width: (graphNode.width - 2 * nodeData.margin) / 2
+                        height: graphNode.height - y - nodeData.margin
                         clip: true
-                        spacing: 2
+                        spacing: nodeData.portSpacing
                         Repeater {
-                            model: modelData.inputPorts
+                            model: graphNode.nodeData.inputPortModel
                             RowLayout {
                                 width: inputPortColumn.width
+                                height: graphNode.nodeData.portHeight
+                                spacing: 4
                                 Rectangle {
-                                    id: point
-                                    color: modelData.color
+                                    color: model.color
                                     radius: height / 2
                                     Layout.fillHeight: true
                                     Layout.preferredWidth: height
-                                    Component.onCompleted: root.graphChanged.connect(saveCoords)
-
-                                    function saveCoords() {
-                                        if (modelData.isConnected) {
-                                            var pos = mapToItem(canvas, width / 2, height / 2)
-                                            root.portCoords[modelData.nodeName + modelData.name] = pos
-                                        }
-                                    }
                                     MouseArea {
                                         anchors.fill: parent
                                     }
                                 }
-                                Text { text: modelData.name; clip: true; elide: Text.ElideRight; Layout.fillWidth: true }
+                                Text { text: model.name; clip: true; elide: Text.ElideRight; Layout.fillWidth: true }
                             }
                         }
                     }
                     Column {
                         id: outputPortColumn
-                        Layout.preferredWidth: parent.width / 2
-                        Layout.fillHeight: true
-                        Layout.alignment: Qt.AlignRight | Qt.AlignTop
+                        x: inputPortColumn.x + inputPortColumn.width
+                        y: inputPortColumn.y
+                        width: inputPortColumn.width
+                        height: inputPortColumn.height
                         clip: true
-                        spacing: 2
+                        spacing: nodeData.portSpacing
                         Repeater {
-                            model: modelData.outputPorts
+                            model: graphNode.nodeData.outputPortModel
                             RowLayout {
                                 width: outputPortColumn.width
-                                Text { text: modelData.name; clip: true; elide: Text.ElideRight; horizontalAlignment: Qt.AlignRight; Layout.fillWidth: true }
+                                height: graphNode.nodeData.portHeight
+                                spacing: 4
+                                Text { text: model.name; clip: true; elide: Text.ElideRight; horizontalAlignment: Qt.AlignRight; Layout.fillWidth: true }
                                 Rectangle {
-                                    color: modelData.color
+                                    color: model.color
                                     radius: height / 2
                                     Layout.fillHeight: true
                                     Layout.preferredWidth: height
                                     Layout.alignment: Qt.AlignRight
-                                    Component.onCompleted: root.graphChanged.connect(saveCoords)
-
-                                    function saveCoords() {
-                                        if (modelData.isConnected) {
-                                            var pos = mapToItem(canvas, width / 2, height / 2)
-                                            root.portCoords[modelData.nodeName + modelData.name] = pos
-                                        }
-                                    }
                                     MouseArea {
                                         anchors.fill: parent
                                     }
@@ -237,76 +437,46 @@ Window {
                             }
                         }
                     }
-                }
 
-                MouseArea {
-                    id: dragArea
-                    anchors.fill: parent
-                    acceptedButtons: Qt.LeftButton | Qt.RightButton
-                    drag.target: graphNode
-                    scrollGestureEnabled: false  // 2-finger-flick gesture should pass through to the Flickable
-                    onPressed: {
-                        graphNode.z = ++root.highestZ;
-                        if (mouse.button === Qt.RightButton) {
-                            nodeMenu.popup()
-                        } else {
-                            if (mouse.modifiers & Qt.ControlModifier) {
-                                if (selectedNodes[graphNode.name] !== undefined)
-                                    deselect(graphNode)
-                                else
-                                    select(graphNode, false)
+                    MouseArea {
+                        id: dragArea
+                        anchors.fill: parent
+                        acceptedButtons: Qt.LeftButton | Qt.RightButton
+                        drag.target: graphNode
+                        scrollGestureEnabled: false  // 2-finger-flick gesture should pass through to the Flickable
+                        onPressed: {
+                            graphNode.z = ++root.highestZ;
+                            if (mouse.button === Qt.RightButton) {
+                                nodeMenu.popup()
                             } else {
-                                select(graphNode, true)
+                                if (mouse.modifiers & Qt.ControlModifier) {
+                                    if (selectedNodes[graphNode.name] !== undefined)
+                                        deselect(graphNode)
+                                    else
+                                        select(graphNode, false)
+                                } else {
+                                    select(graphNode, true)
+                                }
                             }
                         }
-                    }
 
-                    Menu {
-                        id: nodeMenu
-                        MenuItem {
-                            text: qsTr("Add Output Port...")
-                            onTriggered: {
-//                                var name = "NewPort"
-                                //graphCore.addGraphConnection(name, mouseArea.mouseX, mouseArea.mouseY)
+                        Menu {
+                            id: nodeMenu
+                            MenuItem {
+                                text: qsTr("Add Output Port...")
+                                onTriggered: {
+    //                                var name = "NewPort"
+                                    //graphCore.addGraphConnection(name, mouseArea.mouseX, mouseArea.mouseY)
+                                }
                             }
+                            MenuItem { text: qsTr("Add Intput Port...") }
                         }
-                        MenuItem { text: qsTr("Add Intput Port...") }
                     }
                 }
             }
         }
     }
 
-    Canvas {
-        id: canvas
-        anchors.fill: parent
-        onPaint: {
-            var ctx = getContext("2d")
-            ctx.save()
-            ctx.clearRect(0, 0, canvas.width, canvas.height)
-            ctx.lineWidth = 2
-            for (var i = 0; i < graphCore.graphConnections.length; ++i) {
-                var conn = graphCore.graphConnections[i]
-                var id = conn.sourceNodeName + conn.outputPortName
-                var start = root.portCoords[id]
-                if (start === undefined)
-                    continue;
-                id = conn.targetNodeName + conn.inputPortName
-                var end = root.portCoords[id]
-                if (end === undefined)
-                    continue;
-                ctx.strokeStyle = conn.color
-                ctx.beginPath()
-                ctx.moveTo(start.x, start.y)
-                var center = Qt.point((start.x + end.x)/2, (start.y + end.y)/2)
-                ctx.quadraticCurveTo(center.x, start.y, center.x, center.y)
-                ctx.quadraticCurveTo(center.x, end.y, end.x, end.y)
-                ctx.stroke()
-            }
-            ctx.restore()
-        }
-    }
-
     Rectangle {
         id: verticalScrollDecorator
         anchors.right: parent.right
@@ -340,4 +510,64 @@ Window {
     }
 
     Timer { id: scrollFadeTimer; interval: 1000; onTriggered: { hfade.start(); vfade.start() } }
+
+    Row {
+        anchors.horizontalCenter: parent.horizontalCenter
+        anchors.bottom: parent.bottom
+        anchors.bottomMargin: 12
+        spacing: 8
+        visible: graphCore.loading
+        ProgressBar {
+            id: loadProgressBar
+            anchors.verticalCenter: parent.verticalCenter
+            width: 300
+            indeterminate: true
+        }
+        Button {
+            text: qsTr("Cancel")
+            onClicked: graphCore.cancelLoad()
+        }
+        Connections {
+            target: graphCore
+            onLoadingChanged: {
+                loadProgressBar.indeterminate = true
+                loadProgressBar.value = 0
+            }
+            onLoadProgress: {
+                if (bytesTotal > 0) {
+                    loadProgressBar.indeterminate = false
+                    loadProgressBar.value = bytesRead / bytesTotal
+                }
+            }
+        }
+    }
+
+    Row {
+        anchors.horizontalCenter: parent.horizontalCenter
+        anchors.bottom: parent.bottom
+        anchors.bottomMargin: 12
+        spacing: 8
+        visible: graphCore.layouting && !graphCore.loading
+        ProgressBar {
+            id: layoutProgressBar
+            anchors.verticalCenter: parent.verticalCenter
+            width: 300
+            indeterminate: true
+        }
+        Button {
+            text: qsTr("Cancel")
+            onClicked: graphCore.cancelLayout()
+        }
+        Connections {
+            target: graphCore
+            onLayoutingChanged: {
+                layoutProgressBar.indeterminate = true
+                layoutProgressBar.value = 0
+            }
+            onLayoutProgress: {
+                layoutProgressBar.indeterminate = false
+                layoutProgressBar.value = step / stepCount
+            }
+        }
+    }
 }